@@ -0,0 +1,109 @@
+/** 
+ *  @file   Benchmark.h 
+ *  @brief  Minimal benchmark registration and measurement helpers
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07 
+ **/
+
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+namespace bench {
+
+/**
+ * @brief Measurement context given to every benchmark
+ */
+class State {
+public:
+    /**
+     * @brief Repeats an operation until enough time is spent, then reports its mean duration
+     * \param label : name of the measure, printed in the report
+     * \param operation : the callable to measure, called once per iteration
+     * \param minDuration : minimum total duration of the measure
+     */
+    template<typename Operation>
+    void measure(const std::string& label, Operation operation, std::chrono::milliseconds minDuration = std::chrono::milliseconds(200)){
+        unsigned long long iterations = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::duration elapsed;
+        do {
+            operation();
+            iterations++;
+            elapsed = std::chrono::steady_clock::now() - start;
+        } while(elapsed < minDuration);
+        this->report(label, std::chrono::duration<double, std::nano>(elapsed).count() / iterations, "ns/op");
+    }
+
+    /**
+     * @brief Reports a custom measured value
+     * \param label : name of the measure, printed in the report
+     * \param value : the measured value
+     * \param unit : unit of the value
+     */
+    void report(const std::string& label, double value, const std::string& unit);
+
+    std::string name; /**< Name of the running benchmark */
+};
+
+/**
+ * @brief Value reported by a benchmark, kept for the machine-readable output
+ */
+struct Result {
+    std::string benchmark; /**< Name of the benchmark */
+    std::string measure; /**< Label of the measure */
+    double value; /**< Measured value */
+    std::string unit; /**< Unit of the value */
+};
+
+/**
+ * @brief Every value reported so far, in report order
+ */
+const std::vector<Result>& results();
+
+/**
+ * @brief Writes the reported values as JSON, one object per value, so runs can be compared to track regressions
+ * \param output : the stream to write to
+ */
+void writeJson(std::ostream& output);
+
+/**
+ * @brief Heap bytes currently allocated through operator new, allocator rounding included
+ */
+std::size_t heapBytes();
+
+/**
+ * @brief Number of heap allocations made through operator new since the start of the program
+ */
+unsigned long long heapAllocations();
+
+typedef void (*Function)(State&);
+
+/**
+ * @brief Registers a benchmark at static-initialization time, \see BENCHMARK
+ */
+struct Registrar {
+    Registrar(const char* name, Function function);
+};
+
+/**
+ * @brief Runs every registered benchmark whose name contains the filter
+ * \return the number of benchmarks run
+ */
+int runAll(const std::string& filter);
+
+} // namespace bench
+
+/**
+ * @brief Defines and registers a benchmark function, the body receives a bench::State named state
+ */
+#define BENCHMARK(suite, name) \
+    static void bench_##suite##_##name(bench::State& state); \
+    static bench::Registrar registrar_##suite##_##name(#suite "." #name, bench_##suite##_##name); \
+    static void bench_##suite##_##name(bench::State& state)
+
+#endif //Benchmark_h
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include <AlarmCatalog.h>
+#include <cstdio>
+
+// Startup cost of a plant configuration of 100k patterns: mapped from a catalog, or built in code at static-init time
+
+static const std::size_t PATTERN_COUNT = 100000;
+
+static std::vector<AlarmCatalogPattern> plantPatterns(){
+    std::vector<AlarmCatalogPattern> patterns(PATTERN_COUNT);
+    unsigned int seed = 1;
+    for(std::size_t i=0;i<PATTERN_COUNT;i++){
+        AlarmCatalogPattern& pattern = patterns[i];
+        pattern.name = "zone" + std::to_string(i / 100) + ".alarm" + std::to_string(i % 100);
+        pattern.level = AlarmLevel(i % 3);
+        seed = seed * 1103515245 + 12345;
+        std::size_t tones = 2 + (seed >> 16) % 15; // 2 to 16 tones, long ones have edges
+        for(std::size_t t=0;t<tones;t++) pattern.tones.push_back(AlarmTone(50 * (1 + (seed >> (t % 16)) % 20), t % 2 == 0));
+    }
+    return patterns;
+}
+
+BENCHMARK(alarm_catalog, startup){
+    const std::string path = "bench_catalog.alc";
+    std::vector<AlarmCatalogPattern> patterns = plantPatterns();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    AlarmCatalog::write(path, patterns);
+    state.report("compile 100k patterns", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), "ms");
+    AlarmPool::Instance().reserve(AlarmPool::Instance().size() + PATTERN_COUNT);
+
+    state.measure("open 100k-pattern catalog", [&](){
+        AlarmCatalog catalog(path);
+    });
+    {
+        AlarmCatalog catalog(path);
+        std::size_t index = 0;
+        state.measure("find a pattern by name", [&](){
+            catalog.find(patterns[index].name);
+            index = (index + 7919) % PATTERN_COUNT;
+        });
+    }
+
+    // Every pattern becomes an Alarm, as the globals of a plant configuration
+    std::vector<Alarm> alarms;
+    alarms.reserve(PATTERN_COUNT);
+    unsigned long long allocations = bench::heapAllocations();
+    state.measure("startup from catalog: open + 100k alarms", [&](){
+        AlarmCatalog catalog(path);
+        for(std::size_t i=0;i<catalog.size();i++) alarms.push_back(catalog.create(i));
+        alarms.clear();
+    });
+    state.report("startup from catalog: allocations per alarm", double(bench::heapAllocations() - allocations) / PATTERN_COUNT, "allocations");
+    state.measure("startup from code: 100k alarms", [&](){
+        for(const AlarmCatalogPattern& pattern : patterns) alarms.push_back(Alarm(pattern.tones, pattern.level));
+        alarms.clear();
+    });
+    std::remove(path.c_str());
+}
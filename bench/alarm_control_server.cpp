@@ -0,0 +1,85 @@
+#include "Benchmark.h"
+#include <AlarmControlServer.h>
+#include <AlarmPatternCompiler.h>
+#include <AlarmScheduler.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Command throughput of the control server, and the playback lateness while it is loaded
+
+static const char* SOCKET_PATH = "bench_control.sock";
+
+static int connectTo(const char* path){
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    return fd;
+}
+
+// Sends a window of commands and reads its replies
+static void roundTrip(int fd, const std::string& window, std::size_t lines){
+    for(std::size_t sent=0;sent<window.size();){
+        ssize_t size = ::write(fd, window.data() + sent, window.size() - sent);
+        if(size <= 0) return;
+        sent += size;
+    }
+    char buffer[64 * 1024];
+    while(lines){
+        ssize_t size = ::read(fd, buffer, sizeof(buffer));
+        if(size <= 0) return;
+        for(ssize_t i=0;i<size;i++) if(buffer[i] == '\n') lines--;
+    }
+}
+
+BENCHMARK(alarm_control_server, commands){
+    AlarmScheduler scheduler;
+    AlarmCallbackSink sink([](const AlarmEdge&){});
+    AlarmPlayer player(sink, scheduler);
+    AlarmControlServer server(SOCKET_PATH, player);
+    for(int i=0;i<16;i++) server.define("load" + std::to_string(i), AlarmPatternCompiler::compile("(5X 5_)x4 10_"), AlarmLevel(i % 3));
+    server.start();
+
+    // A fast alarm keeps the playback thread busy, its lateness is measured under the command load
+    Alarm beat = Alarm(AlarmPatternCompiler::compile("1X 1_"), AlarmLevel::HIGH);
+    beat.setPlayer(player);
+    beat.start();
+
+    int fd = connectTo(SOCKET_PATH);
+    state.measure("ping round trip", [&](){
+        roundTrip(fd, "ping\n", 1);
+    });
+    for(std::size_t depth : {1, 16, 256}){
+        std::string window;
+        for(std::size_t i=0;i<depth;i++){
+            std::string alarm = "load" + std::to_string(i % 16);
+            window += i % 2 ? "stop " + alarm + "\n" : "start " + alarm + "\n";
+        }
+        player.resetMetrics();
+        unsigned long long before = server.getCommandCount();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        do roundTrip(fd, window, depth);
+        while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string suffix = ", depth " + std::to_string(depth);
+        state.report("start/stop throughput" + suffix, (server.getCommandCount() - before) / seconds, "commands/s");
+        state.report("tick lateness p99 under load" + suffix, player.getMetrics().tickLateness.percentile(99) / 1000, "us");
+    }
+
+    // The same changes as one transaction per window
+    std::string batch = "begin\n";
+    for(std::size_t i=0;i<256;i++) batch += (i % 2 ? "stop load" : "start load") + std::to_string(i % 16) + "\n";
+    batch += "commit\n";
+    unsigned long long before = server.getCommandCount();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do roundTrip(fd, batch, 258);
+    while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    state.report("batched start/stop throughput, 256 per commit", (server.getCommandCount() - before) / seconds, "commands/s");
+    ::close(fd);
+    beat.stop();
+}
@@ -0,0 +1,61 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+#include <AlarmJournal.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+// Cost of journaling: a raw append, from one thread and contended, and its overhead on the playback of a player
+
+static const unsigned int THREAD_COUNTS[] = {1, 2, 4};
+
+BENCHMARK(alarm_journal, append){
+    const std::string path = "bench_journal.alj";
+    AlarmJournal journal(path);
+    std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+    state.measure("append", [&](){
+        journal.append(AlarmJournalEvent::EDGE, time, 0, AlarmHandle(), 1);
+    });
+
+    // Every thread appends the same number of records, the mean is taken per record
+    for(unsigned int threads : THREAD_COUNTS){
+        static const unsigned int APPENDS = 1000000;
+        std::vector<std::thread> appenders;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(unsigned int t=0;t<threads;t++){
+            appenders.emplace_back([&journal, time, t](){
+                for(unsigned int i=0;i<APPENDS;i++) journal.append(AlarmJournalEvent::EDGE, time, t, AlarmHandle(), 1);
+            });
+        }
+        for(std::thread& appender : appenders) appender.join();
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        state.report("append, " + std::to_string(threads) + " threads", elapsed / (double(threads) * APPENDS), "ns/op");
+    }
+    unsigned long long allocations = bench::heapAllocations();
+    for(unsigned int i=0;i<1000;i++) journal.append(AlarmJournalEvent::EDGE, time, 0, AlarmHandle(), 1);
+    state.report("append: allocations", double(bench::heapAllocations() - allocations), "allocations");
+    std::remove(path.c_str());
+}
+
+BENCHMARK(alarm_journal, player){
+    const std::string path = "bench_journal_player.alj";
+    AlarmJournal journal(path);
+    for(bool journaled : {false, true}){
+        AlarmManualClock clock;
+        AlarmScheduler scheduler(clock);
+        AlarmCallbackSink sink([](const AlarmEdge&){});
+        AlarmPlayer player(sink, scheduler);
+        if(journaled) player.setJournal(&journal);
+        Alarm alarm({AlarmTone(1, true), AlarmTone(1, false)}, AlarmLevel::LOW);
+        alarm.setPlayer(player);
+        alarm.start();
+        state.measure(std::string("tone edge, ") + (journaled ? "journaled" : "not journaled"), [&](){
+            clock.advance(std::chrono::milliseconds(1));
+        });
+        alarm.stop();
+        player.setJournal(nullptr);
+    }
+    std::remove(path.c_str());
+}
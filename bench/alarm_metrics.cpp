@@ -0,0 +1,40 @@
+#include "Benchmark.h"
+#include <AlarmMetrics.h>
+#include <mutex>
+
+// Measures the recording cost of the instrumentation of the AlarmPlayer
+// Operations are timed by batches, the few nanoseconds measured would be hidden by reading the clock every time
+
+static const unsigned int BATCH = 10*1000*1000;
+
+template<typename Operation>
+static double batchMean(Operation operation){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(unsigned int i=0;i<BATCH;i++) operation(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / BATCH;
+}
+
+BENCHMARK(alarm_metrics, record){
+    AlarmHistogram histogram;
+    state.report("histogram record", batchMean([&](unsigned int i){ histogram.record(i & 0xFFFF); }), "ns/op");
+    state.report("histogram recordSerialized", batchMean([&](unsigned int i){ histogram.recordSerialized(i & 0xFFFF); }), "ns/op");
+    volatile std::uint64_t ticks = 0;
+    state.report("stopwatch ticks", batchMean([&](unsigned int){ ticks = AlarmStopwatch::ticks(); }), "ns/op");
+    state.report("steady_clock::now, for comparison", batchMean([&](unsigned int){
+        ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    }), "ns/op");
+}
+
+BENCHMARK(alarm_metrics, lock){
+    std::mutex mutex;
+    AlarmHistogram wait, hold;
+    double plain = batchMean([&](unsigned int){ std::lock_guard<std::mutex> lock(mutex); });
+    double timed = batchMean([&](unsigned int){ AlarmTimedLock<std::mutex> lock(mutex, wait, hold); });
+    AlarmLockSampling::setPeriod(1);
+    double every = batchMean([&](unsigned int){ AlarmTimedLock<std::mutex> lock(mutex, wait, hold); });
+    AlarmLockSampling::setPeriod(AlarmLockSampling::DEFAULT_PERIOD);
+    state.report("lock_guard, uncontended", plain, "ns/op");
+    state.report("AlarmTimedLock, uncontended, sampled holds", timed, "ns/op");
+    state.report("AlarmTimedLock, uncontended, every hold timed", every, "ns/op");
+    state.report("instrumentation overhead per lock", timed - plain, "ns/op");
+}
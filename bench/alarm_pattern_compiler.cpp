@@ -0,0 +1,73 @@
+#include "Benchmark.h"
+#include <AlarmPatternCompiler.h>
+
+// Cost of compiling the text pattern language, and of playing a compressed sequence instead of its expansion
+
+static const char* HIGH_PATTERN = "(250X 500_)x4 250X 2000_";
+
+// Source of a plant configuration: one pattern per alarm, written in the language
+static std::string plantSource(std::size_t count){
+    std::string source;
+    unsigned int seed = 1;
+    for(std::size_t i=0;i<count;i++){
+        seed = seed * 1103515245 + 12345;
+        source += "(" + std::to_string(50 * (1 + (seed >> 16) % 10)) + "X " + std::to_string(50 * (1 + (seed >> 20) % 10)) + "_)x";
+        source += std::to_string(2 + (seed >> 24) % 6) + " 1000_\n";
+    }
+    return source;
+}
+
+BENCHMARK(alarm_pattern_compiler, compile){
+    state.measure(std::string("compile \"") + HIGH_PATTERN + "\"", [](){
+        AlarmPatternCompiler::compile(HIGH_PATTERN);
+    });
+    state.measure("compile \"250X 500_ 250X 2000_\", flat", [](){
+        AlarmPatternCompiler::compile("250X 500_ 250X 2000_");
+    });
+    unsigned long long allocations = bench::heapAllocations();
+    for(int i=0;i<1000;i++) AlarmPatternCompiler::compile(HIGH_PATTERN);
+    state.report("allocations per compile", double(bench::heapAllocations() - allocations) / 1000, "allocations");
+
+    // Throughput over a configuration, the lines being compiled one by one
+    const std::string source = plantSource(10000);
+    std::vector<std::pair<std::size_t, std::size_t>> lines;
+    for(std::size_t begin=0, end; (end = source.find('\n', begin)) != std::string::npos; begin = end + 1) lines.push_back(std::make_pair(begin, end - begin));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned int rounds = 0;
+    do {
+        for(const std::pair<std::size_t, std::size_t>& line : lines) AlarmPatternCompiler::compile(source.data() + line.first, line.second);
+        rounds++;
+    } while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    state.report("compile throughput", source.size() * rounds / seconds / 1e6, "MB/s");
+}
+
+BENCHMARK(alarm_pattern_compiler, lookup){
+    // The same sequence, compressed and expanded, at increasing repetition counts
+    for(unsigned int repeat : {4u, 1000u, 1000000u}){
+        std::string text = "((250X 500_)x" + std::to_string(repeat) + " 250X 2000_)x3";
+        AlarmSequence::Ptr compressed = AlarmPatternCompiler::compile(text);
+        std::size_t before = bench::heapBytes();
+        AlarmSequence::Ptr expanded = AlarmSequence::create(compressed->toVector());
+        state.report("expanded heap, x" + std::to_string(repeat), bench::heapBytes() - before, "bytes");
+        before = bench::heapBytes();
+        AlarmSequence::Ptr recompiled = AlarmPatternCompiler::compile(text);
+        state.report("compressed heap, x" + std::to_string(repeat), bench::heapBytes() - before, "bytes");
+
+        volatile unsigned long long sink = 0;
+        unsigned long long position = 0;
+        state.measure("compressed indexAt, x" + std::to_string(repeat), [&](){
+            position += 7919;
+            sink = compressed->indexAt(position);
+        });
+        state.measure("expanded indexAt, x" + std::to_string(repeat), [&](){
+            position += 7919;
+            sink = expanded->indexAt(position);
+        });
+        std::size_t index = 0;
+        state.measure("compressed edge, x" + std::to_string(repeat), [&](){
+            index = (index + 7919) % compressed->size();
+            sink = compressed->edge(index);
+        });
+    }
+}
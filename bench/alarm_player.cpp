@@ -0,0 +1,338 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Measures the Alarm/AlarmPlayer API: start/stop and setLevel costs, per-tick cost,
+// contention between threads and the latency of a priority switch
+
+static const std::size_t ATTACHED_COUNTS[] = {0, 10, 100, 1000, 10000};
+
+typedef AlarmPattern<AlarmBeep<250>, AlarmSilence<750>> Pattern;
+
+// Player on a manual clock, so only the calling thread runs and no playback thread adds noise to the measure
+struct ManualPlayer {
+    ManualPlayer() : scheduler(clock), sink([](const AlarmEdge&){}), player(sink, scheduler) {}
+    AlarmManualClock clock;
+    AlarmScheduler scheduler;
+    AlarmCallbackSink sink;
+    AlarmPlayer player;
+};
+
+static std::vector<Alarm> startAlarms(AlarmPlayer& player, std::size_t count){
+    std::vector<Alarm> alarms;
+    alarms.reserve(count);
+    for(std::size_t i=0;i<count;i++){
+        alarms.emplace_back(Pattern::sequence(), AlarmLevel(i % 3));
+        alarms.back().setPlayer(player);
+        alarms.back().start();
+    }
+    return alarms;
+}
+
+BENCHMARK(alarm_player, start_stop){
+    for(std::size_t count : ATTACHED_COUNTS){
+        ManualPlayer output;
+        std::vector<Alarm> attached = startAlarms(output.player, count);
+        Alarm alarm(Pattern::sequence(), AlarmLevel::MEDIUM);
+        alarm.setPlayer(output.player);
+        state.measure("start+stop, " + std::to_string(count) + " attached", [&](){
+            alarm.start();
+            alarm.stop();
+        });
+    }
+}
+
+BENCHMARK(alarm_player, set_level){
+    for(std::size_t count : ATTACHED_COUNTS){
+        ManualPlayer output;
+        std::vector<Alarm> attached = startAlarms(output.player, count);
+        Alarm alarm(Pattern::sequence(), AlarmLevel::MEDIUM);
+        alarm.setPlayer(output.player);
+        alarm.start();
+        bool high = false;
+        state.measure("setLevel on a started alarm, " + std::to_string(count) + " attached", [&](){
+            high = !high;
+            alarm.setLevel(high ? AlarmLevel::HIGH : AlarmLevel::MEDIUM);
+        });
+    }
+}
+
+BENCHMARK(alarm_player, tick){
+    for(std::size_t count : ATTACHED_COUNTS){
+        // Every millisecond is a tone edge, so each advance is one update of the played alarm
+        ManualPlayer output;
+        std::vector<Alarm> attached = startAlarms(output.player, count);
+        Alarm alarm({AlarmTone(1, true), AlarmTone(1, false)}, AlarmLevel::HIGH);
+        alarm.setPlayer(output.player);
+        alarm.start();
+        output.clock.advance(std::chrono::milliseconds(0));
+        state.measure("update per tone edge, " + std::to_string(count) + " attached", [&](){
+            output.clock.advance(std::chrono::milliseconds(1));
+        });
+    }
+}
+
+BENCHMARK(alarm_player, contention){
+    // Threads toggle their own alarm on one player played by a real scheduler thread
+    AlarmScheduler scheduler;
+    AlarmCallbackSink sink([](const AlarmEdge&){});
+    AlarmPlayer player(sink, scheduler);
+    const std::chrono::milliseconds duration(300);
+    for(unsigned int threads : {1, 2, 4, 8}){
+        std::vector<Alarm> alarms;
+        for(unsigned int i=0;i<threads;i++){
+            alarms.emplace_back(Pattern::sequence(), AlarmLevel(i % 3));
+            alarms.back().setPlayer(player);
+        }
+        std::atomic<bool> go(false), done(false);
+        std::atomic<unsigned long long> toggles(0);
+        std::vector<std::thread> workers;
+        for(unsigned int i=0;i<threads;i++){
+            workers.emplace_back([&, i](){
+                while(!go) std::this_thread::yield();
+                unsigned long long count = 0;
+                while(!done){
+                    alarms[i].start();
+                    alarms[i].stop();
+                    count++;
+                }
+                toggles += count;
+            });
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        go = true;
+        std::this_thread::sleep_for(duration);
+        done = true;
+        for(std::thread& worker : workers) worker.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string suffix = ", " + std::to_string(threads) + " threads";
+        state.report("start+stop per second" + suffix, toggles / elapsed, "ops/s");
+        state.report("start+stop mean" + suffix, elapsed * threads * 1e9 / toggles, "ns/op");
+    }
+}
+
+BENCHMARK(alarm_player, priority_switch){
+    // A silent LOW alarm plays, a HIGH beeping alarm preempts it: time until the player is noisy
+    AlarmScheduler scheduler;
+    AlarmCallbackSink sink([](const AlarmEdge&){});
+    AlarmPlayer player(sink, scheduler);
+    Alarm low({AlarmTone(60*1000, false)}, AlarmLevel::LOW);
+    Alarm high({AlarmTone(60*1000, true)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    low.start();
+    std::vector<double> latencies;
+    for(unsigned int i=0;i<500;i++){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        high.start();
+        while(!player.isNoisy()) std::this_thread::yield();
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        high.stop();
+        while(player.isNoisy()) std::this_thread::yield();
+    }
+    low.stop();
+    std::sort(latencies.begin(), latencies.end());
+    state.report("HIGH start to isNoisy p50", latencies[latencies.size() * 50 / 100], "us");
+    state.report("HIGH start to isNoisy p99", latencies[latencies.size() * 99 / 100], "us");
+    state.report("HIGH start to isNoisy max", latencies.back(), "us");
+}
+
+BENCHMARK(alarm_player, preemption_under_load){
+    // Players beeping every millisecond keep the scheduler thread busy while a HIGH alarm preempts a LOW one:
+    // delay from the start or stop of the HIGH alarm to the update switching the played alarm
+    AlarmScheduler scheduler;
+    AlarmCallbackSink sink([](const AlarmEdge&){});
+    std::vector<std::unique_ptr<AlarmPlayer>> loadPlayers;
+    std::vector<Alarm> loadAlarms;
+    loadAlarms.reserve(20);
+    for(unsigned int i=0;i<20;i++){
+        loadPlayers.emplace_back(new AlarmPlayer(sink, scheduler));
+        loadAlarms.emplace_back(std::vector<AlarmTone>({AlarmTone(1, true), AlarmTone(1, false)}), AlarmLevel::LOW);
+        loadAlarms.back().setPlayer(*loadPlayers.back());
+        loadAlarms.back().start();
+    }
+    AlarmPlayer player(sink, scheduler);
+    Alarm low({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    Alarm high({AlarmTone(100, false)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    low.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    player.resetMetrics();
+    for(unsigned int i=0;i<500;i++){
+        high.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        high.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    AlarmHistogramSnapshot latency = player.getMetrics().switchLatency;
+    low.stop();
+    for(Alarm& alarm : loadAlarms) alarm.stop();
+    state.report("switches recorded of 1000", latency.count, "switches");
+    state.report("switch latency p50", latency.percentile(50) / 1000, "us");
+    state.report("switch latency p99", latency.percentile(99) / 1000, "us");
+    state.report("switch latency max", latency.max / 1000, "us");
+}
+
+BENCHMARK(alarm_player, cascade){
+    // A fault cascade raises then clears many alarms at once, one by one or as a single batch
+    for(std::size_t count : {10, 100, 1000}){
+        ManualPlayer output;
+        std::vector<Alarm> alarms;
+        std::vector<AlarmChange> starts, stops;
+        alarms.reserve(count);
+        for(std::size_t i=0;i<count;i++){
+            alarms.emplace_back(Pattern::sequence(), AlarmLevel(i % 3));
+            alarms.back().setPlayer(output.player);
+            starts.push_back(AlarmChange::start(alarms.back()));
+            stops.push_back(AlarmChange::stop(alarms.back()));
+        }
+        std::string suffix = ", " + std::to_string(count) + " alarms";
+        state.measure("start+stop one by one" + suffix, [&](){
+            for(Alarm& alarm : alarms) alarm.start();
+            output.clock.advance(std::chrono::milliseconds(0));
+            for(Alarm& alarm : alarms) alarm.stop();
+            output.clock.advance(std::chrono::milliseconds(0));
+        });
+        state.measure("start+stop batched" + suffix, [&](){
+            output.player.apply(starts);
+            output.clock.advance(std::chrono::milliseconds(0));
+            output.player.apply(stops);
+            output.clock.advance(std::chrono::milliseconds(0));
+        });
+    }
+
+    // With the scheduler thread running concurrently, alarms started one by one are seen partially started
+    const std::size_t count = 100, cascades = 20;
+    AlarmScheduler scheduler;
+    std::atomic<unsigned long long> edges(0);
+    AlarmCallbackSink sink([&](const AlarmEdge&){ edges++; });
+    AlarmPlayer player(sink, scheduler);
+    std::vector<Alarm> alarms;
+    std::vector<AlarmChange> starts, stops;
+    for(std::size_t i=0;i<count;i++){
+        // Levels rise along the cascade and only the HIGH alarms beep, every intermediate state may emit an edge
+        alarms.emplace_back(AlarmSequence::create({AlarmTone(60*1000, i >= count - count / 3)}), AlarmLevel(i * 3 / count));
+        alarms.back().setPlayer(player);
+        starts.push_back(AlarmChange::start(alarms.back()));
+        stops.push_back(AlarmChange::stop(alarms.back()));
+    }
+    for(bool batched : {false, true}){
+        unsigned long long updates = player.getMetrics().updates;
+        edges = 0;
+        for(std::size_t i=0;i<cascades;i++){
+            if(batched) player.apply(starts);
+            else for(Alarm& alarm : alarms) alarm.start();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            if(batched) player.apply(stops);
+            else for(Alarm& alarm : alarms) alarm.stop();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        scheduler.drain();
+        std::string suffix = batched ? " batched, 100 alarms" : " one by one, 100 alarms";
+        state.report("player updates per cascade" + suffix, double(player.getMetrics().updates - updates) / cascades, "updates");
+        state.report("edges per cascade" + suffix, double(edges) / cascades, "edges");
+    }
+}
+
+BENCHMARK(alarm_player, escalation){
+    // Pending escalations live in the wheel of the player: an update only looks at the due ones
+    for(std::size_t count : ATTACHED_COUNTS){
+        ManualPlayer output;
+        std::vector<Alarm> pending;
+        pending.reserve(count);
+        for(std::size_t i=0;i<count;i++){
+            pending.emplace_back(std::vector<AlarmTone>({AlarmTone(AlarmTone::MAX_DURATION, false)}));
+            pending.back().setEscalation(AlarmEscalation({{std::chrono::hours(1) + std::chrono::milliseconds(i), AlarmLevel::MEDIUM}}));
+            pending.back().setPlayer(output.player);
+            pending.back().start();
+        }
+        Alarm alarm({AlarmTone(1, true), AlarmTone(1, false)}, AlarmLevel::HIGH);
+        alarm.setPlayer(output.player);
+        alarm.start();
+        output.clock.advance(std::chrono::milliseconds(0));
+        state.measure("update per tone edge, " + std::to_string(count) + " pending escalations", [&](){
+            output.clock.advance(std::chrono::milliseconds(1));
+        });
+    }
+    for(std::size_t count : ATTACHED_COUNTS){
+        if(!count) continue;
+        ManualPlayer output;
+        std::vector<Alarm> alarms;
+        alarms.reserve(count);
+        for(std::size_t i=0;i<count;i++){
+            alarms.emplace_back(std::vector<AlarmTone>({AlarmTone(AlarmTone::MAX_DURATION, false)}));
+            alarms.back().setEscalation(AlarmEscalation({{std::chrono::seconds(1), AlarmLevel::MEDIUM}}));
+            alarms.back().setPlayer(output.player);
+            alarms.back().start();
+        }
+        output.clock.advance(std::chrono::milliseconds(0));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        output.clock.advance(std::chrono::seconds(1));
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        state.report("escalations applied at once, " + std::to_string(count) + " alarms", elapsed / count, "ns/alarm");
+    }
+}
+
+// Strobe thread following the noise of a player: delay from a tone edge to the wakeup of a thread waiting for it,
+// and cost of the notification for the playback
+BENCHMARK(alarm_player, wait_for_change){
+    {
+        AlarmScheduler scheduler;
+        AlarmCallbackSink sink([](const AlarmEdge&){});
+        AlarmPlayer player(sink, scheduler);
+        Alarm alarm({AlarmTone(2, true), AlarmTone(3, false)}, AlarmLevel::HIGH);
+        alarm.setPlayer(player);
+        std::atomic<bool> following(true);
+        AlarmHistogram latency;
+        std::thread strobe([&](){
+            std::uint64_t sequence = player.getSequence();
+            while(following){
+                std::uint64_t next = player.waitForChange(sequence, std::chrono::milliseconds(100));
+                if(next == sequence) continue;
+                std::chrono::steady_clock::time_point woken = std::chrono::steady_clock::now();
+                AlarmEvent event = player.getLastEvent();
+                // An edge published after the wakeup isn't the one that woke the thread
+                if(event.type == AlarmEventType::NOISE && event.time <= woken) latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(woken - event.time).count());
+                sequence = event.sequence;
+            }
+        });
+        alarm.start();
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        alarm.stop();
+        following = false;
+        strobe.join();
+        AlarmHistogramSnapshot snapshot = latency.snapshot();
+        state.report("edge to waiter wakeup p50", snapshot.percentile(50) / 1000, "us");
+        state.report("edge to waiter wakeup p99", snapshot.percentile(99) / 1000, "us");
+        state.report("edge to waiter wakeup max", snapshot.max / 1000, "us");
+    }
+
+    for(int observed : {0, 1, 2}){
+        ManualPlayer output;
+        AlarmCallbackObserver observer([](const AlarmEvent&){});
+        std::atomic<bool> waiting(observed == 2);
+        std::thread waiter([&](){
+            std::uint64_t sequence = output.player.getSequence();
+            while(waiting) sequence = output.player.waitForChange(sequence, std::chrono::milliseconds(10));
+        });
+        if(observed == 1) output.player.addObserver(&observer);
+        Alarm alarm({AlarmTone(1, true), AlarmTone(1, false)}, AlarmLevel::LOW);
+        alarm.setPlayer(output.player);
+        alarm.start();
+        const char* labels[] = {"tone edge, not observed", "tone edge, with an observer", "tone edge, with a waiting thread"};
+        state.measure(labels[observed], [&](){
+            output.clock.advance(std::chrono::milliseconds(1));
+        });
+        alarm.stop();
+        waiting = false;
+        output.clock.advance(std::chrono::milliseconds(10)); // The timeout of the waiter runs on the manual clock
+        waiter.join();
+        output.player.removeObserver(&observer);
+    }
+}
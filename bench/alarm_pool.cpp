@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+#include <memory>
+
+// Compares alarm states pooled behind handles with alarm states allocated one by one on the heap
+
+static const std::size_t ALARM_COUNTS[] = {100, 10000};
+
+BENCHMARK(alarm_pool, churn_heap){
+    for(std::size_t count : ALARM_COUNTS){
+        std::vector<std::unique_ptr<AlarmSlot>> alarms(count);
+        unsigned long long allocations = bench::heapAllocations();
+        unsigned long long rounds = 0;
+        state.measure("create+destroy, " + std::to_string(count) + " alarms", [&](){
+            for(std::unique_ptr<AlarmSlot>& alarm : alarms) alarm.reset(new AlarmSlot());
+            for(std::unique_ptr<AlarmSlot>& alarm : alarms) alarm.reset();
+            rounds++;
+        });
+        allocations = bench::heapAllocations() - allocations;
+        state.report("allocations per alarm, " + std::to_string(count) + " alarms", double(allocations) / (rounds * count), "allocations");
+    }
+}
+
+BENCHMARK(alarm_pool, churn_pool){
+    for(std::size_t count : ALARM_COUNTS){
+        AlarmPool& pool = AlarmPool::Instance();
+        pool.reserve(pool.size() + count);
+        std::vector<AlarmHandle> alarms(count);
+        unsigned long long allocations = bench::heapAllocations();
+        unsigned long long rounds = 0;
+        state.measure("create+destroy, " + std::to_string(count) + " alarms", [&](){
+            for(AlarmHandle& alarm : alarms) alarm = pool.create();
+            for(AlarmHandle& alarm : alarms) pool.destroy(alarm);
+            rounds++;
+        });
+        allocations = bench::heapAllocations() - allocations;
+        state.report("allocations per alarm, " + std::to_string(count) + " alarms", double(allocations) / (rounds * count), "allocations");
+    }
+}
+
+BENCHMARK(alarm_pool, churn_alarm){
+    for(std::size_t count : ALARM_COUNTS){
+        AlarmPool::Instance().reserve(AlarmPool::Instance().size() + count);
+        std::vector<Alarm> alarms;
+        alarms.reserve(count);
+        unsigned long long allocations = bench::heapAllocations();
+        unsigned long long rounds = 0;
+        state.measure("Alarm create+destroy, " + std::to_string(count) + " alarms", [&](){
+            for(std::size_t i=0;i<count;i++) alarms.emplace_back(AlarmLevel::MEDIUM);
+            alarms.clear();
+            rounds++;
+        });
+        allocations = bench::heapAllocations() - allocations;
+        state.report("Alarm allocations per alarm, " + std::to_string(count) + " alarms", double(allocations) / (rounds * count), "allocations");
+    }
+}
@@ -0,0 +1,63 @@
+#include "Benchmark.h"
+#include <AlarmQueue.h>
+#include <algorithm>
+#include <random>
+
+// Compares the AlarmQueue priority index with the former sorted vector of the AlarmPlayer
+
+struct QueueItem {
+    int level;
+    AlarmQueueHook<QueueItem> hook;
+};
+
+static const std::size_t ALARM_COUNTS[] = {10, 1000, 100000};
+
+static std::vector<QueueItem> makeItems(std::size_t count){
+    std::vector<QueueItem> items(count);
+    for(std::size_t i=0;i<count;i++) items[i].level = i%3;
+    return items;
+}
+
+// Attach and detach as implemented before the AlarmQueue: linear search, then full sort
+static void vectorAttach(std::vector<QueueItem*>& list, QueueItem* item){
+    if(std::find(list.begin(), list.end(), item) == list.end()) list.push_back(item);
+    std::sort(list.begin(), list.end(), [](QueueItem* a, QueueItem* b) {return a->level > b->level; });
+}
+
+static void vectorDetach(std::vector<QueueItem*>& list, QueueItem* item){
+    list.erase(std::remove(list.begin(), list.end(), item), list.end());
+    std::sort(list.begin(), list.end(), [](QueueItem* a, QueueItem* b) {return a->level > b->level; });
+}
+
+BENCHMARK(alarm_queue, toggle_sorted_vector){
+    for(std::size_t count : ALARM_COUNTS){
+        std::vector<QueueItem> items = makeItems(count);
+        std::vector<QueueItem*> list;
+        for(QueueItem& item : items) list.push_back(&item);
+        std::stable_sort(list.begin(), list.end(), [](QueueItem* a, QueueItem* b) {return a->level > b->level; });
+        std::mt19937 random(42);
+        volatile int top = 0;
+        state.measure("detach+attach+top, " + std::to_string(count) + " alarms", [&](){
+            QueueItem* item = &items[random() % count];
+            vectorDetach(list, item);
+            vectorAttach(list, item);
+            top = list.front()->level;
+        });
+    }
+}
+
+BENCHMARK(alarm_queue, toggle_priority_index){
+    for(std::size_t count : ALARM_COUNTS){
+        std::vector<QueueItem> items = makeItems(count);
+        AlarmQueue<QueueItem, &QueueItem::hook> queue;
+        for(QueueItem& item : items) queue.push(&item, item.level);
+        std::mt19937 random(42);
+        volatile int top = 0;
+        state.measure("detach+attach+top, " + std::to_string(count) + " alarms", [&](){
+            QueueItem* item = &items[random() % count];
+            queue.remove(item);
+            queue.push(item, item->level);
+            top = queue.top()->level;
+        });
+    }
+}
@@ -0,0 +1,75 @@
+#include "Benchmark.h"
+#include <AlarmRenderer.h>
+#include <AlarmPattern.h>
+#include <cstdio>
+
+// Measures the offline rendering of an hour of overlapping alarms, in samples per second and against real time
+
+// Output discarding the samples, so only the synthesis is measured
+class NullPcmSink : public AlarmPcmSink {
+public:
+    void write(const std::int16_t* samples, std::size_t count) override {
+        checksum += samples[count / 2]; // Keeps the samples observable
+    }
+    long long checksum = 0;
+};
+
+// The patterns of the CLI, raised and cleared at different times so they preempt each other
+static std::vector<AlarmRenderEdge> hourTimeline(){
+    std::vector<AlarmRenderTrack> tracks(3);
+    tracks[0].sequence = AlarmPattern<AlarmBeep<1000>, AlarmSilence<29000>>::sequence();
+    tracks[1].sequence = AlarmPattern<AlarmBeep<250>, AlarmSilence<750>>::sequence();
+    tracks[1].level = AlarmLevel::MEDIUM;
+    tracks[1].start = std::chrono::minutes(10);
+    tracks[1].stop = std::chrono::minutes(40);
+    tracks[2].sequence = AlarmPattern<AlarmBeep<250>, AlarmSilence<500>, AlarmBeep<250>, AlarmSilence<500>,
+                                      AlarmBeep<250>, AlarmSilence<500>, AlarmBeep<250>, AlarmSilence<500>,
+                                      AlarmBeep<250>, AlarmSilence<2000>>::sequence();
+    tracks[2].level = AlarmLevel::HIGH;
+    tracks[2].start = std::chrono::minutes(20);
+    tracks[2].stop = std::chrono::minutes(30);
+    return AlarmRenderer::timeline(tracks, std::chrono::hours(1));
+}
+
+static void renderHour(bench::State& state, AlarmWaveform waveform){
+    AlarmRenderSettings settings;
+    settings.waveform = waveform;
+    // Silent blocks take a fast path, so a continuous beep measures the synthesis kernels alone
+    std::vector<std::pair<std::string, std::vector<AlarmRenderEdge>>> timelines = {
+        {"1 h at 44.1 kHz, alarm timeline", hourTimeline()},
+        {"1 h at 44.1 kHz, continuous beep", {AlarmRenderEdge{0, true}}}
+    };
+    for(const std::pair<std::string, std::vector<AlarmRenderEdge>>& timeline : timelines){
+        AlarmRenderer renderer(settings);
+        NullPcmSink sink;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::size_t samples = renderer.render(timeline.second, std::chrono::hours(1), sink);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        state.report(timeline.first, samples / seconds / 1e6, "Msamples/s");
+        state.report("realtime factor", 3600 / seconds, "x");
+    }
+}
+
+BENCHMARK(alarm_renderer, square_hour){
+    renderHour(state, AlarmWaveform::SQUARE);
+}
+
+BENCHMARK(alarm_renderer, sine_hour){
+    renderHour(state, AlarmWaveform::SINE);
+}
+
+BENCHMARK(alarm_renderer, wav_hour){
+    const std::string path = "alarm_renderer_bench.wav";
+    std::vector<AlarmRenderEdge> edges = hourTimeline();
+    AlarmRenderer renderer;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t samples;
+    {
+        AlarmWavSink wav(path, renderer.getSettings().sampleRate);
+        samples = renderer.render(edges, std::chrono::hours(1), wav);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove(path.c_str());
+    state.report("1 h to a WAV file", samples / seconds / 1e6, "Msamples/s");
+    state.report("realtime factor", 3600 / seconds, "x");
+}
@@ -0,0 +1,204 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+#include <AlarmScheduler.h>
+#include <AlarmTimingWheel.h>
+#include <AlarmClock.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/mman.h>
+
+// Measures the AlarmTimingWheel against an ordered set, one AlarmScheduler thread playing many players,
+// the wakeup jitter of the real-time mode under load, and a simulation of alarm traffic driven by an AlarmManualClock
+
+struct WheelItem {
+    AlarmTimerHook<WheelItem> hook;
+};
+
+static const std::size_t TIMER_COUNT = 10000;
+
+BENCHMARK(alarm_scheduler, reschedule_ordered_set){
+    std::multiset<std::pair<std::uint64_t, WheelItem*>> timers;
+    std::vector<WheelItem> items(TIMER_COUNT);
+    std::vector<std::multiset<std::pair<std::uint64_t, WheelItem*>>::iterator> positions;
+    std::mt19937 random(42);
+    for(WheelItem& item : items) positions.push_back(timers.insert(std::make_pair(random() % 60000, &item)));
+    state.measure("cancel+insert, " + std::to_string(TIMER_COUNT) + " timers", [&](){
+        std::size_t index = random() % TIMER_COUNT;
+        timers.erase(positions[index]);
+        positions[index] = timers.insert(std::make_pair(random() % 60000, &items[index]));
+    });
+}
+
+BENCHMARK(alarm_scheduler, reschedule_timing_wheel){
+    AlarmTimingWheel<WheelItem, &WheelItem::hook> wheel;
+    std::vector<WheelItem> items(TIMER_COUNT);
+    std::mt19937 random(42);
+    for(WheelItem& item : items) wheel.insert(&item, random() % 60000);
+    state.measure("cancel+insert, " + std::to_string(TIMER_COUNT) + " timers", [&](){
+        WheelItem* item = &items[random() % TIMER_COUNT];
+        wheel.remove(item);
+        wheel.insert(item, random() % 60000);
+    });
+}
+
+// Output of a player, recording the emission time of every tone edge and its delivery delay
+class EdgeRecorder : public AlarmSink {
+public:
+    EdgeRecorder(){
+        edges.reserve(64);
+        delays.reserve(64);
+    }
+    void write(const AlarmEdge& edge) override {
+        edges.push_back(edge.time);
+        delays.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - edge.time).count());
+    }
+    std::vector<std::chrono::steady_clock::time_point> edges;
+    std::vector<double> delays;
+};
+
+static double cpuSeconds(){
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+BENCHMARK(alarm_scheduler, playing_alarms){
+    const std::size_t count = 10000;
+    const std::chrono::milliseconds tone(250);
+    const std::chrono::seconds duration(3);
+    typedef AlarmPattern<AlarmBeep<250>, AlarmSilence<250>> Pattern;
+
+    // One zone per alarm: every player is updated by the same scheduler thread
+    AlarmScheduler scheduler;
+    std::vector<std::unique_ptr<EdgeRecorder>> recorders;
+    std::vector<std::unique_ptr<AlarmPlayer>> players;
+    std::vector<Alarm> alarms;
+    alarms.reserve(count);
+    for(std::size_t i=0;i<count;i++){
+        recorders.emplace_back(new EdgeRecorder());
+        players.emplace_back(new AlarmPlayer(*recorders.back(), scheduler));
+        alarms.emplace_back(Pattern::sequence(), AlarmLevel::MEDIUM);
+        alarms.back().setPlayer(*players.back());
+    }
+
+    double cpu = cpuSeconds();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(Alarm& alarm : alarms) alarm.start(std::chrono::milliseconds(std::rand() % 500)); // Spread the edges
+    std::this_thread::sleep_for(duration);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cpu = cpuSeconds() - cpu;
+    for(Alarm& alarm : alarms) alarm.stop();
+    scheduler.drain();
+
+    // Lateness of every edge, relative to the first edge of its alarm (its playback origin)
+    std::vector<double> lateness, delays;
+    for(std::unique_ptr<EdgeRecorder>& recorder : recorders){
+        delays.insert(delays.end(), recorder->delays.begin(), recorder->delays.end());
+        std::vector<std::chrono::steady_clock::time_point>& edges = recorder->edges;
+        if(edges.size() < 3) continue;
+        std::chrono::steady_clock::time_point origin = edges[1]; // The first edge is the playback start, not on the tone grid
+        for(std::size_t i=2;i+1<edges.size();i++){ // The last edge is the stop
+            std::chrono::steady_clock::time_point expected = origin + (long)(i-1) * tone;
+            lateness.push_back(std::chrono::duration<double, std::milli>(edges[i] - expected).count());
+        }
+    }
+    std::sort(lateness.begin(), lateness.end());
+    std::sort(delays.begin(), delays.end());
+    std::string suffix = ", " + std::to_string(count) + " alarms";
+    state.report("edges per second" + suffix, lateness.size() / elapsed, "edges/s");
+    state.report("scheduler and sink cpu" + suffix, 100 * cpu / elapsed, "% of a core");
+    AlarmSinkStats stats = scheduler.getSinkStats();
+    state.report("edges dropped or coalesced" + suffix, stats.dropped + stats.coalesced, "edges");
+    if(!delays.empty()) state.report("sink delivery delay p99" + suffix, delays[delays.size() * 99 / 100], "ms");
+    if(lateness.empty()) return;
+    state.report("edge lateness p50" + suffix, lateness[lateness.size() * 50 / 100], "ms");
+    state.report("edge lateness p99" + suffix, lateness[lateness.size() * 99 / 100], "ms");
+    state.report("edge lateness p99.9" + suffix, lateness[lateness.size() * 999 / 1000], "ms");
+    state.report("edge lateness max" + suffix, lateness.back(), "ms");
+}
+
+BENCHMARK(alarm_scheduler, realtime_jitter){
+    const std::chrono::seconds duration(2);
+
+    // Every CPU is kept busy by a time-sharing thread, competing with the scheduler thread for its wakeups
+    std::atomic<bool> burning(true);
+    std::vector<std::thread> burners;
+    for(unsigned int i=0;i<std::max(1u, std::thread::hardware_concurrency());i++){
+        burners.emplace_back([&burning](){
+            volatile unsigned long long spins = 0;
+            while(burning.load(std::memory_order_relaxed)) spins++;
+        });
+    }
+
+    for(bool realtime : {false, true}){
+        AlarmScheduler scheduler;
+        AlarmCallbackSink sink([](const AlarmEdge&){});
+        AlarmPlayer player(sink, scheduler);
+        std::string suffix = realtime ? ", real-time" : ", time sharing";
+        if(realtime){
+            AlarmRealtimeStatus status = scheduler.setRealtime();
+            state.report("real-time granted: scheduled", status.scheduled, "");
+            state.report("real-time granted: memory locked", status.locked, "");
+        }
+        Alarm alarm({AlarmTone(2, true), AlarmTone(3, false)}, AlarmLevel::HIGH); // A wakeup every 2 or 3 milliseconds
+        alarm.setPlayer(player);
+        alarm.start();
+        std::this_thread::sleep_for(duration);
+        alarm.stop();
+        scheduler.drain();
+
+        AlarmHistogramSnapshot lateness = scheduler.getWakeupLateness();
+        state.report("wakeups" + suffix, lateness.count, "wakeups");
+        state.report("wakeup lateness p50" + suffix, lateness.percentile(50) / 1000, "us");
+        state.report("wakeup lateness p99" + suffix, lateness.percentile(99) / 1000, "us");
+        state.report("wakeup lateness p99.9" + suffix, lateness.percentile(99.9) / 1000, "us");
+        state.report("wakeup lateness max" + suffix, lateness.max / 1000, "us");
+    }
+    ::munlockall(); // Memory locking is process-wide, the next benchmarks run as usual
+
+    burning = false;
+    for(std::thread& burner : burners) burner.join();
+}
+
+BENCHMARK(alarm_scheduler, simulated_events){
+    const std::size_t zones = 100, events = 1000*1000;
+    typedef AlarmPattern<AlarmBeep<250>, AlarmSilence<750>> Pattern;
+
+    // Three alarms of different levels per zone, started and stopped at random: every event may switch priority
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    unsigned long long edges = 0;
+    AlarmCallbackSink sink([&](const AlarmEdge&){ edges++; });
+    std::vector<std::unique_ptr<AlarmPlayer>> players;
+    std::vector<Alarm> alarms;
+    alarms.reserve(zones * 3);
+    for(std::size_t i=0;i<zones;i++){
+        players.emplace_back(new AlarmPlayer(sink, scheduler));
+        for(AlarmLevel level : {AlarmLevel::LOW, AlarmLevel::MEDIUM, AlarmLevel::HIGH}){
+            alarms.emplace_back(Pattern::sequence(), level);
+            alarms.back().setPlayer(*players.back());
+        }
+    }
+
+    std::mt19937 random(42);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(std::size_t i=0;i<events;i++){
+        Alarm& alarm = alarms[random() % alarms.size()];
+        if(alarm.isStarted()) alarm.stop();
+        else alarm.start();
+        clock.advance(std::chrono::milliseconds(random() % 200)); // About 100ms of traffic between events
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double simulated = std::chrono::duration<double>(clock.now().time_since_epoch()).count();
+    for(Alarm& alarm : alarms) alarm.stop();
+
+    std::string suffix = ", " + std::to_string(zones) + " zones";
+    state.report("start/stop events per second" + suffix, events / elapsed, "events/s");
+    state.report("edges per second" + suffix, edges / elapsed, "edges/s");
+    state.report("simulated hours", simulated / 3600, "h");
+    state.report("simulation speed-up", simulated / elapsed, "x");
+}
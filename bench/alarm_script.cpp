@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+#include <AlarmScript.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <memory>
+
+// Measures scripted alarms: the cost of an update resuming a script, and the memory of thousands of scripts
+// compared to the thread per alarm they replace
+
+static const std::size_t SCRIPT_COUNTS[] = {100, 1000, 10000};
+
+static AlarmScript siren(){
+    for(unsigned int i=0;;i++){
+        co_yield AlarmTone(1 + i % 3, true);
+        co_yield AlarmTone(1, false);
+    }
+}
+
+BENCHMARK(alarm_script, update){
+    for(std::size_t count : SCRIPT_COUNTS){
+        // One player per script on a shared manual clock, every millisecond is an edge of most scripts
+        AlarmManualClock clock;
+        AlarmScheduler scheduler(clock);
+        AlarmCallbackSink sink([](const AlarmEdge&){});
+        std::vector<std::unique_ptr<AlarmPlayer>> players;
+        std::vector<Alarm> alarms;
+        alarms.reserve(count);
+        std::size_t before = bench::heapBytes();
+        for(std::size_t i=0;i<count;i++){
+            players.emplace_back(new AlarmPlayer(sink, scheduler));
+            alarms.emplace_back(AlarmLevel::HIGH);
+            alarms.back().setSource(std::make_shared<AlarmScript>(siren()));
+            alarms.back().setPlayer(*players.back());
+            alarms.back().start();
+        }
+        clock.advance(std::chrono::milliseconds(0));
+        state.report("heap per scripted zone, player included, " + std::to_string(count) + " scripts", double(bench::heapBytes() - before) / count, "bytes");
+        state.measure("1ms of playback, " + std::to_string(count) + " scripts", [&](){
+            clock.advance(std::chrono::milliseconds(1));
+        }, std::chrono::milliseconds(count > 1000 ? 1000 : 200));
+    }
+}
+
+BENCHMARK(alarm_script, frame){
+    std::vector<AlarmScript> scripts;
+    scripts.reserve(1000);
+    std::size_t before = bench::heapBytes();
+    for(int i=0;i<1000;i++) scripts.push_back(siren());
+    state.report("coroutine frame per script", double(bench::heapBytes() - before) / 1000, "bytes");
+    AlarmScript script = siren();
+    AlarmTone tone;
+    std::chrono::milliseconds played(0);
+    state.measure("resume a script", [&](){
+        script.next(tone, played);
+        played += std::chrono::milliseconds(tone.duration);
+    });
+}
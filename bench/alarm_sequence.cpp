@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+#include <Alarm.h>
+
+// Compares packed tones and inline storage with the former AlarmTone layout in a std::vector
+
+struct LegacyTone {
+    unsigned int duration;
+    bool beep;
+};
+
+// Tone counts of the CLI sample alarms, and a longer generated pattern
+static const std::size_t PATTERN_SIZES[] = {2, 10, 64};
+static const std::size_t CATALOG_SIZE = 100000;
+
+// Measures the memory of a catalog of definitions, storage included
+template<typename Definition, typename Build>
+static void catalogFootprint(bench::State& state, const std::string& label, Build build){
+    for(std::size_t size : PATTERN_SIZES){
+        std::size_t before = bench::heapBytes();
+        std::vector<Definition> catalog(CATALOG_SIZE);
+        for(Definition& definition : catalog) build(definition, size);
+        state.report(label + ", " + std::to_string(size) + " tones", double(bench::heapBytes() - before) / CATALOG_SIZE, "bytes/alarm");
+    }
+}
+
+BENCHMARK(alarm_sequence, footprint){
+    state.report("sizeof(LegacyTone)", sizeof(LegacyTone), "bytes");
+    state.report("sizeof(AlarmTone)", sizeof(AlarmTone), "bytes");
+
+    catalogFootprint<std::vector<LegacyTone>>(state, "legacy tone vector", [](std::vector<LegacyTone>& definition, std::size_t size){
+        definition.assign(size, LegacyTone{250, true});
+    });
+    catalogFootprint<std::vector<AlarmTone>>(state, "packed tone vector", [](std::vector<AlarmTone>& definition, std::size_t size){
+        definition.assign(size, AlarmTone(250, true));
+    });
+    catalogFootprint<AlarmSequence::Ptr>(state, "sequence snapshot", [](AlarmSequence::Ptr& definition, std::size_t size){
+        definition = AlarmSequence::create(std::vector<AlarmTone>(size, AlarmTone(250, true)));
+    });
+
+    // Heap owned by an Alarm, beyond its own size: a short sequence lives inside the Alarm itself
+    state.report("sizeof(Alarm)", sizeof(Alarm), "bytes");
+    state.report("sizeof(AlarmSlot)", sizeof(AlarmSlot), "bytes");
+    AlarmPool::Instance().reserve(1); // Slot chunks are allocated once, not per Alarm
+    for(std::size_t size : PATTERN_SIZES){
+        std::size_t before = bench::heapBytes();
+        unsigned long long allocations = bench::heapAllocations();
+        Alarm alarm(std::vector<AlarmTone>(size, AlarmTone(250, true))); // The vector is released once constructed
+        std::size_t bytes = bench::heapBytes() - before;
+        allocations = bench::heapAllocations() - allocations - 1; // The vector is not owned by the Alarm
+        state.report("alarm heap, " + std::to_string(size) + " tones", bytes, "bytes");
+        state.report("alarm allocations, " + std::to_string(size) + " tones", allocations, "allocations");
+    }
+}
+
+BENCHMARK(alarm_sequence, iteration){
+    const std::size_t count = 1000*1000;
+    std::vector<LegacyTone> legacy(count);
+    std::vector<AlarmTone> tones(count);
+    for(std::size_t i=0;i<count;i++){
+        legacy[i] = LegacyTone{unsigned(1 + i%500), i%2 == 0};
+        tones[i] = AlarmTone(1 + i%500, i%2 == 0);
+    }
+    AlarmSequence::Ptr sequence = AlarmSequence::create(tones);
+
+    volatile unsigned long long sink = 0;
+    state.measure("legacy vector, noisy time of 1M tones", [&](){
+        unsigned long long noisy = 0;
+        for(const LegacyTone& tone : legacy) noisy += tone.beep * tone.duration;
+        sink = noisy;
+    });
+    state.measure("packed snapshot, noisy time of 1M tones", [&](){
+        unsigned long long noisy = 0;
+        for(const AlarmTone& tone : *sequence) noisy += tone.beep * tone.duration;
+        sink = noisy;
+    });
+
+    unsigned long long position = 0;
+    state.measure("packed snapshot, tone lookup in 1M tones", [&](){
+        position += 7919;
+        sink = sequence->indexAt(position);
+    });
+}
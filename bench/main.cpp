@@ -0,0 +1,134 @@
+#include "Benchmark.h"
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+// Counting allocator: every heap allocation of the benchmarks goes through here
+static std::atomic<std::size_t> g_heapBytes(0);
+static std::atomic<unsigned long long> g_heapAllocations(0);
+
+void* operator new(std::size_t size){
+    void* ptr = std::malloc(size ? size : 1);
+    if(!ptr) throw std::bad_alloc();
+    g_heapBytes += malloc_usable_size(ptr);
+    g_heapAllocations++;
+    return ptr;
+}
+void* operator new[](std::size_t size){ return ::operator new(size); }
+void operator delete(void* ptr) noexcept {
+    if(ptr) g_heapBytes -= malloc_usable_size(ptr);
+    std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept { ::operator delete(ptr); }
+
+namespace bench {
+
+struct Entry {
+    const char* name;
+    Function function;
+};
+
+static std::vector<Entry>& registry(){
+    static std::vector<Entry> entries; // Function-local to be ready before any Registrar runs
+    return entries;
+}
+
+static std::vector<Result>& resultList(){
+    static std::vector<Result> list;
+    return list;
+}
+
+const std::vector<Result>& results(){
+    return resultList();
+}
+
+static std::string quote(const std::string& text){
+    std::ostringstream quoted;
+    quoted << '"';
+    for(char c : text){
+        if(c == '"' || c == '\\') quoted << '\\' << c;
+        else if((unsigned char)c < 0x20) quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+        else quoted << c;
+    }
+    quoted << '"';
+    return quoted.str();
+}
+
+void writeJson(std::ostream& output){
+    output << "{\n  \"context\": {\"compiler\": " << quote(__VERSION__)
+#ifdef NDEBUG
+           << ", \"assertions\": false"
+#else
+           << ", \"assertions\": true"
+#endif
+           << "},\n  \"results\": [";
+    const std::vector<Result>& list = results();
+    for(std::size_t i=0;i<list.size();i++){
+        output << (i ? ",\n" : "\n") << "    {\"benchmark\": " << quote(list[i].benchmark) << ", \"measure\": " << quote(list[i].measure)
+               << ", \"value\": ";
+        if(std::isfinite(list[i].value)) output << std::setprecision(17) << list[i].value;
+        else output << "null"; // JSON has no infinity nor NaN
+        output << ", \"unit\": " << quote(list[i].unit) << "}";
+    }
+    output << "\n  ]\n}\n";
+}
+
+std::size_t heapBytes(){
+    return g_heapBytes;
+}
+
+unsigned long long heapAllocations(){
+    return g_heapAllocations;
+}
+
+Registrar::Registrar(const char* name, Function function){
+    registry().push_back({name, function});
+}
+
+void State::report(const std::string& label, double value, const std::string& unit){
+    resultList().push_back(Result{name, label, value, unit});
+    std::cout << std::left << std::setw(40) << name << std::setw(44) << label
+              << std::right << std::setw(16) << std::fixed << std::setprecision(1) << value << " " << unit << std::endl;
+}
+
+int runAll(const std::string& filter){
+    int count = 0;
+    for(const Entry& entry : registry()){
+        if(std::string(entry.name).find(filter) == std::string::npos) continue;
+        State state;
+        state.name = entry.name;
+        entry.function(state);
+        count++;
+    }
+    return count;
+}
+
+} // namespace bench
+
+int main(int argc, char** argv){
+    // Usage: benchmarks [--json <path>] [filter]
+    std::string filter, json;
+    for(int i=1;i<argc;i++){
+        std::string arg = argv[i];
+        if(arg == "--json" && i+1 < argc) json = argv[++i];
+        else filter = arg;
+    }
+    if(!bench::runAll(filter)){
+        std::cerr << "No benchmark matching '" << filter << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if(!json.empty()){
+        std::ofstream output(json);
+        bench::writeJson(output);
+        if(!output){
+            std::cerr << "Cannot write '" << json << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
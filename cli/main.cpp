@@ -1,42 +1,92 @@
 #include <iostream>
 #include <Alarm.h>
+#include <AlarmPatternCompiler.h>
+#include <AlarmControlServer.h>
+#include <AlarmJournal.h>
+#include <memory>
+#include <csignal>
 
-//Create custom alarms
-Alarm alarm_low = Alarm({
-    AlarmTone(1*1000, true),
-    AlarmTone(29*1000, false)} ,
-    AlarmLevel::LOW
-);
-Alarm alarm_medium = Alarm({
-    AlarmTone(250, true),
-    AlarmTone(750, false)} ,
-    AlarmLevel::MEDIUM
-);
-Alarm alarm_high = Alarm({
-    AlarmTone(250, true),// Beep 1
-    AlarmTone(500, false),
-    AlarmTone(250, true),// Beep 2
-    AlarmTone(500, false),
-    AlarmTone(250, true),// Beep 3
-    AlarmTone(500, false),
-    AlarmTone(250, true),// Beep 4
-    AlarmTone(500, false),
-    AlarmTone(250, true),// Beep 5
-    AlarmTone(2*1000, false)} ,
-    AlarmLevel::HIGH
-);
+//Create custom alarms, patterns are built at compile time or written in the pattern language
+typedef AlarmPattern<
+    AlarmBeep<1*1000>,
+    AlarmSilence<29*1000>
+> LowPattern;
+typedef AlarmPattern<
+    AlarmBeep<250>,
+    AlarmSilence<750>
+> MediumPattern;
+
+Alarm alarm_low = Alarm(LowPattern::sequence(), AlarmLevel::LOW);
+Alarm alarm_medium = Alarm(MediumPattern::sequence(), AlarmLevel::MEDIUM);
+Alarm alarm_high = Alarm(AlarmPatternCompiler::compile("(250X 500_)x4 250X 2000_"), AlarmLevel::HIGH);
 
 void printHelp(){
     std::cout << "Sample CLI interface for Alarm player" << std::endl << std::endl;
     std::cout << "\t Press 'h' followed by ENTER to toggle High-level alarm" << std::endl;
     std::cout << "\t Press 'm' followed by ENTER to toggle Medium-level alarm" << std::endl;
     std::cout << "\t Press 'l' followed by ENTER to toggle Low-level alarm" << std::endl;
-    std::cout << "\t Press 'q' followed by ENTER to exit the program" << std::endl;
+    std::cout << "\t Press 'i' followed by ENTER to toggle interleaving of lower-level alarms" << std::endl;
+    std::cout << "\t Press 's' followed by ENTER to print the player metrics" << std::endl;
+    std::cout << "\t Press 'q' followed by ENTER to exit the program" << std::endl << std::endl;
+    std::cout << "\t Run with '-s <socket>' to serve the alarms low, medium and high on a control socket instead" << std::endl;
+    std::cout << "\t Run with '-j <journal>' to record the playback in a journal, read by alarm_journal" << std::endl;
     exit(EXIT_SUCCESS);
 }
 
+void printMetrics(){
+    std::cout << std::endl;
+    AlarmPlayer::Instance().getMetrics().print(std::cout);
+    const char* names[] = {"low", "medium", "high"};
+    Alarm* alarms[] = {&alarm_low, &alarm_medium, &alarm_high};
+    for(int i=0;i<3;i++){
+        AlarmStats stats = alarms[i]->getStats();
+        std::cout << "alarm " << names[i] << ": audible " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.audible).count()
+                  << " ms, preempted " << stats.preempted << " times" << std::endl;
+    }
+}
+
+void toggleInterleaving(){
+    AlarmArbitration arbitration = AlarmPlayer::Instance().getArbitration();
+    bool strict = arbitration.policy == AlarmArbitrationPolicy::STRICT;
+    arbitration.policy = strict ? AlarmArbitrationPolicy::INTERLEAVED : AlarmArbitrationPolicy::STRICT;
+    AlarmPlayer::Instance().setArbitration(arbitration);
+}
+
+AlarmControlServer* g_server = nullptr;
+
+void stopServer(int){
+    g_server->stop(); // Only writes to an eventfd, safe in a signal handler
+}
+
+int serve(const std::string& path){
+    AlarmControlServer server(path);
+    if(!server.isOpen()){
+        std::cerr << path << ": cannot listen" << std::endl;
+        return EXIT_FAILURE;
+    }
+    server.define("low", LowPattern::sequence(), AlarmLevel::LOW);
+    server.define("medium", MediumPattern::sequence(), AlarmLevel::MEDIUM);
+    server.define("high", AlarmPatternCompiler::compile("(250X 500_)x4 250X 2000_"), AlarmLevel::HIGH);
+    g_server = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::cout << "Serving on " << path << ", stop with Ctrl+C" << std::endl;
+    server.run();
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char** argv) {
     if(argc>1 && std::string(argv[1]) == "-h") printHelp();
+    if(argc>2 && std::string(argv[1]) == "-s") return serve(argv[2]);
+    std::unique_ptr<AlarmJournal> journal;
+    if(argc>2 && std::string(argv[1]) == "-j"){
+        journal.reset(new AlarmJournal(argv[2]));
+        if(!journal->isOpen()){
+            std::cerr << argv[2] << ": cannot be mapped" << std::endl;
+            return EXIT_FAILURE;
+        }
+        AlarmPlayer::Instance().setJournal(journal.get());
+    }
     char c = ' ';
     while (c != 'q'){
         std::cin >> c;
@@ -50,8 +100,15 @@ int main(int argc, char** argv) {
             case 'h':
                 alarm_high.isStarted() ? alarm_high.stop() : alarm_high.start();
                 break;
+            case 'i':
+                toggleInterleaving();
+                break;
+            case 's':
+                printMetrics();
+                break;
         }
     }
 
+    AlarmPlayer::Instance().setJournal(nullptr); // The player outlives the journal
     return EXIT_SUCCESS;
 }
@@ -1,81 +1,223 @@
 #include "Alarm.h"
 
 
-Alarm::Alarm() {
+Alarm::Alarm() : m_handle(AlarmPool::Instance().create()) {
 
 }
 
-Alarm::Alarm(AlarmLevel level) : m_level(level){
-
+Alarm::Alarm(AlarmLevel level) : Alarm() {
+    if(AlarmSlot* slot = this->slot()) slot->level = level;
 }
 
 Alarm::Alarm(std::vector<AlarmTone> sequence, AlarmLevel level) 
- : m_sequence(sequence)
- , m_level(level) {
+ : Alarm(level) {
+    AlarmSlot* slot = this->slot();
+    if(!slot) return;
+    if(sequence.size() <= AlarmSequence::INLINE_CAPACITY){
+        // Short sequence, stored inline: it is published once and never modified, later changes publish new snapshots
+        std::copy(sequence.begin(), sequence.end(), slot->inlineTones);
+        slot->inlineSequence = AlarmSequence::wrap(slot->inlineTones, sequence.size());
+        slot->sequence = AlarmSequence::reference(slot->inlineSequence);
+    }
+    else slot->sequence = AlarmSequence::create(sequence);
+}
+
+Alarm::Alarm(AlarmSequence::Ptr sequence, AlarmLevel level)
+ : Alarm(level) {
+    if(AlarmSlot* slot = this->slot()) slot->sequence = sequence ? std::move(sequence) : AlarmSequence::empty();
+}
+
+Alarm::Alarm(const AlarmSequence& sequence, AlarmLevel level)
+ : Alarm(level) {
+    AlarmSlot* slot = this->slot();
+    if(!slot) return;
+    slot->inlineSequence = sequence; // Published once and never modified, as a short inline sequence
+    slot->sequence = AlarmSequence::reference(slot->inlineSequence);
+}
+
+Alarm::Alarm(Alarm&& other) : m_handle(other.m_handle) {
+    other.m_handle = AlarmHandle();
+}
+
+Alarm& Alarm::operator=(Alarm&& other){
+    if(this == &other) return *this;
+    this->stop();
+    this->destroy();
+    m_handle = other.m_handle;
+    other.m_handle = AlarmHandle();
+    return *this;
 }
 
 Alarm::~Alarm() {
     this->stop(); // Make sure the alarm gets detached from the AlaramPlayer
+    this->destroy(); // Following uses of the handle will be detected as stale
 }
 
-void Alarm::setLevel(AlarmLevel level){
-    if(level == m_level) return;
-    m_level = level;
-    // Notify the AlarmPlayer on level update by restarting the playback
-    // This avoids a constantly-running level lookup in the AlarmPlayback playlist
-    if(this->isStarted()){
-        this->stop();
-        this->start();
+void Alarm::destroy(){
+    AlarmSlot* slot = AlarmPool::Instance().retire(m_handle); // Calls through the handle from other threads are over
+    m_handle = AlarmHandle();
+    if(!slot) return;
+    if(slot->state != AlarmState::IDLE){ // Started again through its handle after stop(), e.g. by an AlarmPlayer::apply()
+        AlarmPlayer* player = slot->player;
+        (player ? *player : AlarmPlayer::Instance()).detachRetired(slot);
     }
+    AlarmPool::Instance().recycle(slot);
+}
+
+void Alarm::setLevel(AlarmLevel level, bool restart){
+    AlarmSlot* slot = this->slot();
+    if(!slot || (level == slot->level && !restart)) return;
+    // The AlarmPlayer moves a started alarm to its new priority bucket, without a level lookup on each update
+    this->onPlayer([&](AlarmPlayer& player){ return player.relevel(m_handle, level, restart); });
 }
 
 AlarmLevel Alarm::getLevel(){
-    return m_level;
+    AlarmSlot* slot = this->slot();
+    return slot ? slot->level.load() : AlarmLevel::LOW;
+}
+
+void Alarm::setEscalation(const AlarmEscalation& escalation){
+    if(!this->slot()) return;
+    this->onPlayer([&](AlarmPlayer& player){ return player.escalate(m_handle, escalation); });
+}
+
+AlarmEscalation Alarm::getEscalation(){
+    AlarmEscalation escalation;
+    this->onPlayer([&](AlarmPlayer& player){ return player.getEscalation(m_handle, escalation); });
+    return escalation;
+}
+
+void Alarm::acknowledge(){
+    if(!this->slot()) return;
+    this->onPlayer([&](AlarmPlayer& player){ return player.acknowledge(m_handle); });
 }
 
 void Alarm::clear(){
-    m_sequence_mtx.lock();
-    m_sequence.clear();
-    m_toneIndex = 0;
-    m_toneMsElapsed = 0;
-    m_sequence_mtx.unlock();
+    this->setSequence(AlarmSequence::empty());
 }
 
 void Alarm::addTone(AlarmTone tone){
-    m_sequence_mtx.lock();
-    m_sequence.push_back(tone);
-    m_sequence_mtx.unlock();
+    AlarmSlot* slot = this->slot();
+    if(!slot) return;
+    AlarmTimedLock<std::mutex, true> lock(slot->sequence_mtx, AlarmPool::Instance().sequenceWait, AlarmPool::Instance().sequenceHold);
+    std::vector<AlarmTone> tones = std::atomic_load(&slot->sequence)->toVector(); // Copy, the published snapshot is immutable
+    tones.push_back(tone);
+    this->publish(slot, AlarmSequence::create(tones));
 }
 
 void Alarm::setSequence(std::vector<AlarmTone> sequence){
-    this->clear();
-    m_sequence_mtx.lock();
-    m_sequence = sequence;
-    m_sequence_mtx.unlock();
+    this->setSequence(AlarmSequence::create(sequence));
+}
+
+void Alarm::setSequence(AlarmSequence::Ptr sequence){
+    AlarmSlot* slot = this->slot();
+    if(!slot) return;
+    AlarmTimedLock<std::mutex, true> lock(slot->sequence_mtx, AlarmPool::Instance().sequenceWait, AlarmPool::Instance().sequenceHold);
+    slot->rewind = true; // Playback restarts from the begining
+    this->publish(slot, sequence ? std::move(sequence) : AlarmSequence::empty());
 }
 
 std::vector<AlarmTone> Alarm::getSequence(){
-    return m_sequence;
+    return this->getSequenceSnapshot()->toVector();
+}
+
+AlarmSequence::Ptr Alarm::getSequenceSnapshot(){
+    AlarmSlot* slot = this->slot();
+    if(!slot) return AlarmSequence::empty();
+    AlarmSequence::Ptr sequence = std::atomic_load(&slot->sequence);
+    if(sequence.get() != &slot->inlineSequence) return sequence;
+    // The sequence stored in the slot only lives as long as the Alarm, it is kept for the AlarmPlayer: callers get an owning copy
+    if(sequence->tones() == slot->inlineTones) return AlarmSequence::create(sequence->toVector());
+    return std::make_shared<const AlarmSequence>(*sequence); // Tones and edges stay in the external storage given at construction
+}
+
+void Alarm::setSource(AlarmToneSource::Ptr source){
+    AlarmSlot* slot = this->slot();
+    if(!slot) return;
+    AlarmTimedLock<std::mutex, true> lock(slot->sequence_mtx, AlarmPool::Instance().sequenceWait, AlarmPool::Instance().sequenceHold);
+    slot->rewind = true; // Playback restarts with the first tone of the source
+    std::atomic_store(&slot->source, std::move(source));
+    if(this->isStarted()) this->getPlayer().refresh();
+}
+
+AlarmToneSource::Ptr Alarm::getSource(){
+    AlarmSlot* slot = this->slot();
+    return slot ? std::atomic_load(&slot->source) : AlarmToneSource::Ptr();
+}
+
+void Alarm::publish(AlarmSlot* slot, AlarmSequence::Ptr sequence){
+    if(std::atomic_load(&slot->source)){ // The sequence replaces the source
+        std::atomic_store(&slot->source, AlarmToneSource::Ptr());
+        slot->rewind = true;
+    }
+    std::atomic_store(&slot->sequence, std::move(sequence));
+    if(this->isStarted()) this->getPlayer().refresh(); // The next tone edge may have changed
 }
 
 void Alarm::start(){
+    this->start(std::chrono::milliseconds(0));
+}
+
+void Alarm::start(std::chrono::milliseconds position){
     if(this->isStarted()) return;
-    AlarmPlayer& player = AlarmPlayer::Instance();
-    m_sequence_mtx.lock();
-    m_toneIndex = 0;
-    m_toneMsElapsed = 0;
-    m_sequence_mtx.unlock();
-    player.attach(this);
-    m_started = true;
+    // State and playback position are set by the AlarmPlayer
+    this->onPlayer([&](AlarmPlayer& player){ return player.attach(m_handle, position); });
 }
 
 void Alarm::stop(){
     if(!this->isStarted()) return;
-    AlarmPlayer& player = AlarmPlayer::Instance();
-    player.detach(this);
-    m_started = false;
+    this->onPlayer([&](AlarmPlayer& player){ return player.detach(m_handle); });
+}
+
+void Alarm::seek(std::chrono::milliseconds position){
+    if(!this->isStarted()) return;
+    this->onPlayer([&](AlarmPlayer& player){ return player.seek(m_handle, position); });
+}
+
+std::chrono::milliseconds Alarm::getPosition(){
+    std::chrono::milliseconds position(0);
+    if(!this->isStarted()) return position;
+    this->onPlayer([&](AlarmPlayer& player){ return player.getPosition(m_handle, position); });
+    return position;
+}
+
+AlarmStats Alarm::getStats(){
+    AlarmStats stats;
+    this->onPlayer([&](AlarmPlayer& player){ return player.getStats(m_handle, stats); });
+    return stats;
+}
+
+void Alarm::syncWith(Alarm& other){
+    this->seek(other.getPosition());
 }
 
 bool Alarm::isStarted(){
-    return m_started;
-}
\ No newline at end of file
+    return this->getState() != AlarmState::IDLE;
+}
+
+AlarmState Alarm::getState(){
+    AlarmSlot* slot = this->slot();
+    return slot ? slot->state.load() : AlarmState::IDLE;
+}
+
+void Alarm::setPlayer(AlarmPlayer& player){
+    if(!this->slot() || &player == &this->getPlayer()) return; // Already bound
+    // Detach from the previous player, then restart on the new one if the alarm was started
+    bool moved = false;
+    this->onPlayer([&](AlarmPlayer& previous){ return previous.rebind(m_handle, player, moved); });
+    if(moved) this->onPlayer([&](AlarmPlayer& next){ return next.resume(m_handle); });
+}
+
+AlarmPlayer& Alarm::getPlayer(){
+    AlarmSlot* slot = this->slot();
+    AlarmPlayer* player = slot ? slot->player.load() : nullptr;
+    return player ? *player : AlarmPlayer::Instance();
+}
+
+AlarmHandle Alarm::getHandle() const {
+    return m_handle;
+}
+
+AlarmSlot* Alarm::slot() const {
+    return AlarmPool::Instance().get(m_handle);
+}
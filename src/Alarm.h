@@ -12,33 +12,21 @@
 #include <iterator>
 #include <algorithm>
 #include <mutex>
+#include <chrono>
+#include <atomic>
 
-#include "AlarmPlayer.h"
+#include "AlarmSequence.h"
+#include "AlarmPattern.h"
+#include "AlarmQueue.h"
+#include "AlarmPool.h"
 
-/**
- * @brief Levels available to define an Alarm priority
- * Order is important as int-conversion is used to define priority (with lower value = lower priority)
- */
-enum class AlarmLevel { LOW=0, MEDIUM=1, HIGH=2 };
-
-/**
- * @brief Tone played during an alarm
- */
-typedef struct AlarmTone{
-    /**
-     *  \brief AlarmTone contructor
-     *  \param _duration : initializes the \see duration attribute (in milliseconds)
-     *  \param _beep : initializes the \see beep attribute, true false noise, false for silence
-     *  \warning Durations below 250ms won't playback perfectly due to the \see AlarmPlayer fixed playback rate
-     */
-    AlarmTone(unsigned int _duration, bool _beep) : duration(_duration), beep(_beep) {};
-    unsigned int duration; /**< Duration of the tone in milliseconds */
-    bool beep; /**< Wether the tone should produce noise (true) or not (false) */
-} AlarmTone;
+class AlarmPlayer; //Forward-declaration of the AlarmPlayer class
 
 /**
  * @brief Representation of an alarm with a tone sequence
  * This class plays itself in its friendly \see AlarmPlayer class using the \see start() function
+ * Its state is stored in the \see AlarmPool, the Alarm only owns the \see AlarmHandle of that state (RAII)
+ * Every function but the destructor and the assignment may be called concurrently from several threads
  */
 class Alarm {
 friend AlarmPlayer;
@@ -50,9 +38,15 @@ public:
     Alarm();
 
     /**
-     * @brief Copy constructor
+     * @brief Move constructor
+     * The moved-from Alarm is left without state, every function has no effect on it
+     */
+    Alarm (Alarm&& other);
+
+    /**
+     * @brief Move assignment, the current state of this Alarm is stopped and destroyed first
      */
-    Alarm (const Alarm&);
+    Alarm& operator= (Alarm&& other);
 
     /**
      * @brief Alarm constructor with level initialization
@@ -63,10 +57,25 @@ public:
     /**
      * @brief Alarm constructor with lsequence and evel initialization
      * Sets the provided sequence and optionally the \see AlarmLevel (LOW by default)
+     * Sequences up to \see AlarmSequence::INLINE_CAPACITY tones are stored inside the Alarm, without allocation
      * \param sequence : The initial vector of tones to be played by an alarm
      */
     Alarm(std::vector<AlarmTone> sequence, AlarmLevel level=AlarmLevel::LOW);
 
+    /**
+     * @brief Alarm constructor with sequence snapshot and level initialization
+     * Shares the provided snapshot, typically a compile-time \see AlarmPattern, without copying its tones
+     * \param sequence : The initial sequence snapshot to be played by an alarm
+     */
+    Alarm(AlarmSequence::Ptr sequence, AlarmLevel level=AlarmLevel::LOW);
+
+    /**
+     * @brief Alarm constructor over tones in external storage, and level initialization
+     * The sequence is stored inside the Alarm, its tones and edges are referenced in place, e.g. in an \see AlarmCatalog
+     * \param sequence : The initial sequence of the alarm, its tones and edges must outlive the Alarm and its snapshots
+     */
+    Alarm(const AlarmSequence& sequence, AlarmLevel level=AlarmLevel::LOW);
+
     /**
      * @brief Alarm destructor
      * If being played, the alarm will \see stop() itself at destruction
@@ -75,10 +84,11 @@ public:
 
     /**
      * @brief Setter of the alarm level
-     * If a new level is set while being played, the Alarm will restart its playback
+     * A started Alarm moves to its new priority in place, keeping its playback position unless restarted
      * \param level : the new \see AlarmLevel of the Alarm
+     * \param restart : wether a started Alarm restarts its playback from the begining of its sequence
      */
-    void setLevel(AlarmLevel level);
+    void setLevel(AlarmLevel level, bool restart=false);
 
     /**
      * @brief Getter of the current Alarm level
@@ -86,6 +96,25 @@ public:
      */
     AlarmLevel getLevel();
 
+    /**
+     * @brief Setter of the escalation of the Alarm, raising its level while started and not acknowledged
+     * Deadlines are kept by its \see AlarmPlayer and raise the level in place, as \see setLevel(), without any polling.
+     * The delays of a started Alarm count from its start or last \see acknowledge()
+     * \param escalation : the new escalation, an empty one to never escalate
+     */
+    void setEscalation(const AlarmEscalation& escalation);
+
+    /**
+     * @brief Getter of the escalation of the Alarm
+     */
+    AlarmEscalation getEscalation();
+
+    /**
+     * @brief Acknowledges a started Alarm: restores the level it was started or last set at, and restarts its escalation
+     * \warning If called while that alarm has not started, this function has no effect
+     */
+    void acknowledge();
+
     /**
      * @brief Clears the \see AlarmTone sequence, emptying-it
      */
@@ -93,22 +122,54 @@ public:
 
     /**
      * @brief Append a tone at the end of the \see AlarmTone sequence
+     * The new sequence is a snapshot allocated on the heap, whatever its size: only the constructors store tones inside the Alarm,
+     * the storage inside the Alarm can't be rewritten while the \see AlarmPlayer may still read the previous snapshot
      * \param tone : the new \see AlarmTone to append
      */
     void addTone(AlarmTone tone);
 
     /**
      * @brief Setter of the \see AlarmTone sequence
+     * The new sequence is a snapshot allocated on the heap, see \see addTone()
      * \param sequence : the new \see AlarmTone sequence of the Alarm
      */
     void setSequence(std::vector<AlarmTone> sequence);
 
+    /**
+     * @brief Setter of the \see AlarmTone sequence from a snapshot
+     * \param sequence : the new sequence snapshot of the Alarm, typically a compile-time \see AlarmPattern
+     */
+    void setSequence(AlarmSequence::Ptr sequence);
+
     /**
      * @brief Getter of the current \see AlarmTone sequence
      * \return the current \see AlarmTone sequence of the Alarm
      */
     std::vector<AlarmTone> getSequence();
 
+    /**
+     * @brief Getter of the current \see AlarmSequence snapshot, without copying its tones
+     * A sequence stored inside the Alarm at construction is copied, so the snapshot may outlive the Alarm
+     * \return the immutable snapshot of the sequence, unaffected by later changes of the Alarm
+     */
+    AlarmSequence::Ptr getSequenceSnapshot();
+
+    /**
+     * @brief Setter of a source of tones played instead of the sequence, see \see AlarmToneSource
+     * The playback restarts with the first tone pulled from the source, and the Alarm stops once the source is exhausted.
+     * A source doesn't loop nor seek: \see seek() has no effect and \see getPosition() is the time it played.
+     * It takes no slice from a higher level alarm nor gives any to a lower one under \see AlarmArbitrationPolicy::INTERLEAVED.
+     * Setting a sequence afterwards drops the source
+     * \param source : the source, nullptr to play the sequence again
+     */
+    void setSource(AlarmToneSource::Ptr source);
+
+    /**
+     * @brief Getter of the source of tones, \see setSource()
+     * \return the source, nullptr if the Alarm plays its sequence
+     */
+    AlarmToneSource::Ptr getSource();
+
     /**
      * @brief Starts the playback of the Alarm through the \see AlarmPlayer
      * Sets the playback cursor to the begining of the sequence
@@ -117,6 +178,38 @@ public:
      */
     void start();
 
+    /**
+     * @brief Starts the playback of the Alarm at a position of its sequence
+     * Same as \see start(), but the playback cursor is set to the provided position
+     * \param position : the position to start from, wraps at the end of the sequence
+     */
+    void start(std::chrono::milliseconds position);
+
+    /**
+     * @brief Moves the playback cursor of a started Alarm, for seeking or fast-forwarding
+     * \param position : the new position in the sequence, wraps at the end of the sequence
+     * \warning If called while that alarm has not started, this function has no effect
+     */
+    void seek(std::chrono::milliseconds position);
+
+    /**
+     * @brief Getter of the playback cursor
+     * \return the current position in the sequence, 0 if the Alarm has not started
+     */
+    std::chrono::milliseconds getPosition();
+
+    /**
+     * @brief Getter of the counters of the Alarm: time spent beeping and number of preemptions
+     * \return the counters since the creation of the Alarm, counted by its current player
+     */
+    AlarmStats getStats();
+
+    /**
+     * @brief Aligns the playback cursor of this started Alarm on another one, so they play in phase
+     * \param other : the Alarm to align with
+     */
+    void syncWith(Alarm& other);
+
     /**
      * @brief Stops the playback of the Alarm through the \see AlarmPlayer
      * \warning If called while that alarm has not started, this function has no effect
@@ -129,16 +222,66 @@ public:
      */
     bool isStarted();
 
-protected:
-    //Playback attributes
-    unsigned int m_toneIndex = 0; /**< Used be \see AlarmPLayer to save the current playback index in the \see AlarmTone sequence */
-    unsigned int m_toneMsElapsed = 0; /**< Used be \see AlarmPLayer to save the elapsed duration of \see AlarmTone being played */
-    std::mutex m_sequence_mtx; /**< Protects the sequence vector and playback attributes from concurrent access */
+    /**
+     * @brief Getter of the lifecycle state of the Alarm, lock-free
+     * \return the \see AlarmState, IDLE if the Alarm has been moved
+     */
+    AlarmState getState();
+
+    /**
+     * @brief Binds the Alarm to an \see AlarmPlayer, the default one being AlarmPlayer::Instance()
+     * If bound while being played, the Alarm restarts its playback on the new player
+     * \param player : the player the Alarm will be played by, must outlive the Alarm playback
+     */
+    void setPlayer(AlarmPlayer& player);
+
+    /**
+     * @brief Getter of the \see AlarmPlayer the Alarm is bound to
+     * \return the bound player, AlarmPlayer::Instance() if the Alarm has not been bound
+     */
+    AlarmPlayer& getPlayer();
+
+    /**
+     * @brief Getter of the handle of the Alarm state in the \see AlarmPool
+     * \return the handle, a null handle if the Alarm has been moved
+     */
+    AlarmHandle getHandle() const;
 
 private:
-    AlarmLevel m_level = AlarmLevel::LOW; /**< The stored \see AlarmLevel of the Alarm */
-    bool m_started = false; /**< The stored playback state of the Alarm */
-    std::vector<AlarmTone> m_sequence; /**< The stored sequence of \see AlarmTone of the Alarm */
+    /**
+     * @brief Publishes a new sequence snapshot for the \see AlarmPlayer
+     * \param slot : the state of the Alarm
+     * \param sequence : the new snapshot, replacing the current one atomically
+     */
+    void publish(AlarmSlot* slot, AlarmSequence::Ptr sequence);
+
+    /**
+     * @brief Getter of the Alarm state
+     * \return the state in the \see AlarmPool, nullptr if the Alarm has been moved
+     */
+    AlarmSlot* slot() const;
+
+    /**
+     * @brief Runs an operation on the bound \see AlarmPlayer, again on the new one if the binding changed meanwhile
+     * \param operation : callable taking the player, returning false if the alarm was not bound to it
+     */
+    template<typename Operation>
+    void onPlayer(Operation operation){
+        while(!operation(this->getPlayer()));
+    }
+
+    /**
+     * @brief Destroys the Alarm state once stopped, the handle is stale afterwards
+     * The handle is made stale before the state is reset, so calls through it from other threads either complete first or have no effect
+     */
+    void destroy();
+
+    AlarmHandle m_handle; /**< Handle of the Alarm state in the \see AlarmPool */
+
+    Alarm& operator= (const Alarm&) = delete;
+    Alarm (const Alarm&) = delete;
 };
 
-#endif //AlarmPlayer_h
+#include "AlarmPlayer.h" // Alarm users also get the AlarmPlayer, which needs the complete Alarm type
+
+#endif //Alarm_h
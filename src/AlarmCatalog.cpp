@@ -0,0 +1,209 @@
+#include "AlarmCatalog.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char AlarmCatalog::MAGIC[8] = {'A', 'L', 'R', 'M', 'C', 'T', 'L', 'G'};
+const std::uint32_t AlarmCatalog::VERSION;
+const std::uint32_t AlarmCatalog::ORDER_MARK;
+
+static_assert(sizeof(AlarmCatalogHeader) == 40, "AlarmCatalogHeader layout is part of the file format");
+static_assert(sizeof(AlarmCatalogEntry) == 48, "AlarmCatalogEntry layout is part of the file format");
+static_assert(sizeof(unsigned long long) == 8, "Edges are read in place as 64-bit words");
+
+// Little-endian encoding, the format of the file whatever the host
+static void put32(char* output, std::uint32_t value){
+    for(int i=0;i<4;i++) output[i] = char((value >> (8*i)) & 0xFF);
+}
+
+static void put64(char* output, std::uint64_t value){
+    put32(output, std::uint32_t(value & 0xFFFFFFFF));
+    put32(output + 4, std::uint32_t(value >> 32));
+}
+
+static std::uint64_t align(std::uint64_t offset, std::uint64_t alignment){
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Tones are read in place, which requires the 31-bit duration in the low bits and the beep in the high bit
+static bool nativeTones(){
+    AlarmTone tone(1, true);
+    std::uint32_t raw;
+    std::memcpy(&raw, &tone, sizeof(raw));
+    return raw == 0x80000001u;
+}
+
+bool AlarmCatalog::write(const std::string& path, const std::vector<AlarmCatalogPattern>& patterns){
+    std::vector<const AlarmCatalogPattern*> sorted;
+    sorted.reserve(patterns.size());
+    for(const AlarmCatalogPattern& pattern : patterns){
+        if(pattern.tones.size() > 0xFFFFFFFFull || pattern.name.size() > 0xFFFFFFFFull) return false;
+        sorted.push_back(&pattern);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const AlarmCatalogPattern* a, const AlarmCatalogPattern* b){ return a->name < b->name; });
+    for(std::size_t i=1;i<sorted.size();i++) if(sorted[i-1]->name == sorted[i]->name) return false;
+
+    // Layout: header, entries, edges, tones and names, each table aligned on its word size
+    std::uint64_t entries = align(sizeof(AlarmCatalogHeader), 8);
+    std::uint64_t edges = entries + sorted.size() * sizeof(AlarmCatalogEntry);
+    std::uint64_t tones = edges;
+    for(const AlarmCatalogPattern* pattern : sorted) if(pattern->tones.size() > AlarmSequence::INLINE_CAPACITY) tones += pattern->tones.size() * 8;
+    std::uint64_t names = tones;
+    for(const AlarmCatalogPattern* pattern : sorted) names += pattern->tones.size() * 4;
+    std::uint64_t size = names;
+    for(const AlarmCatalogPattern* pattern : sorted) size += pattern->name.size();
+    std::vector<char> file(size, 0);
+
+    std::copy(MAGIC, MAGIC + 8, file.data());
+    put32(&file[8], VERSION);
+    put32(&file[12], ORDER_MARK);
+    put64(&file[16], size);
+    put64(&file[24], sorted.size());
+    put64(&file[32], entries);
+    for(std::size_t i=0;i<sorted.size();i++){
+        const AlarmCatalogPattern& pattern = *sorted[i];
+        // Durations are precomputed, as AlarmSequence::create() does
+        unsigned long long duration = 0;
+        unsigned int uniform = pattern.tones.empty() ? 0 : pattern.tones[0].duration;
+        bool edged = pattern.tones.size() > AlarmSequence::INLINE_CAPACITY;
+        for(std::size_t t=0;t<pattern.tones.size();t++){
+            const AlarmTone& tone = pattern.tones[t];
+            duration += tone.duration;
+            if(tone.duration != uniform) uniform = 0;
+            put32(&file[tones + t*4], std::uint32_t(tone.duration) | (std::uint32_t(tone.beep) << 31));
+            if(edged) put64(&file[edges + t*8], duration);
+        }
+        std::copy(pattern.name.begin(), pattern.name.end(), &file[names]);
+
+        char* entry = &file[entries + i * sizeof(AlarmCatalogEntry)];
+        put64(entry, names);
+        put64(entry + 8, tones);
+        put64(entry + 16, edged ? edges : 0);
+        put64(entry + 24, duration);
+        put32(entry + 32, std::uint32_t(pattern.name.size()));
+        put32(entry + 36, std::uint32_t(pattern.tones.size()));
+        put32(entry + 40, uniform);
+        put32(entry + 44, std::uint32_t(pattern.level));
+
+        if(edged) edges += pattern.tones.size() * 8;
+        tones += pattern.tones.size() * 4;
+        names += pattern.name.size();
+    }
+
+    std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!output.write(file.data(), file.size())) return false;
+    output.close();
+    return !output.fail();
+}
+
+AlarmCatalog::AlarmCatalog(const std::string& path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return;
+    struct stat status;
+    if(::fstat(fd, &status) == 0 && std::size_t(status.st_size) >= sizeof(AlarmCatalogHeader)){
+        void* data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED){
+            m_data = static_cast<const char*>(data);
+            m_size = status.st_size;
+        }
+    }
+    ::close(fd); // The mapping stays valid
+    if(!m_data) return;
+
+    // Only the header is checked, entries are trusted until verify()
+    const AlarmCatalogHeader* header = reinterpret_cast<const AlarmCatalogHeader*>(m_data);
+    bool valid = std::equal(MAGIC, MAGIC + 8, header->magic) && header->version == VERSION && header->byteOrder == ORDER_MARK
+        && header->size == m_size && header->entries % 8 == 0 && header->entries <= m_size
+        && header->count <= (m_size - header->entries) / sizeof(AlarmCatalogEntry) && nativeTones();
+    if(!valid){
+        ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+        return;
+    }
+    m_entries = reinterpret_cast<const AlarmCatalogEntry*>(m_data + header->entries);
+    m_count = header->count;
+}
+
+AlarmCatalog::~AlarmCatalog(){
+    if(m_data) ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+bool AlarmCatalog::isOpen() const {
+    return m_data != nullptr;
+}
+
+bool AlarmCatalog::verify() const {
+    if(!m_data) return false;
+    for(std::size_t i=0;i<m_count;i++){
+        const AlarmCatalogEntry& entry = this->entry(i);
+        if(entry.name > m_size || entry.nameSize > m_size - entry.name) return false;
+        if(entry.tones % 4 || entry.tones > m_size || entry.size > (m_size - entry.tones) / 4) return false;
+        if(entry.edges && (entry.edges % 8 || entry.edges > m_size || entry.size > (m_size - entry.edges) / 8)) return false;
+        if(entry.level > (std::uint32_t)AlarmLevel::HIGH) return false;
+        if(i && this->name(i-1) >= this->name(i)) return false; // Sorted and unique, for find()
+        // Precomputed timeline, the player relies on it
+        const AlarmTone* tones = reinterpret_cast<const AlarmTone*>(m_data + entry.tones);
+        const unsigned long long* edges = entry.edges ? reinterpret_cast<const unsigned long long*>(m_data + entry.edges) : nullptr;
+        unsigned long long duration = 0;
+        unsigned int uniform = entry.size ? tones[0].duration : 0;
+        for(std::size_t t=0;t<entry.size;t++){
+            duration += tones[t].duration;
+            if(tones[t].duration != uniform) uniform = 0;
+            if(edges && edges[t] != duration) return false;
+        }
+        if(entry.duration != duration || entry.uniform != uniform) return false;
+    }
+    return true;
+}
+
+std::size_t AlarmCatalog::size() const {
+    return m_count;
+}
+
+std::size_t AlarmCatalog::find(const std::string& name) const {
+    // Entries are sorted by name: binary search comparing the mapped names in place
+    std::size_t low = 0, high = m_count;
+    while(low < high){
+        std::size_t middle = low + (high - low) / 2;
+        const AlarmCatalogEntry& entry = this->entry(middle);
+        int order = std::memcmp(m_data + entry.name, name.data(), std::min<std::size_t>(entry.nameSize, name.size()));
+        if(!order) order = entry.nameSize < name.size() ? -1 : entry.nameSize > name.size() ? 1 : 0;
+        if(!order) return middle;
+        if(order < 0) low = middle + 1;
+        else high = middle;
+    }
+    return m_count;
+}
+
+std::string AlarmCatalog::name(std::size_t index) const {
+    const AlarmCatalogEntry& entry = this->entry(index);
+    return std::string(m_data + entry.name, entry.nameSize);
+}
+
+AlarmLevel AlarmCatalog::level(std::size_t index) const {
+    return AlarmLevel(this->entry(index).level);
+}
+
+AlarmSequence AlarmCatalog::sequence(std::size_t index) const {
+    const AlarmCatalogEntry& entry = this->entry(index);
+    const unsigned long long* edges = entry.edges ? reinterpret_cast<const unsigned long long*>(m_data + entry.edges) : nullptr;
+    return AlarmSequence(reinterpret_cast<const AlarmTone*>(m_data + entry.tones), entry.size, edges, entry.duration, entry.uniform);
+}
+
+Alarm AlarmCatalog::create(std::size_t index) const {
+    return Alarm(this->sequence(index), this->level(index));
+}
+
+Alarm AlarmCatalog::create(const std::string& name) const {
+    std::size_t index = this->find(name);
+    return index < m_count ? this->create(index) : Alarm();
+}
+
+const AlarmCatalogEntry& AlarmCatalog::entry(std::size_t index) const {
+    return m_entries[index];
+}
@@ -0,0 +1,160 @@
+/**
+ *  @file   AlarmCatalog.h
+ *  @brief  Define the AlarmCatalog, a memory-mapped binary catalog of named alarm patterns
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmCatalog_h
+#define AlarmCatalog_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Alarm.h"
+
+/**
+ * @brief Named pattern written to a catalog by \see AlarmCatalog::write()
+ */
+struct AlarmCatalogPattern {
+    std::string name; /**< Unique name of the pattern */
+    AlarmLevel level = AlarmLevel::LOW; /**< Level of the alarms created from the pattern */
+    std::vector<AlarmTone> tones; /**< Tones of the pattern */
+};
+
+/**
+ * @brief Header of a catalog file
+ * A catalog is little-endian and made of this header, the entries sorted by name, the edges of the long patterns
+ * (8-byte words), the packed tones (\see AlarmTone layout, 4-byte words) and the names, every offset being in bytes
+ * from the begining of the file. The tables are laid out as the \see AlarmSequence reads them, so they are used in place.
+ */
+struct AlarmCatalogHeader {
+    char magic[8]; /**< \see AlarmCatalog::MAGIC */
+    std::uint32_t version; /**< \see AlarmCatalog::VERSION */
+    std::uint32_t byteOrder; /**< \see AlarmCatalog::ORDER_MARK as written by the host, detects foreign byte orders */
+    std::uint64_t size; /**< Size of the file, detects truncation */
+    std::uint64_t count; /**< Number of entries */
+    std::uint64_t entries; /**< Offset of the entries */
+};
+
+/**
+ * @brief Pattern of a catalog file, see \see AlarmCatalogHeader
+ */
+struct AlarmCatalogEntry {
+    std::uint64_t name; /**< Offset of the name, not null-terminated */
+    std::uint64_t tones; /**< Offset of the tones */
+    std::uint64_t edges; /**< Offset of the cumulative tone end times in milliseconds, 0 for short patterns scanned linearly */
+    std::uint64_t duration; /**< Duration of a cycle of the pattern in milliseconds */
+    std::uint32_t nameSize; /**< Length of the name */
+    std::uint32_t size; /**< Number of tones */
+    std::uint32_t uniform; /**< Duration shared by every tone, 0 if durations differ */
+    std::uint32_t level; /**< \see AlarmLevel of the pattern */
+};
+
+/**
+ * @brief Read-only catalog of named alarm patterns, memory-mapped from a file produced by \see write()
+ * Opening only maps the file and checks its header: there is no parsing, whatever the number of patterns.
+ * Alarms created from the catalog reference its tones in place, without copy nor allocation.
+ * The catalog is trusted as produced by \see write(), \see verify() checks a file of unknown origin.
+ * \warning The catalog must outlive the Alarms created from it
+ */
+class AlarmCatalog {
+public:
+    static const char MAGIC[8]; /**< First bytes of a catalog file */
+    static const std::uint32_t VERSION = 1; /**< Version of the format read and written */
+    static const std::uint32_t ORDER_MARK = 0x01020304; /**< Byte-order mark */
+
+    /**
+     * @brief Writes a catalog file
+     * \param path : the path of the file
+     * \param patterns : the patterns, in any order
+     * \return false if the file can't be written, a name is duplicated or a pattern has more than 2^32 tones
+     */
+    static bool write(const std::string& path, const std::vector<AlarmCatalogPattern>& patterns);
+
+    /**
+     * @brief Maps a catalog file
+     * \param path : the path of the file, \see isOpen() tells wether it is a valid catalog
+     */
+    explicit AlarmCatalog(const std::string& path);
+
+    /**
+     * @brief Unmaps the catalog file
+     */
+    ~AlarmCatalog();
+
+    /**
+     * @brief Wether the file has been mapped and its header is valid
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Checks every entry of the catalog: offsets, names order and precomputed durations
+     * This reads the whole file, which opening doesn't
+     * \return true if the catalog is valid
+     */
+    bool verify() const;
+
+    /**
+     * @brief Number of patterns
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Looks a pattern up by name, by binary search in the mapped names
+     * \param name : the name of the pattern
+     * \return the index of the pattern, \see size() if there is none
+     */
+    std::size_t find(const std::string& name) const;
+
+    /**
+     * @brief Getter of the name of a pattern
+     * \param index : the index of the pattern, must be lower than \see size()
+     */
+    std::string name(std::size_t index) const;
+
+    /**
+     * @brief Getter of the level of a pattern
+     * \param index : the index of the pattern, must be lower than \see size()
+     */
+    AlarmLevel level(std::size_t index) const;
+
+    /**
+     * @brief Getter of the tones of a pattern, referenced in the mapped file
+     * \param index : the index of the pattern, must be lower than \see size()
+     * \return the sequence, its tones and edges being valid as long as the catalog
+     */
+    AlarmSequence sequence(std::size_t index) const;
+
+    /**
+     * @brief Creates an Alarm playing a pattern, at the level of the pattern
+     * \param index : the index of the pattern, must be lower than \see size()
+     * \return the Alarm, referencing the tones in the mapped file
+     */
+    Alarm create(std::size_t index) const;
+
+    /**
+     * @brief Creates an Alarm playing a pattern looked up by name, \see find()
+     * \param name : the name of the pattern
+     * \return the Alarm, an Alarm without tone if there is no such pattern
+     */
+    Alarm create(const std::string& name) const;
+
+private:
+    /**
+     * @brief Getter of an entry, without bounds checking
+     */
+    const AlarmCatalogEntry& entry(std::size_t index) const;
+
+    const char* m_data = nullptr; /**< Mapped file, nullptr if not open */
+    std::size_t m_size = 0; /**< Size of the mapping */
+    const AlarmCatalogEntry* m_entries = nullptr; /**< Entries in the mapping */
+    std::size_t m_count = 0; /**< Number of entries */
+
+    AlarmCatalog& operator= (const AlarmCatalog&) = delete;
+    AlarmCatalog (const AlarmCatalog&) = delete;
+};
+
+#endif //AlarmCatalog_h
@@ -0,0 +1,51 @@
+#include "AlarmClock.h"
+#include "AlarmScheduler.h"
+#include <algorithm>
+
+AlarmSteadyClock& AlarmSteadyClock::Instance() {
+    static AlarmSteadyClock instance;
+    return instance;
+}
+
+std::chrono::steady_clock::time_point AlarmSteadyClock::now(){
+    return std::chrono::steady_clock::now();
+}
+
+AlarmManualClock::AlarmManualClock(std::chrono::steady_clock::time_point start) : m_now(start.time_since_epoch().count()) {
+
+}
+
+std::chrono::steady_clock::time_point AlarmManualClock::now(){
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_now.load()));
+}
+
+void AlarmManualClock::advance(std::chrono::steady_clock::duration duration){
+    this->advanceTo(this->now() + std::max(duration, std::chrono::steady_clock::duration::zero()));
+}
+
+void AlarmManualClock::advanceTo(std::chrono::steady_clock::time_point time){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    while(true){
+        // Jump to the earliest deadline not after the target, every scheduler being updated at each step
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max(), deadline;
+        for(AlarmScheduler* scheduler : m_schedulers){
+            if(scheduler->nextDeadline(deadline)) next = std::min(next, deadline);
+        }
+        if(next > time) break;
+        std::chrono::steady_clock::time_point now = std::max(next, this->now()); // Past deadlines are due now
+        m_now = now.time_since_epoch().count();
+        for(AlarmScheduler* scheduler : m_schedulers) scheduler->advance(now);
+    }
+    if(time > this->now()) m_now = time.time_since_epoch().count();
+}
+
+bool AlarmManualClock::attach(AlarmScheduler* scheduler){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_schedulers.push_back(scheduler);
+    return true;
+}
+
+void AlarmManualClock::detach(AlarmScheduler* scheduler){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_schedulers.erase(std::remove(m_schedulers.begin(), m_schedulers.end(), scheduler), m_schedulers.end());
+}
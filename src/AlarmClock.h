@@ -0,0 +1,109 @@
+/**
+ *  @file   AlarmClock.h
+ *  @brief  Define the AlarmClock time source and its steady and manual implementations
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmClock_h
+#define AlarmClock_h
+
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class AlarmScheduler; //Forward-declaration of the AlarmScheduler class
+
+/**
+ * @brief Time source of an \see AlarmScheduler and of its players
+ * Times are steady_clock time points whatever the clock, so tone edges and positions keep the same types.
+ */
+class AlarmClock {
+friend AlarmScheduler;
+public:
+    virtual ~AlarmClock() {}
+
+    /**
+     * @brief Getter of the current time
+     * \warning Called by the scheduler thread while players are locked, must not block
+     */
+    virtual std::chrono::steady_clock::time_point now() = 0;
+
+protected:
+    /**
+     * @brief Called by a scheduler built on this clock
+     * \param scheduler : the new scheduler
+     * \return true if the clock drives the scheduler itself, which then starts no thread, false otherwise
+     */
+    virtual bool attach(AlarmScheduler* scheduler) { (void)scheduler; return false; }
+
+    /**
+     * @brief Called by a scheduler built on this clock when it is destroyed
+     * \param scheduler : the destroyed scheduler
+     */
+    virtual void detach(AlarmScheduler* scheduler) { (void)scheduler; }
+};
+
+/**
+ * @brief Real time clock, reading std::chrono::steady_clock
+ * Schedulers run their own thread, sleeping until the next tone edge
+ */
+class AlarmSteadyClock : public AlarmClock {
+public:
+    /**
+     * @brief Getter of the clock used by default by every \see AlarmScheduler
+     */
+    static AlarmSteadyClock& Instance();
+
+    std::chrono::steady_clock::time_point now() override;
+};
+
+/**
+ * @brief Virtual clock only moving when advanced, for deterministic tests and simulations
+ * Schedulers built on a manual clock start no thread: \see advance() updates their players in the calling thread,
+ * at the exact time of every tone edge, and edges are written to their sink before it returns.
+ * Simulating hours of playback therefore takes no longer than the processing of its edges.
+ * Example:
+ *   AlarmManualClock clock;
+ *   AlarmScheduler scheduler(clock);
+ *   AlarmPlayer player(sink, scheduler);
+ *   alarm.setPlayer(player);
+ *   alarm.start();
+ *   clock.advance(std::chrono::seconds(10)); // Plays 10 seconds of the alarm
+ */
+class AlarmManualClock : public AlarmClock {
+public:
+    /**
+     * @brief Constructor of an AlarmManualClock
+     * \param start : the initial time of the clock
+     */
+    explicit AlarmManualClock(std::chrono::steady_clock::time_point start = std::chrono::steady_clock::time_point());
+
+    std::chrono::steady_clock::time_point now() override;
+
+    /**
+     * @brief Moves the clock forward, updating the players of its schedulers at every deadline met on the way
+     * Updates requested for the current time (e.g. by starting an alarm) are processed even for a null duration
+     * \param duration : the duration to advance by, negative durations only process the pending updates
+     * \warning Must not be called from an \see AlarmSink written by one of its schedulers
+     */
+    void advance(std::chrono::steady_clock::duration duration);
+
+    /**
+     * @brief Moves the clock forward to a time, \see advance()
+     * \param time : the time to advance to, the clock never moves backward
+     */
+    void advanceTo(std::chrono::steady_clock::time_point time);
+
+protected:
+    bool attach(AlarmScheduler* scheduler) override;
+    void detach(AlarmScheduler* scheduler) override;
+
+private:
+    std::atomic<std::chrono::steady_clock::rep> m_now; /**< Current time since the clock epoch, read without lock */
+    std::vector<AlarmScheduler*> m_schedulers; /**< Schedulers driven by this clock */
+    std::mutex m_mtx; /**< Protects the schedulers and serializes the advances */
+};
+
+#endif //AlarmClock_h
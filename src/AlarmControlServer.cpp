@@ -0,0 +1,392 @@
+#include "AlarmControlServer.h"
+#include "AlarmPatternCompiler.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const std::size_t AlarmControlServer::MAX_LINE;
+const std::size_t AlarmControlServer::MAX_OUTPUT;
+
+namespace {
+
+const char* LEVELS[] = {"LOW", "MEDIUM", "HIGH"};
+const char* STATES[] = {"IDLE", "STARTED", "PLAYING", "PREEMPTED"};
+const std::size_t READ_SIZE = 64 * 1024; /**< Bytes read from a client at once */
+
+bool parseLevel(const std::string& text, AlarmLevel& level){
+    for(int i=0;i<3;i++){
+        if(text == LEVELS[i]){
+            level = AlarmLevel(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Splits a command line in whitespace-separated tokens
+ */
+class Tokens {
+public:
+    Tokens(const char* line, std::size_t length) : m_line(line), m_end(line + length) {}
+
+    std::string next(){
+        while(m_line < m_end && (*m_line == ' ' || *m_line == '\t')) m_line++;
+        const char* begin = m_line;
+        while(m_line < m_end && *m_line != ' ' && *m_line != '\t') m_line++;
+        return std::string(begin, m_line);
+    }
+
+    const char* rest() const { return m_line; }
+    std::size_t restSize() const { return m_end - m_line; }
+
+private:
+    const char* m_line; /**< Start of the remaining text */
+    const char* m_end; /**< End of the line */
+};
+
+}
+
+AlarmControlServer::AlarmControlServer(const std::string& path, AlarmPlayer& player)
+ : m_path(path), m_player(player), m_state(ServeState::IDLE), m_commands(0), m_clientCount(0) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.empty() || path.size() >= sizeof(address.sun_path)) return;
+    std::copy(path.begin(), path.end(), address.sun_path);
+
+    m_listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ::unlink(path.c_str()); // A socket left by a previous process
+    epoll_event listener = {}, wakeup = {};
+    listener.events = EPOLLIN;
+    listener.data.fd = m_listener;
+    wakeup.events = EPOLLIN;
+    wakeup.data.fd = m_wakeup;
+    bool valid = m_listener >= 0 && m_epoll >= 0 && m_wakeup >= 0
+        && ::bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0
+        && ::listen(m_listener, SOMAXCONN) == 0
+        && ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listener, &listener) == 0
+        && ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &wakeup) == 0;
+    if(!valid){
+        for(int fd : {m_listener, m_epoll, m_wakeup}) if(fd >= 0) ::close(fd);
+        m_listener = m_epoll = m_wakeup = -1;
+    }
+}
+
+AlarmControlServer::~AlarmControlServer(){
+    this->stop();
+    for(const std::pair<const int, std::unique_ptr<Client>>& client : m_clients) ::close(client.first);
+    if(m_listener < 0) return;
+    for(int fd : {m_listener, m_epoll, m_wakeup}) ::close(fd);
+    ::unlink(m_path.c_str());
+}
+
+bool AlarmControlServer::isOpen() const {
+    return m_listener >= 0;
+}
+
+void AlarmControlServer::define(const std::string& name, AlarmSequence::Ptr sequence, AlarmLevel level){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    this->defineLocked(name, std::move(sequence), level);
+    // Subscribers are written to by the loop
+    if(m_wakeup >= 0 && !m_dirty.empty()){
+        std::uint64_t one = 1;
+        ssize_t written = ::write(m_wakeup, &one, sizeof(one));
+        (void)written; // Already woken up if the counter is full
+    }
+}
+
+bool AlarmControlServer::run(){
+    ServeState idle = ServeState::IDLE;
+    if(m_listener < 0 || !m_state.compare_exchange_strong(idle, ServeState::SERVING)) return false;
+    this->serve();
+    return true;
+}
+
+bool AlarmControlServer::start(){
+    ServeState idle = ServeState::IDLE;
+    if(m_listener < 0 || !m_state.compare_exchange_strong(idle, ServeState::SERVING)) return false;
+    if(m_thread.joinable()) m_thread.join();
+    m_thread = std::thread(&AlarmControlServer::serve, this);
+    return true;
+}
+
+void AlarmControlServer::stop(){
+    if(m_listener < 0) return;
+    // Only a serving loop is asked to stop, an idle server stays ready for the next start() or run()
+    ServeState serving = ServeState::SERVING;
+    m_state.compare_exchange_strong(serving, ServeState::STOPPING);
+    std::uint64_t one = 1;
+    ssize_t written = ::write(m_wakeup, &one, sizeof(one));
+    (void)written;
+    if(m_thread.joinable() && m_thread.get_id() != std::this_thread::get_id()) m_thread.join();
+}
+
+unsigned long long AlarmControlServer::getCommandCount() const {
+    return m_commands.load(std::memory_order_relaxed);
+}
+
+std::size_t AlarmControlServer::getClientCount() const {
+    return m_clientCount.load(std::memory_order_relaxed);
+}
+
+void AlarmControlServer::serve(){
+    epoll_event events[64];
+    while(m_state.load() == ServeState::SERVING){
+        int count = ::epoll_wait(m_epoll, events, 64, -1);
+        if(count < 0 && errno != EINTR) break;
+        std::lock_guard<std::mutex> lock(m_mtx);
+        for(int i=0;i<count;i++){
+            int fd = events[i].data.fd;
+            if(fd == m_wakeup){
+                std::uint64_t value;
+                ssize_t read = ::read(m_wakeup, &value, sizeof(value));
+                (void)read;
+            }
+            else if(fd == m_listener) this->accept();
+            else {
+                std::unordered_map<int, std::unique_ptr<Client>>::iterator client = m_clients.find(fd);
+                if(client == m_clients.end()) continue; // Closed by an earlier event
+                bool alive = true;
+                if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = this->receive(*client->second);
+                if(alive && (events[i].events & EPOLLOUT)) alive = this->flush(*client->second);
+                if(!alive) this->close(fd);
+            }
+        }
+        // Replies and events are written once per iteration, whatever the number of commands
+        std::vector<Client*> dirty;
+        dirty.swap(m_dirty);
+        for(Client* client : dirty){
+            client->dirty = false;
+            if(!this->flush(*client)) this->close(client->fd);
+        }
+    }
+    m_state = ServeState::IDLE;
+}
+
+void AlarmControlServer::accept(){
+    for(;;){
+        int fd = ::accept4(m_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) return; // No more pending connection
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if(::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0){
+            ::close(fd);
+            continue;
+        }
+        std::unique_ptr<Client> client(new Client());
+        client->fd = fd;
+        m_clients[fd] = std::move(client);
+        m_clientCount = m_clients.size();
+    }
+}
+
+bool AlarmControlServer::receive(Client& client){
+    char buffer[READ_SIZE];
+    ssize_t size = ::read(client.fd, buffer, sizeof(buffer));
+    if(size == 0) return false;
+    if(size < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    client.input.append(buffer, size);
+
+    // Every complete line is processed before anything is written
+    std::size_t begin = 0, end;
+    while((end = client.input.find('\n', begin)) != std::string::npos){
+        std::size_t length = end - begin;
+        if(length && client.input[end - 1] == '\r') length--;
+        if(length) this->process(client, client.input.data() + begin, length);
+        begin = end + 1;
+    }
+    client.input.erase(0, begin);
+    if(client.input.size() > MAX_LINE){
+        client.output += "error line too long\n";
+        this->flush(client);
+        return false;
+    }
+    return true;
+}
+
+bool AlarmControlServer::flush(Client& client){
+    while(!client.output.empty()){
+        ssize_t size = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(size < 0){
+            if(errno == EINTR) continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            if(!client.writing){ // Resumed when writable
+                epoll_event event = {};
+                event.events = EPOLLIN | EPOLLOUT;
+                event.data.fd = client.fd;
+                ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, client.fd, &event);
+                client.writing = true;
+            }
+            return client.output.size() <= MAX_OUTPUT;
+        }
+        client.output.erase(0, size);
+    }
+    if(client.writing){
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = client.fd;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, client.fd, &event);
+        client.writing = false;
+    }
+    return true;
+}
+
+void AlarmControlServer::process(Client& client, const char* line, std::size_t length){
+    m_commands.fetch_add(1, std::memory_order_relaxed);
+    this->markDirty(client);
+    Tokens tokens(line, length);
+    std::string command = tokens.next();
+    std::string& output = client.output;
+
+    if(command == "ping"){
+        output += "ok\n";
+        return;
+    }
+    if(command == "subscribe"){
+        client.subscribed = true;
+        output += "ok\n";
+        return;
+    }
+    if(command == "begin"){
+        if(client.batching){
+            output += "error already in a batch\n";
+            return;
+        }
+        client.batching = true;
+        output += "ok\n";
+        return;
+    }
+    if(command == "commit"){
+        if(!client.batching){
+            output += "error not in a batch\n";
+            return;
+        }
+        m_player.apply(client.batch);
+        output += "ok " + std::to_string(client.batch.size()) + "\n";
+        for(std::size_t i=0;i<client.batch.size();i++){
+            static const char* changes[] = {"started", "stopped", "level", "acknowledged"};
+            const std::string& name = client.batchEvents[i].first;
+            this->notify(name, changes[(int)client.batchEvents[i].second], m_alarms.find(name)->second.getLevel());
+        }
+        client.batching = false;
+        client.batch.clear();
+        client.batchEvents.clear();
+        return;
+    }
+
+    std::string name = tokens.next();
+    if(command == "define"){
+        AlarmLevel level;
+        if(client.batching) output += "error define in a batch\n";
+        else if(name.empty()) output += "error expected a name\n";
+        else if(!parseLevel(tokens.next(), level)) output += "error expected a level LOW, MEDIUM or HIGH\n";
+        else {
+            AlarmPatternError error;
+            std::size_t start = tokens.rest() - line;
+            AlarmSequence::Ptr sequence = AlarmPatternCompiler::compile(tokens.rest(), tokens.restSize(), &error);
+            if(!sequence) output += std::string("error ") + error.message + " at " + std::to_string(start + error.position) + "\n";
+            else {
+                output += "ok\n"; // Before the event, if the client subscribed
+                this->defineLocked(name, sequence, level);
+            }
+        }
+        return;
+    }
+    if(command != "start" && command != "stop" && command != "level" && command != "ack" && command != "state"){
+        output += "error unknown command\n";
+        return;
+    }
+    std::map<std::string, Alarm>::iterator alarm = m_alarms.find(name);
+    if(alarm == m_alarms.end()){
+        output += "error unknown alarm\n";
+        return;
+    }
+    if(command == "state"){
+        output += "state " + name + " " + STATES[(int)alarm->second.getState()] + " " + LEVELS[(int)alarm->second.getLevel()] + "\n";
+        return;
+    }
+    AlarmChange change;
+    if(command == "start") change = AlarmChange::start(alarm->second);
+    else if(command == "stop") change = AlarmChange::stop(alarm->second);
+    else if(command == "ack") change = AlarmChange::acknowledge(alarm->second);
+    else {
+        AlarmLevel level;
+        if(!parseLevel(tokens.next(), level)){
+            output += "error expected a level LOW, MEDIUM or HIGH\n";
+            return;
+        }
+        change = AlarmChange::setLevel(alarm->second, level);
+    }
+    if(client.batching){
+        client.batch.push_back(change);
+        client.batchEvents.push_back(std::make_pair(name, change.type));
+        output += "queued\n";
+        return;
+    }
+    output += "ok\n";
+    switch(change.type){
+        case AlarmChange::Type::START:
+            alarm->second.start();
+            this->notify(name, "started", alarm->second.getLevel());
+            break;
+        case AlarmChange::Type::STOP:
+            alarm->second.stop();
+            this->notify(name, "stopped", alarm->second.getLevel());
+            break;
+        case AlarmChange::Type::SET_LEVEL:
+            alarm->second.setLevel(change.level);
+            this->notify(name, "level", change.level);
+            break;
+        case AlarmChange::Type::ACKNOWLEDGE:
+            alarm->second.acknowledge();
+            this->notify(name, "acknowledged", alarm->second.getLevel());
+            break;
+    }
+}
+
+void AlarmControlServer::defineLocked(const std::string& name, AlarmSequence::Ptr sequence, AlarmLevel level){
+    std::map<std::string, Alarm>::iterator alarm = m_alarms.find(name);
+    if(alarm == m_alarms.end()){
+        alarm = m_alarms.emplace(name, Alarm(std::move(sequence), level)).first;
+        alarm->second.setPlayer(m_player);
+    }
+    else {
+        alarm->second.setSequence(std::move(sequence));
+        alarm->second.setLevel(level);
+    }
+    this->notify(name, "defined", level);
+}
+
+void AlarmControlServer::notify(const std::string& name, const char* change, AlarmLevel level){
+    for(const std::pair<const int, std::unique_ptr<Client>>& client : m_clients){
+        if(!client.second->subscribed) continue;
+        client.second->output += "event " + name + " " + change + " " + LEVELS[(int)level] + "\n";
+        this->markDirty(*client.second);
+    }
+}
+
+void AlarmControlServer::markDirty(Client& client){
+    if(client.dirty) return;
+    client.dirty = true;
+    m_dirty.push_back(&client);
+}
+
+void AlarmControlServer::close(int fd){
+    std::unordered_map<int, std::unique_ptr<Client>>::iterator client = m_clients.find(fd);
+    if(client == m_clients.end()) return;
+    m_dirty.erase(std::remove(m_dirty.begin(), m_dirty.end(), client->second.get()), m_dirty.end());
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_clients.erase(client);
+    m_clientCount = m_clients.size();
+}
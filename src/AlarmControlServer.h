@@ -0,0 +1,189 @@
+/**
+ *  @file   AlarmControlServer.h
+ *  @brief  Define the AlarmControlServer, controlling named alarms from local clients over a Unix domain socket
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmControlServer_h
+#define AlarmControlServer_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "Alarm.h"
+#include "AlarmPlayer.h"
+
+/**
+ * @brief Server of a line-based control protocol on a Unix domain socket, owning named alarms
+ * A single thread multiplexes every client with epoll: sockets are non-blocking, each readable client has all its
+ * complete lines processed before the replies are written at once, so pipelined requests cost one read and one write.
+ * Every command line gets exactly one reply line, in order:
+ *  - define <name> <LOW|MEDIUM|HIGH> <pattern> : creates or replaces an alarm, \see AlarmPatternCompiler, replies "ok"
+ *  - start <name>, stop <name>, level <name> <LOW|MEDIUM|HIGH>, ack <name> : changes an alarm, replies "ok",
+ *    ack acknowledging it, \see Alarm::acknowledge()
+ *  - begin, then start, stop, level or ack commands replied "queued", then commit : applies the queued changes
+ *    as one \see AlarmPlayer::apply() transaction, replies "ok <count>"
+ *  - state <name> : replies "state <name> <IDLE|STARTED|PLAYING|PREEMPTED> <level>"
+ *  - subscribe : replies "ok", then pushes "event <name> <defined|started|stopped|level|acknowledged> <level>" on every change
+ *  - ping : replies "ok"
+ * An invalid command is replied "error <message>". The serving thread never waits for the playback:
+ * a command costs the same short lock of the \see AlarmPlayer as a direct call, and a batch a single one.
+ */
+class AlarmControlServer {
+public:
+    static const std::size_t MAX_LINE = 4096; /**< Longest command line, a client sending longer lines is disconnected */
+    static const std::size_t MAX_OUTPUT = 1 << 20; /**< Pending reply bytes of a client that doesn't read them, it is disconnected beyond */
+
+    /**
+     * @brief Constructor of an AlarmControlServer, listening on a socket
+     * \param path : the path of the socket, replaced if it exists, \see isOpen() tells wether it is listening
+     * \param player : the player of the alarms defined by clients
+     */
+    explicit AlarmControlServer(const std::string& path, AlarmPlayer& player = AlarmPlayer::Instance());
+
+    /**
+     * @brief Destructor of the AlarmControlServer, stops serving, disconnects the clients and removes the socket
+     * The alarms are destroyed, and so stopped
+     */
+    ~AlarmControlServer();
+
+    /**
+     * @brief Wether the socket is listening
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Creates or replaces a named alarm, as the define command
+     * \param name : the name of the alarm, without whitespace
+     * \param sequence : the sequence of the alarm
+     * \param level : the level of the alarm
+     */
+    void define(const std::string& name, AlarmSequence::Ptr sequence, AlarmLevel level);
+
+    /**
+     * @brief Serves the clients in the calling thread, until \see stop()
+     * \return false if the socket is not listening
+     */
+    bool run();
+
+    /**
+     * @brief Serves the clients in a thread of the server, until \see stop()
+     * \return false if the socket is not listening or the server is already serving
+     */
+    bool start();
+
+    /**
+     * @brief Stops serving, waits for the thread of \see start(), may be called from any thread
+     * No effect if no thread serves: a later \see start() or \see run() serves normally
+     */
+    void stop();
+
+    /**
+     * @brief Number of commands processed since the creation of the server
+     */
+    unsigned long long getCommandCount() const;
+
+    /**
+     * @brief Number of connected clients
+     */
+    std::size_t getClientCount() const;
+
+private:
+    /**
+     * @brief Serving state, changed atomically so a \see stop() never outlives the loop it stops
+     */
+    enum class ServeState {
+        IDLE, /**< No thread serves */
+        SERVING, /**< A thread runs the loop */
+        STOPPING /**< \see stop() asked the loop to return */
+    };
+
+    /**
+     * @brief Event loop, until \see stop()
+     */
+    void serve();
+
+    /**
+     * @brief Connected client
+     */
+    struct Client {
+        int fd = -1; /**< Socket of the client */
+        std::string input; /**< Received bytes not processed yet, an incomplete line */
+        std::string output; /**< Replies and events not written yet */
+        bool subscribed = false; /**< Wether events are pushed to the client */
+        bool dirty = false; /**< Wether the client is in \see m_dirty */
+        bool writing = false; /**< Wether the client waits for its socket to be writable */
+        bool batching = false; /**< Wether commands are queued for a commit */
+        std::vector<AlarmChange> batch; /**< Queued changes */
+        std::vector<std::pair<std::string, AlarmChange::Type>> batchEvents; /**< Events of the queued changes */
+    };
+
+    /**
+     * @brief Accepts the pending connections
+     */
+    void accept();
+
+    /**
+     * @brief Reads from a client and processes its complete lines
+     * \return false if the client disconnected or must be disconnected
+     */
+    bool receive(Client& client);
+
+    /**
+     * @brief Writes the pending output of a client, waiting for the socket to be writable if it is full
+     * \return false if the client must be disconnected
+     */
+    bool flush(Client& client);
+
+    /**
+     * @brief Processes a command line of a client, appending the reply to its output, m_mtx must be locked
+     */
+    void process(Client& client, const char* line, std::size_t length);
+
+    /**
+     * @brief Creates or replaces a named alarm, m_mtx must be locked
+     */
+    void defineLocked(const std::string& name, AlarmSequence::Ptr sequence, AlarmLevel level);
+
+    /**
+     * @brief Pushes an event to the subscribers, m_mtx must be locked
+     */
+    void notify(const std::string& name, const char* change, AlarmLevel level);
+
+    /**
+     * @brief Queues the output of a client for the end of the current loop iteration, m_mtx must be locked
+     */
+    void markDirty(Client& client);
+
+    /**
+     * @brief Disconnects a client
+     */
+    void close(int fd);
+
+    std::string m_path; /**< Path of the socket */
+    AlarmPlayer& m_player; /**< Player of the alarms */
+    int m_listener = -1; /**< Listening socket */
+    int m_epoll = -1; /**< Readiness of the listener, the clients and the wakeup */
+    int m_wakeup = -1; /**< Event counter waking the loop up, written by \see stop() and \see define() */
+    std::mutex m_mtx; /**< Protects the alarms and the clients, held by the loop while it handles events */
+    std::map<std::string, Alarm> m_alarms; /**< Alarms by name */
+    std::unordered_map<int, std::unique_ptr<Client>> m_clients; /**< Clients by socket */
+    std::vector<Client*> m_dirty; /**< Clients with output to write after the current events */
+    std::atomic<ServeState> m_state; /**< Wether a thread serves, and wether it was asked to stop */
+    std::atomic<unsigned long long> m_commands; /**< Number of processed commands */
+    std::atomic<std::size_t> m_clientCount; /**< Number of clients, readable from any thread */
+    std::thread m_thread; /**< Thread started by \see start() */
+
+    AlarmControlServer& operator= (const AlarmControlServer&) = delete;
+    AlarmControlServer (const AlarmControlServer&) = delete;
+};
+
+#endif //AlarmControlServer_h
@@ -0,0 +1,234 @@
+#include "AlarmJournal.h"
+#include "Alarm.h"
+#include "AlarmClock.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char AlarmJournal::MAGIC[8] = {'A', 'L', 'R', 'M', 'J', 'R', 'N', 'L'};
+const std::uint32_t AlarmJournal::VERSION;
+const std::uint32_t AlarmJournal::ORDER_MARK;
+const std::uint32_t AlarmJournal::NO_ALARM;
+const std::uint64_t AlarmJournal::BUSY;
+const std::size_t AlarmJournal::DEFAULT_CAPACITY;
+
+static_assert(sizeof(AlarmJournalHeader) == 64, "AlarmJournalHeader layout is part of the file format");
+static_assert(sizeof(AlarmJournalRecord) == 32, "AlarmJournalRecord layout is part of the file format");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Records are claimed with lock-free 64-bit atomics in the mapping");
+
+AlarmHandle AlarmJournalRecord::handle() const {
+    AlarmHandle handle;
+    if(alarm == AlarmJournal::NO_ALARM) return handle;
+    handle.index = alarm;
+    handle.generation = generation;
+    return handle;
+}
+
+static bool validHeader(const AlarmJournalHeader* header, std::size_t size){
+    return std::equal(AlarmJournal::MAGIC, AlarmJournal::MAGIC + 8, header->magic) && header->version == AlarmJournal::VERSION
+        && header->byteOrder == AlarmJournal::ORDER_MARK && header->capacity
+        && header->capacity <= (size - sizeof(AlarmJournalHeader)) / sizeof(AlarmJournalRecord);
+}
+
+AlarmJournal::AlarmJournal(const std::string& path, std::size_t capacity){
+    capacity = std::max<std::size_t>(capacity, 1);
+    std::size_t size = sizeof(AlarmJournalHeader) + capacity * sizeof(AlarmJournalRecord);
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) return;
+    struct stat status;
+    bool resized = ::fstat(fd, &status) == 0 && std::size_t(status.st_size) == size;
+    if(!resized) resized = ::ftruncate(fd, 0) == 0 && ::ftruncate(fd, size) == 0; // Zero-filled, every record uncommitted
+    void* data = resized ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd); // The mapping stays valid
+    if(data == MAP_FAILED) return;
+    m_data = static_cast<char*>(data);
+    m_size = size;
+    m_header = reinterpret_cast<AlarmJournalHeader*>(m_data);
+    m_records = reinterpret_cast<AlarmJournalRecord*>(m_data + sizeof(AlarmJournalHeader));
+    m_capacity = capacity;
+    std::uint64_t boot[2];
+    currentBoot(boot);
+    if(validHeader(m_header, m_size) && m_header->capacity == capacity && std::equal(boot, boot + 2, m_header->boot)){
+        // Continued after its records, the ones left busy by a crashed writer are given back
+        for(std::uint64_t i=0;i<m_capacity;i++) if(m_records[i].sequence == BUSY) m_records[i].sequence = 0;
+        return;
+    }
+    std::memset(m_data, 0, m_size);
+    std::copy(MAGIC, MAGIC + 8, m_header->magic);
+    m_header->version = VERSION;
+    m_header->byteOrder = ORDER_MARK;
+    m_header->capacity = capacity;
+    std::copy(boot, boot + 2, m_header->boot);
+}
+
+AlarmJournal::~AlarmJournal(){
+    if(m_data) ::munmap(m_data, m_size);
+}
+
+bool AlarmJournal::isOpen() const {
+    return m_data != nullptr;
+}
+
+std::uint64_t AlarmJournal::dropped() const {
+    return m_data ? __atomic_load_n(&m_header->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+void AlarmJournal::currentBoot(std::uint64_t (&boot)[2]){
+    boot[0] = boot[1] = 0;
+    // A random UUID drawn by the kernel at each boot
+    std::ifstream file("/proc/sys/kernel/random/boot_id");
+    std::string id;
+    if(!std::getline(file, id)) return;
+    unsigned int digits = 0;
+    for(char c : id){
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if(digit < 0 || digits >= 32) continue;
+        boot[digits / 16] = boot[digits / 16] << 4 | std::uint64_t(digit);
+        digits++;
+    }
+}
+
+void AlarmJournal::append(AlarmJournalEvent event, std::chrono::steady_clock::time_point time, std::uint16_t zone, AlarmHandle alarm, std::uint8_t value, std::uint32_t other){
+    if(!m_data) return;
+    std::uint64_t sequence = __atomic_fetch_add(&m_header->next, 1, __ATOMIC_RELAXED);
+    AlarmJournalRecord& record = m_records[sequence % m_capacity];
+    // Owned while written, so neither a reader nor the writer of the same slot a ring later mixes two records
+    std::uint64_t previous = __atomic_load_n(&record.sequence, __ATOMIC_RELAXED);
+    do {
+        if(previous == BUSY || previous > sequence){
+            // Still written a ring earlier, or already overwritten a ring later: skipped rather than torn
+            __atomic_fetch_add(&m_header->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while(!__atomic_compare_exchange_n(&record.sequence, &previous, BUSY, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    record.alarm = alarm ? alarm.index : NO_ALARM;
+    record.generation = alarm.generation;
+    record.other = other;
+    record.zone = zone;
+    record.event = event;
+    record.value = value;
+    __atomic_store_n(&record.sequence, sequence + 1, __ATOMIC_RELEASE);
+}
+
+void AlarmJournal::collect(const AlarmJournalHeader* header, std::vector<AlarmJournalRecord>& records){
+    const AlarmJournalRecord* ring = reinterpret_cast<const AlarmJournalRecord*>(reinterpret_cast<const char*>(header) + sizeof(AlarmJournalHeader));
+    std::uint64_t next = __atomic_load_n(&header->next, __ATOMIC_ACQUIRE);
+    std::uint64_t first = next > header->capacity ? next - header->capacity : 0;
+    records.clear();
+    records.reserve(next - first);
+    for(std::uint64_t sequence=first;sequence<next;sequence++){
+        const AlarmJournalRecord& record = ring[sequence % header->capacity];
+        if(__atomic_load_n(&record.sequence, __ATOMIC_ACQUIRE) != sequence + 1) continue; // Being written, or already overwritten
+        AlarmJournalRecord copy;
+        std::memcpy(&copy, &record, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&record.sequence, __ATOMIC_RELAXED) != sequence + 1) continue; // Overwritten while copied
+        copy.sequence = sequence + 1;
+        records.push_back(copy);
+    }
+}
+
+std::vector<AlarmJournalRecord> AlarmJournal::records() const {
+    std::vector<AlarmJournalRecord> records;
+    if(m_data) collect(m_header, records);
+    return records;
+}
+
+bool AlarmJournal::read(const std::string& path, std::vector<AlarmJournalRecord>& records){
+    records.clear();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat status;
+    void* data = MAP_FAILED;
+    if(::fstat(fd, &status) == 0 && std::size_t(status.st_size) >= sizeof(AlarmJournalHeader)){
+        data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if(data == MAP_FAILED) return false;
+    const AlarmJournalHeader* header = static_cast<const AlarmJournalHeader*>(data);
+    bool valid = validHeader(header, status.st_size);
+    if(valid) collect(header, records);
+    ::munmap(data, status.st_size);
+    return valid;
+}
+
+std::vector<AlarmEdge> AlarmJournal::edges(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone){
+    std::vector<AlarmEdge> edges;
+    for(const AlarmJournalRecord& record : records){
+        if(record.zone != zone || record.event != AlarmJournalEvent::EDGE) continue;
+        AlarmEdge edge;
+        edge.time = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.time)));
+        edge.noisy = record.value != 0;
+        edges.push_back(edge);
+    }
+    return edges;
+}
+
+std::vector<AlarmJournalSpan> AlarmJournal::audible(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone){
+    std::vector<AlarmJournalSpan> spans;
+    std::unordered_map<std::uint32_t, AlarmLevel> levels; // Last known level of every alarm
+    bool beeping = false;
+    std::int64_t last = 0;
+    for(const AlarmJournalRecord& record : records){
+        if(record.zone != zone) continue;
+        last = record.time;
+        switch(record.event){
+            case AlarmJournalEvent::START:
+            case AlarmJournalEvent::LEVEL:
+                levels[record.alarm] = AlarmLevel(record.value);
+                break;
+            case AlarmJournalEvent::EDGE:
+                if(beeping) spans.back().end = std::chrono::nanoseconds(record.time); // Any edge ends the beep
+                beeping = record.value != 0;
+                if(beeping){
+                    AlarmJournalSpan span;
+                    span.start = span.end = std::chrono::nanoseconds(record.time);
+                    span.alarm = record.handle();
+                    span.level = levels.count(record.alarm) ? levels[record.alarm] : AlarmLevel::LOW;
+                    spans.push_back(span);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    if(beeping) spans.back().end = std::chrono::nanoseconds(last); // Still beeping when the journal ends
+    return spans;
+}
+
+void AlarmJournal::replay(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone, AlarmManualClock& clock, const std::function<Alarm*(AlarmHandle)>& resolve){
+    std::chrono::steady_clock::duration offset = std::chrono::steady_clock::duration::zero();
+    bool first = true;
+    for(const AlarmJournalRecord& record : records){
+        if(record.zone != zone) continue;
+        std::chrono::steady_clock::time_point time(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(record.time)));
+        if(first){
+            offset = clock.now() - time;
+            first = false;
+        }
+        if(record.event != AlarmJournalEvent::START && record.event != AlarmJournalEvent::STOP && record.event != AlarmJournalEvent::LEVEL) continue;
+        Alarm* alarm = resolve(record.handle());
+        if(!alarm) continue;
+        clock.advanceTo(time + offset);
+        switch(record.event){
+            case AlarmJournalEvent::START:
+                alarm->setLevel(AlarmLevel(record.value));
+                alarm->start(std::chrono::milliseconds(record.other));
+                break;
+            case AlarmJournalEvent::STOP:
+                alarm->stop();
+                break;
+            default:
+                alarm->setLevel(AlarmLevel(record.value));
+                break;
+        }
+    }
+    clock.advance(std::chrono::steady_clock::duration::zero()); // Plays the last event
+}
@@ -0,0 +1,195 @@
+/**
+ *  @file   AlarmJournal.h
+ *  @brief  Define the AlarmJournal, a memory-mapped binary journal of the events of AlarmPlayers
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmJournal_h
+#define AlarmJournal_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include "AlarmPool.h"
+#include "AlarmSink.h"
+
+class Alarm; //Forward-declaration of the Alarm class
+class AlarmManualClock; //Forward-declaration of the AlarmManualClock class
+
+/**
+ * @brief Kind of event of an \see AlarmJournalRecord
+ */
+enum class AlarmJournalEvent : std::uint8_t {
+    START = 1, /**< An alarm is attached, value is its level, other its start position in milliseconds */
+    STOP = 2, /**< An alarm is detached, value is its level */
+    LEVEL = 3, /**< An attached alarm changed level, by \see Alarm::setLevel() or an escalation, value is its new level */
+    EDGE = 4, /**< The player emitted a tone edge for the alarm, null once no alarm is left, value is 1 for a beep and 0 for a silence */
+    PREEMPT = 5 /**< The alarm is paused for another one, other is the index of the played alarm and value its level */
+};
+
+/**
+ * @brief Fixed-size record of a journal, laid out as stored in the file
+ */
+struct AlarmJournalRecord {
+    std::uint64_t sequence; /**< Number of the record plus one, 0 if never written, \see AlarmJournal::BUSY while written */
+    std::int64_t time; /**< Time of the event on the clock of the player, in nanoseconds, only comparable within a boot */
+    std::uint32_t alarm; /**< Index of the handle of the alarm, \see AlarmJournal::NO_ALARM for none */
+    std::uint32_t generation; /**< Generation of the handle of the alarm */
+    std::uint32_t other; /**< Detail of the event, see \see AlarmJournalEvent */
+    std::uint16_t zone; /**< Zone of the player, \see AlarmPlayer::setJournal() */
+    AlarmJournalEvent event; /**< Kind of event */
+    std::uint8_t value; /**< Detail of the event, see \see AlarmJournalEvent */
+
+    /**
+     * @brief Handle of the alarm of the record, a null handle for none
+     */
+    AlarmHandle handle() const;
+};
+
+/**
+ * @brief Header of a journal file, followed by its records in host byte order
+ */
+struct AlarmJournalHeader {
+    char magic[8]; /**< \see AlarmJournal::MAGIC */
+    std::uint32_t version; /**< \see AlarmJournal::VERSION */
+    std::uint32_t byteOrder; /**< \see AlarmJournal::ORDER_MARK as written by the host */
+    std::uint64_t capacity; /**< Number of records of the ring */
+    std::uint64_t next; /**< Number of records appended so far, incremented atomically by the writers */
+    std::uint64_t dropped; /**< Number of records skipped because their slot was still written a whole ring earlier */
+    std::uint64_t boot[2]; /**< Identifier of the boot the times of the records refer to, zero if unknown */
+    std::uint64_t reserved; /**< Zero, pads the header to 64 bytes */
+};
+
+/**
+ * @brief Period an alarm was audible on a zone, reconstructed by \see AlarmJournal::audible()
+ */
+struct AlarmJournalSpan {
+    std::chrono::nanoseconds start; /**< Time of the beep */
+    std::chrono::nanoseconds end; /**< Time of the next edge of the zone, or of the last record */
+    AlarmHandle alarm; /**< The beeping alarm */
+    AlarmLevel level; /**< Level of the alarm at the time of the beep */
+};
+
+/**
+ * @brief Append-only journal of the events of \see AlarmPlayer, stored in a memory-mapped ring of fixed-size records
+ * Appending claims a record with one atomic increment and writes it in the mapping: no lock, no syscall and
+ * no allocation, so a player journals from its hot path. A writer owns the slot of its record by swapping its sequence
+ * number for \see BUSY, and commits it by writing its own sequence number last, readers skip the ones being written.
+ * Once full, the oldest records are overwritten. A writer finding its slot still written by a writer a whole ring
+ * earlier skips its record instead of mixing both, \see dropped(): the capacity must be well above the number of
+ * concurrent writers. The mapping is shared with the file, so the records survive a crash of the process, and a journal
+ * reopened with the same capacity in the same boot continues after them. The times of the clock of a player restart
+ * at each boot, so a journal of another boot is reset: read it with \see read() before reopening it.
+ * Several players may append to a journal, each with its own zone.
+ */
+class AlarmJournal {
+public:
+    static const char MAGIC[8]; /**< First bytes of a journal file */
+    static const std::uint32_t VERSION = 2; /**< Version of the format read and written */
+    static const std::uint32_t ORDER_MARK = 0x01020304; /**< Byte-order mark */
+    static const std::uint32_t NO_ALARM = 0xFFFFFFFF; /**< \see AlarmJournalRecord::alarm of edges without alarm */
+    static const std::uint64_t BUSY = ~std::uint64_t(0); /**< \see AlarmJournalRecord::sequence of a record being written */
+    static const std::size_t DEFAULT_CAPACITY = 1 << 16; /**< Default number of records, 2 MiB */
+
+    /**
+     * @brief Maps a journal file for appending
+     * \param path : the path of the file, created or reset unless it is a journal of the same capacity and boot, which is continued
+     * \param capacity : number of records kept, at least 1, \see isOpen() tells wether the file is mapped
+     */
+    explicit AlarmJournal(const std::string& path, std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Unmaps the journal file, appended records are written back by the system
+     * \warning Players must stop journaling to it first, \see AlarmPlayer::setJournal()
+     */
+    ~AlarmJournal();
+
+    /**
+     * @brief Wether the file is mapped
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Getter of the number of records skipped since the journal was created
+     * A record is skipped when its slot is still written by the writer of the record a whole ring earlier
+     */
+    std::uint64_t dropped() const;
+
+    /**
+     * @brief Appends a record, lock-free and may be called concurrently
+     * \param event : the kind of event
+     * \param time : the time of the event
+     * \param zone : the zone of the player
+     * \param alarm : the alarm of the event, a null handle for none
+     * \param value : the detail of the event, see \see AlarmJournalEvent
+     * \param other : the detail of the event, see \see AlarmJournalEvent
+     */
+    void append(AlarmJournalEvent event, std::chrono::steady_clock::time_point time, std::uint16_t zone, AlarmHandle alarm, std::uint8_t value, std::uint32_t other = 0);
+
+    /**
+     * @brief Getter of the committed records still in the ring
+     * \return the records by sequence number
+     */
+    std::vector<AlarmJournalRecord> records() const;
+
+    /**
+     * @brief Reads the committed records of a journal file
+     * \param path : the path of the file
+     * \param records : receives the records by sequence number
+     * \return false if the file is not a journal
+     */
+    static bool read(const std::string& path, std::vector<AlarmJournalRecord>& records);
+
+    /**
+     * @brief Tone edges emitted on a zone, as its \see AlarmSink received them
+     * \param records : the records, by sequence number
+     * \param zone : the zone
+     */
+    static std::vector<AlarmEdge> edges(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone);
+
+    /**
+     * @brief Reconstructs which alarm was audible when on a zone
+     * \param records : the records, by sequence number
+     * \param zone : the zone
+     * \return the beeps, in time order
+     */
+    static std::vector<AlarmJournalSpan> audible(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone);
+
+    /**
+     * @brief Replays the starts, stops and level changes of a zone on alarms played by a player of a manual clock, to reproduce its playback
+     * The clock is advanced to the time of each event, shifted so the first event of the zone happens now, then the event is applied.
+     * Alarms must have the sequences they had when journaled, without escalation: level changes are replayed as \see Alarm::setLevel()
+     * \param records : the records, by sequence number
+     * \param zone : the zone
+     * \param clock : the clock of the \see AlarmScheduler of the player the alarms are bound to
+     * \param resolve : returns the alarm replaying a journaled handle, nullptr to skip its events
+     */
+    static void replay(const std::vector<AlarmJournalRecord>& records, std::uint16_t zone, AlarmManualClock& clock, const std::function<Alarm*(AlarmHandle)>& resolve);
+
+private:
+    /**
+     * @brief Identifier of the current boot, zero if unknown
+     */
+    static void currentBoot(std::uint64_t (&boot)[2]);
+
+    /**
+     * @brief Copies the committed records of a mapped journal
+     */
+    static void collect(const AlarmJournalHeader* header, std::vector<AlarmJournalRecord>& records);
+
+    char* m_data = nullptr; /**< Mapping of the file, nullptr if not open */
+    std::size_t m_size = 0; /**< Size of the mapping */
+    AlarmJournalHeader* m_header = nullptr; /**< Header in the mapping */
+    AlarmJournalRecord* m_records = nullptr; /**< Ring of records in the mapping */
+    std::uint64_t m_capacity = 0; /**< Number of records of the ring */
+
+    AlarmJournal& operator= (const AlarmJournal&) = delete;
+    AlarmJournal (const AlarmJournal&) = delete;
+};
+
+#endif //AlarmJournal_h
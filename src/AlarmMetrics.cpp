@@ -0,0 +1,124 @@
+#include "AlarmMetrics.h"
+#include <algorithm>
+#include <iomanip>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+const std::size_t AlarmHistogramSnapshot::BUCKETS;
+const std::size_t AlarmPlayerMetrics::LEVELS;
+
+std::uint64_t AlarmStopwatch::ticks(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// First timestamps of both clocks, taken at static initialization so the calibration usually doesn't wait
+static const std::chrono::steady_clock::time_point g_calibrationTime = std::chrono::steady_clock::now();
+static const std::uint64_t g_calibrationTicks = AlarmStopwatch::ticks();
+
+double AlarmStopwatch::nanosecondsPerTick(){
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ratio = [](){
+        std::chrono::steady_clock::time_point time;
+        std::uint64_t ticks;
+        do { // Measure over at least 10ms for a precise ratio
+            time = std::chrono::steady_clock::now();
+            ticks = AlarmStopwatch::ticks();
+        } while(time - g_calibrationTime < std::chrono::milliseconds(10) || ticks == g_calibrationTicks);
+        return std::chrono::duration<double, std::nano>(time - g_calibrationTime).count() / (ticks - g_calibrationTicks);
+    }();
+    return ratio;
+#else
+    return 1;
+#endif
+}
+
+const unsigned int AlarmLockSampling::DEFAULT_PERIOD;
+
+static std::atomic<unsigned int> g_lockSamplingPeriod(AlarmLockSampling::DEFAULT_PERIOD);
+static thread_local unsigned int t_lockCountdown = 0; // Locks of the thread left before the next timed one
+
+void AlarmLockSampling::setPeriod(unsigned int period){
+    g_lockSamplingPeriod.store(period, std::memory_order_relaxed);
+}
+
+unsigned int AlarmLockSampling::period(){
+    return g_lockSamplingPeriod.load(std::memory_order_relaxed);
+}
+
+bool AlarmLockSampling::sample(){
+    unsigned int period = g_lockSamplingPeriod.load(std::memory_order_relaxed);
+    if(!period) return false;
+    if(t_lockCountdown && t_lockCountdown < period){
+        t_lockCountdown--;
+        return false;
+    }
+    t_lockCountdown = period - 1;
+    return true;
+}
+
+double AlarmHistogramSnapshot::mean() const {
+    return count ? sum / count : 0;
+}
+
+double AlarmHistogramSnapshot::percentile(double percent) const {
+    if(!count) return 0;
+    unsigned long long rank = (unsigned long long)(std::min(std::max(percent, 0.), 100.) / 100 * (count - 1)) + 1;
+    unsigned long long seen = 0;
+    for(std::size_t bucket=0;bucket<BUCKETS;bucket++){
+        seen += counts[bucket];
+        if(seen >= rank) return std::min(bounds[bucket], max);
+    }
+    return max;
+}
+
+AlarmHistogram::AlarmHistogram() : m_sum(0), m_max(0) {
+    for(std::atomic<std::uint64_t>& count : m_counts) count = 0;
+}
+
+AlarmHistogramSnapshot AlarmHistogram::snapshot(double nanosecondsPerUnit) const {
+    AlarmHistogramSnapshot snapshot;
+    for(std::size_t bucket=0;bucket<AlarmHistogramSnapshot::BUCKETS;bucket++){
+        snapshot.counts[bucket] = m_counts[bucket].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[bucket];
+        // Bucket b holds values up to 2^b - 1
+        double bound = bucket < 64 ? double((1ull << bucket) - 1) : 18446744073709551615.;
+        snapshot.bounds[bucket] = bound * nanosecondsPerUnit;
+    }
+    snapshot.sum = m_sum.load(std::memory_order_relaxed) * nanosecondsPerUnit;
+    snapshot.max = m_max.load(std::memory_order_relaxed) * nanosecondsPerUnit;
+    return snapshot;
+}
+
+void AlarmHistogram::reset(){
+    for(std::atomic<std::uint64_t>& count : m_counts) count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+static void printHistogram(std::ostream& output, const std::string& name, const AlarmHistogramSnapshot& histogram){
+    output << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+           << " count " << std::setw(10) << histogram.count
+           << "  mean " << std::setw(10) << histogram.mean() / 1000
+           << "  p50 " << std::setw(10) << histogram.percentile(50) / 1000
+           << "  p99 " << std::setw(10) << histogram.percentile(99) / 1000
+           << "  max " << std::setw(10) << histogram.max / 1000 << " us" << std::endl;
+}
+
+void AlarmPlayerMetrics::print(std::ostream& output) const {
+    static const char* levels[LEVELS] = {"LOW", "MEDIUM", "HIGH"};
+    output << "updates " << updates << ", preemptions " << preemptions << std::endl;
+    printHistogram(output, "tick lateness", tickLateness);
+    printHistogram(output, "switch latency", switchLatency);
+    printHistogram(output, "alarm list lock wait", alarmList.wait);
+    printHistogram(output, "alarm list lock hold", alarmList.hold);
+    printHistogram(output, "sequence lock wait", sequence.wait);
+    printHistogram(output, "sequence lock hold", sequence.hold);
+    for(std::size_t level=0;level<LEVELS;level++){
+        printHistogram(output, std::string("attach to audible ") + levels[level], attachToAudible[level]);
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ *  @file   AlarmMetrics.h
+ *  @brief  Define the AlarmHistogram instrumentation and the metrics snapshots of AlarmPlayer and Alarm
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmMetrics_h
+#define AlarmMetrics_h
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+
+#include "AlarmQueue.h"
+
+/**
+ * @brief Cheap timestamps for the instrumentation
+ * Reads the time-stamp counter on x86, which costs a few nanoseconds and assumes an invariant TSC,
+ * and the steady clock in nanoseconds elsewhere. Ticks are only converted to nanoseconds by snapshots.
+ */
+class AlarmStopwatch {
+public:
+    /**
+     * @brief Getter of the current timestamp, in ticks
+     */
+    static std::uint64_t ticks();
+
+    /**
+     * @brief Duration of a tick, calibrated against the steady clock on first use
+     * \warning The first call may wait up to 10 milliseconds for the calibration
+     */
+    static double nanosecondsPerTick();
+};
+
+/**
+ * @brief Copy of an \see AlarmHistogram, in nanoseconds
+ */
+struct AlarmHistogramSnapshot {
+    static const std::size_t BUCKETS = 65; /**< Bucket b counts values of b significant bits, from 2^(b-1) to 2^b-1 */
+
+    unsigned long long counts[BUCKETS] = {}; /**< Number of values per bucket */
+    double bounds[BUCKETS] = {}; /**< Upper bound of each bucket, in nanoseconds */
+    unsigned long long count = 0; /**< Number of values */
+    double sum = 0; /**< Sum of the values, in nanoseconds */
+    double max = 0; /**< Largest value, in nanoseconds */
+
+    /**
+     * @brief Mean of the values, in nanoseconds, 0 without value
+     */
+    double mean() const;
+
+    /**
+     * @brief Estimates a percentile as the upper bound of its bucket, so within a factor 2 above the exact value
+     * \param percent : the percentile, from 0 to 100
+     * \return the estimate in nanoseconds, never above \see max, 0 without value
+     */
+    double percentile(double percent) const;
+};
+
+/**
+ * @brief Lock-free histogram of durations with power-of-two buckets
+ * Recording is a few relaxed atomic increments, safe from any thread and never blocking nor allocating.
+ * Writers already serialized by a lock use \see recordSerialized(), which avoids the locked instructions.
+ */
+class AlarmHistogram {
+public:
+    AlarmHistogram();
+
+    /**
+     * @brief Records a value
+     * \param value : the value, in the unit of the histogram (\see AlarmStopwatch ticks or nanoseconds)
+     */
+    void record(std::uint64_t value){
+        if(!value){ // Typically an uncontended lock, only the count changes
+            m_counts[0].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        unsigned int bucket = 64 - __builtin_clzll(value);
+        m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        std::uint64_t max = m_max.load(std::memory_order_relaxed);
+        while(value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Records a value, writers being serialized by the caller, snapshots may still be taken concurrently
+     * \param value : the value, in the unit of the histogram (\see AlarmStopwatch ticks or nanoseconds)
+     */
+    void recordSerialized(std::uint64_t value){
+        unsigned int bucket = value ? 64 - __builtin_clzll(value) : 0;
+        m_counts[bucket].store(m_counts[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(!value) return;
+        m_sum.store(m_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if(value > m_max.load(std::memory_order_relaxed)) m_max.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copies the histogram
+     * Values recorded during the copy may be partially counted
+     * \param nanosecondsPerUnit : duration of a unit of the recorded values
+     */
+    AlarmHistogramSnapshot snapshot(double nanosecondsPerUnit = 1) const;
+
+    /**
+     * @brief Forgets the recorded values
+     */
+    void reset();
+
+private:
+    std::atomic<std::uint64_t> m_counts[AlarmHistogramSnapshot::BUCKETS]; /**< Number of values per bucket */
+    std::atomic<std::uint64_t> m_sum; /**< Sum of the values */
+    std::atomic<std::uint64_t> m_max; /**< Largest value */
+};
+
+/**
+ * @brief Sampling of the hold times recorded by \see AlarmTimedLock, shared by every lock of the process
+ * Timing a hold reads the \see AlarmStopwatch twice, which costs more than the uncontended lock itself:
+ * only one lock out of \see period() per thread is timed, the others cost a counter increment
+ */
+class AlarmLockSampling {
+public:
+    static const unsigned int DEFAULT_PERIOD = 64; /**< Period used until \see setPeriod() is called */
+
+    /**
+     * @brief Setter of the sampling period
+     * \param period : one lock out of period is timed, 1 times every lock, 0 times none
+     */
+    static void setPeriod(unsigned int period);
+
+    /**
+     * @brief Getter of the sampling period
+     */
+    static unsigned int period();
+
+    /**
+     * @brief Wether the lock being taken by the calling thread is timed
+     */
+    static bool sample();
+};
+
+/**
+ * @brief Scoped lock recording in \see AlarmStopwatch ticks how long the mutex was waited for, and then held
+ * An uncontended lock is recorded as a null wait without reading the time, a contended one always times its wait.
+ * Hold times are sampled, see \see AlarmLockSampling: the hold histogram counts fewer locks than the wait histogram.
+ * \tparam Mutex : type of the mutex
+ * \tparam Shared : wether the histograms are shared with other mutexes, otherwise the mutex serializes their writers
+ */
+template<typename Mutex, bool Shared = false>
+class AlarmTimedLock {
+public:
+    /**
+     * @brief Locks the mutex
+     * \param mutex : the mutex to lock
+     * \param wait : receives the time spent waiting for the mutex
+     * \param hold : receives the time the mutex is held, on \see unlock(), for sampled locks
+     */
+    AlarmTimedLock(Mutex& mutex, AlarmHistogram& wait, AlarmHistogram& hold) : m_mutex(mutex), m_hold(hold) {
+        bool timed = AlarmLockSampling::sample();
+        if(m_mutex.try_lock()){
+            if(timed) m_locked = AlarmStopwatch::ticks();
+            record(wait, 0);
+        }
+        else{
+            std::uint64_t start = AlarmStopwatch::ticks();
+            m_mutex.lock();
+            std::uint64_t locked = AlarmStopwatch::ticks();
+            if(timed) m_locked = locked;
+            record(wait, locked - start);
+        }
+    }
+
+    /**
+     * @brief Unlocks the mutex if still owned
+     */
+    ~AlarmTimedLock(){
+        if(m_owns) this->unlock();
+    }
+
+    /**
+     * @brief Unlocks the mutex before the end of the scope
+     */
+    void unlock(){
+        if(m_locked) record(m_hold, AlarmStopwatch::ticks() - m_locked);
+        m_owns = false;
+        m_mutex.unlock();
+    }
+
+private:
+    static void record(AlarmHistogram& histogram, std::uint64_t value){
+        if(Shared) histogram.record(value);
+        else histogram.recordSerialized(value); // Called while the mutex is held
+    }
+
+    Mutex& m_mutex; /**< Locked mutex */
+    AlarmHistogram& m_hold; /**< Receives the hold time */
+    std::uint64_t m_locked = 0; /**< Timestamp of the locking, 0 if the hold isn't timed */
+    bool m_owns = true; /**< Wether the mutex is still locked */
+
+    AlarmTimedLock& operator= (const AlarmTimedLock&) = delete;
+    AlarmTimedLock (const AlarmTimedLock&) = delete;
+};
+
+/**
+ * @brief Wait and hold times of a mutex
+ */
+struct AlarmLockMetrics {
+    AlarmHistogramSnapshot wait; /**< Time spent waiting for the mutex */
+    AlarmHistogramSnapshot hold; /**< Time the mutex was held, for the locks sampled by \see AlarmLockSampling */
+};
+
+/**
+ * @brief Snapshot of the instrumentation of an \see AlarmPlayer
+ */
+struct AlarmPlayerMetrics {
+    static const std::size_t LEVELS = 3; /**< Number of \see AlarmLevel */
+
+    AlarmHistogramSnapshot tickLateness; /**< Delay of the updates after their tone-edge deadline, millisecond tick rounding included */
+    AlarmHistogramSnapshot switchLatency; /**< Delay from a change of the attached alarms to the update playing the alarm it promoted, e.g. a preemption */
+    AlarmLockMetrics alarmList; /**< Mutex of the attached alarms of the player */
+    AlarmLockMetrics sequence; /**< Sequence mutexes of every alarm of the process, taken by sequence updates */
+    AlarmHistogramSnapshot attachToAudible[LEVELS]; /**< Time from the start of an alarm to its first beep, indexed by \see AlarmLevel */
+    unsigned long long updates = 0; /**< Number of updates of the player */
+    unsigned long long preemptions = 0; /**< Number of times a playing alarm was paused for a higher priority one */
+
+    /**
+     * @brief Prints the metrics, one line per histogram with its count, mean, percentiles and max
+     * \param output : the stream to print to
+     */
+    void print(std::ostream& output) const;
+};
+
+/**
+ * @brief Counters of an \see Alarm, kept while it exists
+ */
+struct AlarmStats {
+    std::chrono::nanoseconds audible = std::chrono::nanoseconds::zero(); /**< Time spent beeping on its player */
+    unsigned long long preempted = 0; /**< Number of times it was paused for a higher priority alarm */
+};
+
+#endif //AlarmMetrics_h
@@ -0,0 +1,9 @@
+#include "AlarmObserver.h"
+
+AlarmCallbackObserver::AlarmCallbackObserver(std::function<void(const AlarmEvent&)> callback) : m_callback(callback) {
+
+}
+
+void AlarmCallbackObserver::notify(const AlarmEvent& event){
+    if(m_callback) m_callback(event);
+}
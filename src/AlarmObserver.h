@@ -0,0 +1,73 @@
+/**
+ *  @file   AlarmObserver.h
+ *  @brief  Define the AlarmObserver interface notified of the changes of an AlarmPlayer, and its callback implementation
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmObserver_h
+#define AlarmObserver_h
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+
+#include "AlarmPool.h"
+
+/**
+ * @brief Kind of change of an \see AlarmEvent
+ */
+enum class AlarmEventType : std::uint8_t {
+    NOISE, /**< The player emitted a tone edge, alarm is the played alarm, null once no alarm is left */
+    PLAYING, /**< The first alarm was attached or the last one detached, \see AlarmPlayer::isPlaying() changed */
+    ACTIVE, /**< Another alarm is played, alarm is the new one, null once no alarm is left */
+    PREEMPT /**< The played alarm is paused for another one, alarm is the paused alarm and other the played one */
+};
+
+/**
+ * @brief Change of the state of an \see AlarmPlayer
+ */
+struct AlarmEvent {
+    std::uint64_t sequence = 0; /**< Number of the event in its player, from 1 without gap, 0 for no event yet */
+    std::chrono::steady_clock::time_point time; /**< Time of the change on the clock of the player */
+    AlarmEventType type = AlarmEventType::NOISE; /**< Kind of change */
+    bool noisy = false; /**< \see AlarmPlayer::isNoisy() after the change */
+    bool playing = false; /**< \see AlarmPlayer::isPlaying() after the change */
+    AlarmHandle alarm; /**< Alarm of the change, see \see AlarmEventType */
+    AlarmHandle other; /**< Second alarm of the change, see \see AlarmEventType */
+};
+
+/**
+ * @brief Receiver of the changes of an \see AlarmPlayer, \see AlarmPlayer::addObserver()
+ * Changes are notified synchronously, in sequence order, by the thread changing the player while it holds its lock:
+ * a noise edge reaches the observers before the \see AlarmSink thread writes it.
+ * \warning \see notify() must neither block nor call the player, typically it only signals another thread or device
+ */
+class AlarmObserver {
+public:
+    virtual ~AlarmObserver() {}
+
+    /**
+     * @brief Receives a change of the player
+     * \param event : the change
+     */
+    virtual void notify(const AlarmEvent& event) = 0;
+};
+
+/**
+ * @brief Observer calling a function for every change
+ */
+class AlarmCallbackObserver : public AlarmObserver {
+public:
+    /**
+     * @brief Constructor of an AlarmCallbackObserver
+     * \param callback : the function called for every change, with the restrictions of \see AlarmObserver::notify()
+     */
+    AlarmCallbackObserver(std::function<void(const AlarmEvent&)> callback);
+    void notify(const AlarmEvent& event) override;
+
+private:
+    std::function<void(const AlarmEvent&)> m_callback; /**< Function called for every change */
+};
+
+#endif //AlarmObserver_h
@@ -0,0 +1,113 @@
+/**
+ *  @file   AlarmPattern.h
+ *  @brief  Define the compile-time AlarmPattern and its AlarmBeep/AlarmSilence tones
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmPattern_h
+#define AlarmPattern_h
+
+#include "AlarmSequence.h"
+
+/**
+ * @brief Compile-time tone emitting noise, to be used in an \see AlarmPattern
+ * \tparam Duration : duration of the tone in milliseconds, must not be null nor exceed AlarmTone::MAX_DURATION
+ */
+template<unsigned int Duration>
+struct AlarmBeep {
+    static_assert(Duration > 0, "AlarmBeep duration must not be null");
+    static_assert(Duration <= AlarmTone::MAX_DURATION, "AlarmBeep duration must fit in 31 bits");
+    static constexpr unsigned int duration = Duration;
+    static constexpr bool beep = true;
+};
+
+/**
+ * @brief Compile-time silent tone, to be used in an \see AlarmPattern
+ * \tparam Duration : duration of the tone in milliseconds, must not be null nor exceed AlarmTone::MAX_DURATION
+ */
+template<unsigned int Duration>
+struct AlarmSilence {
+    static_assert(Duration > 0, "AlarmSilence duration must not be null");
+    static_assert(Duration <= AlarmTone::MAX_DURATION, "AlarmSilence duration must fit in 31 bits");
+    static constexpr unsigned int duration = Duration;
+    static constexpr bool beep = false;
+};
+
+namespace detail {
+
+/**
+ * @brief Static array of cumulative tone edges
+ */
+template<unsigned long long... Edges>
+struct AlarmPatternEdges {
+    static constexpr unsigned long long values[sizeof...(Edges)] = {Edges...};
+};
+template<unsigned long long... Edges>
+constexpr unsigned long long AlarmPatternEdges<Edges...>::values[sizeof...(Edges)];
+
+/**
+ * @brief Computes the cumulative edges of a list of tones, the result is in the type member
+ * \tparam Duration : duration accumulated so far
+ * \tparam Done : \see AlarmPatternEdges accumulated so far
+ * \tparam Tones : remaining tones
+ */
+template<unsigned long long Duration, typename Done, typename... Tones>
+struct AlarmPatternPrefixSum {
+    typedef Done type;
+    static constexpr unsigned long long duration = Duration;
+};
+template<unsigned long long Duration, unsigned long long... Edges, typename Tone, typename... Tones>
+struct AlarmPatternPrefixSum<Duration, AlarmPatternEdges<Edges...>, Tone, Tones...>
+    : AlarmPatternPrefixSum<Duration + Tone::duration, AlarmPatternEdges<Edges..., Duration + Tone::duration>, Tones...> {
+};
+
+/**
+ * @brief Duration shared by every tone in the value member, 0 if durations differ
+ */
+template<typename... Tones>
+struct AlarmPatternUniform {
+    static constexpr unsigned int value = 0;
+};
+template<typename Tone>
+struct AlarmPatternUniform<Tone> {
+    static constexpr unsigned int value = Tone::duration;
+};
+template<typename Tone, typename Next, typename... Tones>
+struct AlarmPatternUniform<Tone, Next, Tones...> {
+    static constexpr unsigned int value = Tone::duration == AlarmPatternUniform<Next, Tones...>::value ? Tone::duration : 0;
+};
+
+} // namespace detail
+
+/**
+ * @brief Alarm tone sequence fully defined at compile time
+ * Tones, cumulative edges and period are computed by the compiler and stored in read-only memory,
+ * so building an Alarm from a pattern costs neither heap allocation nor static-initialization work.
+ * Example: Alarm alarm(AlarmPattern<AlarmBeep<250>, AlarmSilence<750>>::sequence(), AlarmLevel::MEDIUM);
+ * \tparam Tones : list of \see AlarmBeep and \see AlarmSilence
+ */
+template<typename... Tones>
+struct AlarmPattern {
+    static_assert(sizeof...(Tones) > 0, "AlarmPattern needs at least one tone");
+
+    static constexpr std::size_t size = sizeof...(Tones); /**< Number of tones in the pattern */
+    static constexpr AlarmTone tones[sizeof...(Tones)] = {AlarmTone(Tones::duration, Tones::beep)...}; /**< Tones of the pattern */
+    typedef typename detail::AlarmPatternPrefixSum<0, detail::AlarmPatternEdges<>, Tones...> PrefixSum;
+    static constexpr const unsigned long long* edges = PrefixSum::type::values; /**< Cumulative end time of every tone in milliseconds */
+    static constexpr unsigned long long period = PrefixSum::duration; /**< Duration of a whole cycle in milliseconds */
+    static constexpr unsigned int uniform = detail::AlarmPatternUniform<Tones...>::value; /**< Duration shared by every tone, 0 if durations differ */
+    static constexpr AlarmSequence view = AlarmSequence(tones, size, edges, period, uniform); /**< The pattern as a static sequence */
+
+    /**
+     * @brief Getter of the pattern as a sequence snapshot, to be given to an \see Alarm
+     * \return a non-owning snapshot of \see view, created without allocation
+     */
+    static AlarmSequence::Ptr sequence() { return AlarmSequence::reference(view); }
+};
+template<typename... Tones>
+constexpr AlarmTone AlarmPattern<Tones...>::tones[sizeof...(Tones)];
+template<typename... Tones>
+constexpr AlarmSequence AlarmPattern<Tones...>::view;
+
+#endif //AlarmPattern_h
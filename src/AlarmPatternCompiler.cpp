@@ -0,0 +1,165 @@
+#include "AlarmPatternCompiler.h"
+#include <cstring>
+#include <limits>
+
+const std::size_t AlarmPatternCompiler::MAX_DEPTH;
+
+namespace {
+
+const unsigned long long MAX_TONES = std::numeric_limits<unsigned int>::max(); /**< AlarmSequence counts tones on 32 bits */
+const unsigned long long MAX_PERIOD = 1ull << 52; /**< Longest duration of a pattern in milliseconds, over 100000 years */
+
+/**
+ * @brief Per-thread buffers of the compiler, kept between compilations so parsing doesn't allocate
+ */
+struct Buffers {
+    std::vector<AlarmSequenceNode> nodes; /**< Nodes of closed groups, in post-order */
+    std::vector<AlarmSequenceNode> pending; /**< Items of the open groups, children first stored as absolute indexes */
+    std::vector<std::size_t> opens; /**< Start of each open group in pending */
+    std::vector<std::size_t> positions; /**< Text offset of each open group */
+    std::vector<AlarmTone> tones; /**< Tones of a pattern without repetition */
+};
+
+/**
+ * @brief Storage of a compressed snapshot, the snapshot references its own nodes
+ */
+struct CompiledSequence {
+    CompiledSequence(const std::vector<AlarmSequenceNode>& _nodes) : nodes(_nodes), sequence(AlarmSequence::tree(&nodes.back())) {}
+    CompiledSequence(const CompiledSequence&) = delete; // The sequence references the nodes of this very object
+    std::vector<AlarmSequenceNode> nodes;
+    AlarmSequence sequence;
+};
+
+/**
+ * @brief Moves an item of an open group to the closed nodes, making the reference to its children relative
+ */
+void place(Buffers& buffers, const AlarmSequenceNode& item){
+    buffers.nodes.push_back(item);
+    AlarmSequenceNode& node = buffers.nodes.back();
+    if(node.count) node.children = (unsigned int)(buffers.nodes.size() - 1 - node.children);
+}
+
+/**
+ * @brief Replaces the items of pending from begin by a group repeating them
+ * \return false if the group has too many tones or is too long
+ */
+bool group(Buffers& buffers, std::size_t begin, unsigned long long repeat){
+    std::size_t count = buffers.pending.size() - begin;
+    AlarmSequenceNode group;
+    group.count = (unsigned int)count;
+    group.children = (unsigned int)buffers.nodes.size(); // Absolute until placed
+    group.repeat = (unsigned int)repeat;
+    for(std::size_t i=begin;i<buffers.pending.size();i++){
+        AlarmSequenceNode& item = buffers.pending[i];
+        item.start = group.period;
+        item.offset = group.tones;
+        // Items are within the limits, so are their sums before the checks
+        group.period += item.period * item.repeat;
+        group.tones += item.tones * item.repeat;
+        if(group.tones > MAX_TONES || group.period > MAX_PERIOD) return false;
+        place(buffers, item);
+    }
+    buffers.pending.resize(begin);
+    if(group.tones > MAX_TONES / repeat || group.period > MAX_PERIOD / repeat) return false;
+    buffers.pending.push_back(group);
+    return true;
+}
+
+/**
+ * @brief Reads a decimal number
+ * \return false if there is no digit or the number exceeds max
+ */
+bool number(const char* text, std::size_t length, std::size_t& i, unsigned long long max, unsigned long long& value){
+    std::size_t begin = i;
+    value = 0;
+    while(i < length && text[i] >= '0' && text[i] <= '9'){
+        value = value * 10 + (text[i++] - '0');
+        if(value > max) return false;
+    }
+    return i > begin;
+}
+
+AlarmSequence::Ptr fail(AlarmPatternError* error, std::size_t position, const char* message){
+    if(error){
+        error->position = position;
+        error->message = message;
+    }
+    return nullptr;
+}
+
+}
+
+AlarmSequence::Ptr AlarmPatternCompiler::compile(const std::string& text, AlarmPatternError* error){
+    return compile(text.data(), text.size(), error);
+}
+
+AlarmSequence::Ptr AlarmPatternCompiler::compile(const char* text, AlarmPatternError* error){
+    return compile(text, std::strlen(text), error);
+}
+
+AlarmSequence::Ptr AlarmPatternCompiler::compile(const char* text, std::size_t length, AlarmPatternError* error){
+    static thread_local Buffers buffers;
+    buffers.nodes.clear();
+    buffers.pending.clear();
+    buffers.opens.clear();
+    buffers.positions.clear();
+    bool repeated = false;
+
+    std::size_t i = 0;
+    while(i < length){
+        char c = text[i];
+        if(c == ' ' || c == '\t' || c == '\n' || c == '\r'){
+            i++;
+        }
+        else if(c >= '0' && c <= '9'){
+            std::size_t start = i;
+            unsigned long long duration;
+            if(!number(text, length, i, AlarmTone::MAX_DURATION, duration)) return fail(error, start, "tone duration too long");
+            if(!duration) return fail(error, start, "null tone duration");
+            if(i == length || (text[i] != 'X' && text[i] != '_')) return fail(error, i, "expected 'X' or '_' after a duration");
+            AlarmSequenceNode tone;
+            tone.tone = AlarmTone((unsigned int)duration, text[i++] == 'X');
+            tone.period = duration;
+            tone.tones = 1;
+            buffers.pending.push_back(tone);
+        }
+        else if(c == '('){
+            if(buffers.opens.size() == MAX_DEPTH) return fail(error, i, "groups nested too deep");
+            buffers.opens.push_back(buffers.pending.size());
+            buffers.positions.push_back(i++);
+        }
+        else if(c == ')'){
+            if(buffers.opens.empty()) return fail(error, i, "unbalanced ')'");
+            std::size_t start = i++;
+            unsigned long long repeat = 1;
+            if(i < length && text[i] == 'x'){
+                std::size_t count = ++i;
+                if(!number(text, length, i, MAX_TONES, repeat)) return fail(error, count, "expected a repetition count after 'x'");
+                if(!repeat) return fail(error, count, "null repetition count");
+            }
+            std::size_t begin = buffers.opens.back();
+            buffers.opens.pop_back();
+            buffers.positions.pop_back();
+            // A group played once is only grouping, its items stay in the enclosing group. An empty group vanishes
+            if(repeat == 1 || begin == buffers.pending.size()) continue;
+            if(!group(buffers, begin, repeat)) return fail(error, start, "pattern too long");
+            repeated = true;
+        }
+        else return fail(error, i, "unexpected character");
+    }
+    if(!buffers.opens.empty()) return fail(error, buffers.positions.back(), "unbalanced '('");
+    if(buffers.pending.empty()) return AlarmSequence::empty();
+
+    if(!repeated){ // Only tones, a flat sequence is faster to play
+        buffers.tones.clear();
+        for(const AlarmSequenceNode& tone : buffers.pending) buffers.tones.push_back(tone.tone);
+        return AlarmSequence::create(buffers.tones);
+    }
+    // The root is the last node, a group played once unless the whole pattern is a single repeated group
+    if(buffers.pending.size() > 1 || !buffers.pending[0].count){
+        if(!group(buffers, 0, 1)) return fail(error, length, "pattern too long");
+    }
+    place(buffers, buffers.pending[0]);
+    std::shared_ptr<CompiledSequence> storage = std::make_shared<CompiledSequence>(buffers.nodes);
+    return AlarmSequence::Ptr(storage, &storage->sequence); // Aliasing: the snapshot keeps its storage alive
+}
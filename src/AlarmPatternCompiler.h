@@ -0,0 +1,60 @@
+/**
+ *  @file   AlarmPatternCompiler.h
+ *  @brief  Define the AlarmPatternCompiler, compiling the text pattern language into sequences
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmPatternCompiler_h
+#define AlarmPatternCompiler_h
+
+#include <cstddef>
+#include <string>
+
+#include "AlarmSequence.h"
+
+/**
+ * @brief Location and cause of a pattern compilation failure
+ */
+struct AlarmPatternError {
+    std::size_t position = 0; /**< Offset in the text of the character in error */
+    const char* message = nullptr; /**< Static description of the error, nullptr without error */
+};
+
+/**
+ * @brief Compiles the text pattern language into \see AlarmSequence snapshots
+ * A pattern is a list of tones and groups separated by optional whitespace, e.g. "(250X 500_)x4 250X 2000_":
+ *  - a tone is a duration in milliseconds followed by 'X' for a beep or '_' for a silence,
+ *  - a group is a pattern between parentheses, repeated by an optional 'x' count following it, and may be nested.
+ * Repetitions are never expanded: a pattern with a repeated group compiles into a compressed sequence
+ * (\see AlarmSequence::tree()) holding one node per written tone or group, otherwise into a flat sequence.
+ * The compiler is a single pass over the text with an explicit stack, reusing per-thread buffers:
+ * a compilation only allocates the snapshot it returns.
+ */
+class AlarmPatternCompiler {
+public:
+    static const std::size_t MAX_DEPTH = 32; /**< Deepest nesting of groups, bounding the cost of the lookups */
+
+    /**
+     * @brief Compiles a pattern
+     * \param text : the pattern
+     * \param error : receives the location of the first error, may be nullptr
+     * \return the snapshot, nullptr if the pattern is invalid, \see AlarmSequence::empty() if it has no tone
+     */
+    static AlarmSequence::Ptr compile(const std::string& text, AlarmPatternError* error = nullptr);
+
+    /**
+     * @brief Compiles a null-terminated pattern, see \see compile()
+     */
+    static AlarmSequence::Ptr compile(const char* text, AlarmPatternError* error = nullptr);
+
+    /**
+     * @brief Compiles a pattern, see \see compile()
+     * \param text : the pattern, not null-terminated
+     * \param length : the length of the pattern
+     * \param error : receives the location of the first error, may be nullptr
+     */
+    static AlarmSequence::Ptr compile(const char* text, std::size_t length, AlarmPatternError* error = nullptr);
+};
+
+#endif //AlarmPatternCompiler_h
@@ -0,0 +1,65 @@
+#include "AlarmPcmSink.h"
+#include <algorithm>
+
+static const std::size_t WAV_HEADER_SIZE = 44;
+
+// Little-endian encoding, as required by the RIFF format whatever the host
+static void put16(char* output, std::uint16_t value){
+    output[0] = char(value & 0xFF);
+    output[1] = char(value >> 8);
+}
+
+static void put32(char* output, std::uint32_t value){
+    put16(output, value & 0xFFFF);
+    put16(output + 2, value >> 16);
+}
+
+AlarmWavSink::AlarmWavSink(const std::string& path, unsigned int sampleRate)
+ : m_file(path, std::ios::out | std::ios::binary | std::ios::trunc), m_sampleRate(sampleRate) {
+    if(m_file.is_open()) this->writeHeader(); // Sizes are completed on close
+}
+
+AlarmWavSink::~AlarmWavSink() {
+    this->close();
+}
+
+void AlarmWavSink::write(const std::int16_t* samples, std::size_t count){
+    if(!m_file.is_open()) return;
+    m_buffer.resize(count * 2);
+    for(std::size_t i=0;i<count;i++) put16(&m_buffer[i*2], std::uint16_t(samples[i]));
+    m_file.write(m_buffer.data(), m_buffer.size());
+    m_size += count;
+}
+
+void AlarmWavSink::close(){
+    if(!m_file.is_open()) return;
+    m_file.seekp(0);
+    this->writeHeader();
+    m_file.close();
+}
+
+bool AlarmWavSink::isOpen(){
+    return m_file.is_open();
+}
+
+std::size_t AlarmWavSink::size(){
+    return m_size;
+}
+
+void AlarmWavSink::writeHeader(){
+    std::uint32_t dataSize = std::uint32_t(m_size * 2);
+    char header[WAV_HEADER_SIZE];
+    std::copy_n("RIFF", 4, header);
+    put32(header + 4, 36 + dataSize); // Size of the rest of the file
+    std::copy_n("WAVEfmt ", 8, header + 8);
+    put32(header + 16, 16); // Size of the format chunk
+    put16(header + 20, 1); // PCM
+    put16(header + 22, 1); // Mono
+    put32(header + 24, m_sampleRate);
+    put32(header + 28, m_sampleRate * 2); // Bytes per second
+    put16(header + 32, 2); // Bytes per frame
+    put16(header + 34, 16); // Bits per sample
+    std::copy_n("data", 4, header + 36);
+    put32(header + 40, dataSize);
+    m_file.write(header, WAV_HEADER_SIZE);
+}
@@ -0,0 +1,80 @@
+/**
+ *  @file   AlarmPcmSink.h
+ *  @brief  Define the AlarmPcmSink audio output interface and its WAV file implementation
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmPcmSink_h
+#define AlarmPcmSink_h
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Output of the \see AlarmRenderer, receiving mono 16-bit PCM samples block by block
+ */
+class AlarmPcmSink {
+public:
+    virtual ~AlarmPcmSink() {}
+
+    /**
+     * @brief Receives the next block of samples
+     * \param samples : the samples, only valid during the call
+     * \param count : the number of samples
+     */
+    virtual void write(const std::int16_t* samples, std::size_t count) = 0;
+};
+
+/**
+ * @brief Sink streaming samples to a WAV file (mono, 16-bit PCM)
+ * The header is written first with empty sizes, then completed by \see close(), so samples are never kept in memory
+ */
+class AlarmWavSink : public AlarmPcmSink {
+public:
+    /**
+     * @brief Constructor of an AlarmWavSink
+     * \param path : path of the file, truncated if it exists
+     * \param sampleRate : sample rate written in the header, in Hz
+     */
+    AlarmWavSink(const std::string& path, unsigned int sampleRate);
+
+    /**
+     * @brief Destructor of the AlarmWavSink, \see close() the file
+     */
+    ~AlarmWavSink();
+
+    void write(const std::int16_t* samples, std::size_t count) override;
+
+    /**
+     * @brief Completes the header with the final sizes and closes the file
+     * \warning Samples written afterwards are ignored
+     */
+    void close();
+
+    /**
+     * @brief Wether the file has been opened successfully
+     */
+    bool isOpen();
+
+    /**
+     * @brief Number of samples written so far
+     */
+    std::size_t size();
+
+private:
+    /**
+     * @brief Writes the WAV header for the current number of samples
+     */
+    void writeHeader();
+
+    std::ofstream m_file; /**< Output file */
+    unsigned int m_sampleRate; /**< Sample rate in Hz */
+    std::size_t m_size = 0; /**< Number of samples written */
+    std::vector<char> m_buffer; /**< Little-endian encoding of a block */
+};
+
+#endif //AlarmPcmSink_h
@@ -1,83 +1,745 @@
 #include "AlarmPlayer.h"
 #include "Alarm.h"
+#include "AlarmScheduler.h"
+#include "AlarmClock.h"
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
-AlarmPlayer AlarmPlayer::m_instance=AlarmPlayer();
+static AlarmHandle handleOf(const AlarmSlot* alarm){
+    AlarmHandle handle;
+    if(alarm){
+        handle.index = alarm->index;
+        handle.generation = alarm->generation;
+    }
+    return handle;
+}
+
+AlarmPlayer::AlarmPlayer(std::ostream& output) : AlarmPlayer(output, AlarmScheduler::Instance()) {
+
+}
 
-AlarmPlayer::AlarmPlayer() : m_playerThread(&AlarmPlayer::run, this){
+AlarmPlayer::AlarmPlayer(std::ostream& output, AlarmScheduler& scheduler)
+ : m_scheduler(scheduler), m_noisy(false), m_playing(false), m_streamSink(new AlarmStreamSink(output)), m_sink(*m_streamSink),
+   m_sequence(0), m_changeWord(0), m_waiters(0), m_wakePending(false), m_updates(0), m_preemptions(0), m_escalationEpoch(scheduler.now()) {
+    AlarmPool::Instance(); // Constructed first so the pool outlives the player
+}
+
+AlarmPlayer::AlarmPlayer(AlarmSink& sink) : AlarmPlayer(sink, AlarmScheduler::Instance()) {
+
+}
+
+AlarmPlayer::AlarmPlayer(AlarmSink& sink, AlarmScheduler& scheduler)
+ : m_scheduler(scheduler), m_noisy(false), m_playing(false), m_sink(sink),
+   m_sequence(0), m_changeWord(0), m_waiters(0), m_wakePending(false), m_updates(0), m_preemptions(0), m_escalationEpoch(scheduler.now()) {
+    AlarmPool::Instance(); // Constructed first so the pool outlives the player
 }
 
 AlarmPlayer::~AlarmPlayer() {
-    m_alive = false; // Contact the playback thread for termination
-    m_playerThread.join(); // Wait for the playback thread
-    while(m_alarmList.size()) m_alarmList.at(0)->stop(); // Detach every Alarm
-    this->beep(false); // Depending on hardware, make sure we stop any noise
+    m_alarmList_mtx.lock();
+    m_alive = false; // Prevent attachments and further updates
+    m_alarmList_mtx.unlock();
+    m_scheduler.cancel(this); // Wait for the scheduler thread, if it is updating this player
+    m_scheduler.drain(); // Edges of this player may still be queued for its sink
+    while(!m_alarmList.empty()){ // Detach every Alarm
+        AlarmSlot* alarm = m_alarmList.top();
+        m_alarmList.remove(alarm);
+        m_escalations.remove(alarm);
+        alarm->state = AlarmState::IDLE;
+    }
+    m_playing = false;
+    // Depending on hardware, make sure we stop any noise. No edge is queued anymore, the sink is written directly.
+    if(m_noisy || m_edgePending){
+        AlarmEdge silence;
+        silence.time = m_scheduler.now();
+        m_sink.write(silence);
+    }
+}
+
+AlarmChange AlarmChange::start(const Alarm& alarm, std::chrono::milliseconds position){
+    AlarmChange change;
+    change.type = Type::START;
+    change.alarm = alarm.getHandle();
+    change.position = position;
+    return change;
+}
+
+AlarmChange AlarmChange::stop(const Alarm& alarm){
+    AlarmChange change;
+    change.type = Type::STOP;
+    change.alarm = alarm.getHandle();
+    return change;
+}
+
+AlarmChange AlarmChange::setLevel(const Alarm& alarm, AlarmLevel level){
+    AlarmChange change;
+    change.type = Type::SET_LEVEL;
+    change.alarm = alarm.getHandle();
+    change.level = level;
+    return change;
+}
+
+AlarmChange AlarmChange::acknowledge(const Alarm& alarm){
+    AlarmChange change;
+    change.type = Type::ACKNOWLEDGE;
+    change.alarm = alarm.getHandle();
+    return change;
 }
 
 AlarmPlayer& AlarmPlayer::Instance() {
-    return m_instance; // AlarmPlayer is a singleton, return its only instance
+    static AlarmPlayer instance; // Function-local so binaries that never raise an alarm don't pay for it
+    return instance;
+}
+
+bool AlarmPlayer::owns(const AlarmSlot* alarm) const {
+    AlarmPlayer* player = alarm->player;
+    return player ? player == this : this == &AlarmPlayer::Instance();
+}
+
+bool AlarmPlayer::attach(AlarmHandle handle, std::chrono::milliseconds position){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle); // The alarm may be destroyed meanwhile, its state is kept until unpinned
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(!m_alive || alarm->state != AlarmState::IDLE) return true; // Do not attach while destroying
+    this->attachLocked(alarm, position, now);
+    lock.unlock();
+    this->wakeWaiters();
+    m_scheduler.schedule(this); // Let the scheduler preempt the current alarm if needed, starting its thread on first use
+    return true;
+}
+
+bool AlarmPlayer::detach(AlarmHandle handle){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(alarm->state == AlarmState::IDLE) return true;
+    this->detachLocked(alarm, now, AlarmState::IDLE);
+    lock.unlock();
+    this->wakeWaiters();
+    m_scheduler.schedule(this);
+    return true;
+}
+
+bool AlarmPlayer::relevel(AlarmHandle handle, AlarmLevel level, bool restart){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    alarm->escalationBase = level; // Restored by the next acknowledgment
+    bool changed = this->relevelLocked(alarm, level, restart, now);
+    lock.unlock();
+    if(changed) m_scheduler.schedule(this); // The priority of the alarm, or its next tone edge, has changed
+    return true;
+}
+
+bool AlarmPlayer::escalate(AlarmHandle handle, const AlarmEscalation& escalation){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    alarm->escalation = escalation;
+    alarm->escalationStep = 0; // Steps already due are applied by the next update
+    if(!m_alarmList.contains(alarm)) return true; // Scheduled on attachment
+    this->scheduleEscalation(alarm);
+    lock.unlock();
+    m_scheduler.schedule(this);
+    return true;
+}
+
+bool AlarmPlayer::getEscalation(AlarmHandle handle, AlarmEscalation& escalation){
+    escalation = AlarmEscalation();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    escalation = alarm->escalation;
+    return true;
+}
+
+bool AlarmPlayer::acknowledge(AlarmHandle handle){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(!this->acknowledgeLocked(alarm, now)) return true;
+    lock.unlock();
+    m_scheduler.schedule(this); // The priority of the alarm, or its next escalation deadline, has changed
+    return true;
+}
+
+bool AlarmPlayer::rebind(AlarmHandle handle, AlarmPlayer& player, bool& moved){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    moved = false;
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(&player == this) return true; // Already bound
+    // The alarm stays started while moving, so a concurrent stop() on the new player is not lost
+    moved = alarm->state != AlarmState::IDLE;
+    bool attached = m_alarmList.contains(alarm);
+    if(attached) this->detachLocked(alarm, now, AlarmState::STARTED);
+    alarm->player = &player; // Changed under the lock of the previous player, which then gives up the playback attributes
+    lock.unlock();
+    this->wakeWaiters();
+    if(attached) m_scheduler.schedule(this);
+    return true;
+}
+
+bool AlarmPlayer::resume(AlarmHandle handle){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(!m_alive || alarm->state == AlarmState::IDLE || !this->attachLocked(alarm, std::chrono::milliseconds(0), now)) return true;
+    lock.unlock();
+    this->wakeWaiters();
+    m_scheduler.schedule(this);
+    return true;
+}
+
+void AlarmPlayer::detachRetired(AlarmSlot* alarm){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    bool attached = m_alarmList.contains(alarm);
+    this->detachLocked(alarm, now, AlarmState::IDLE);
+    lock.unlock();
+    this->wakeWaiters();
+    if(attached) m_scheduler.schedule(this);
+}
+
+bool AlarmPlayer::attachLocked(AlarmSlot* alarm, std::chrono::milliseconds position, std::chrono::steady_clock::time_point now){
+    if(m_alarmList.contains(alarm)) return false;
+    // Playback starts from the requested position of the sequence
+    alarm->position = std::max(position, std::chrono::milliseconds(0));
+    alarm->toneEdge = true;
+    if(alarm->rewind.exchange(false)){ // A source set while stopped starts with its first tone, otherwise it resumes its current one
+        alarm->sourcePulled = false;
+        alarm->sourcePlayed = 0;
+    }
+    alarm->attachedAt = now;
+    alarm->awaitingAudible = true;
+    alarm->state = AlarmState::STARTED;
+    m_alarmList.push(alarm, (int)alarm->level.load());
+    m_changedAt = std::min(m_changedAt, now);
+    if(!m_playing){
+        m_playing = true;
+        this->publish(AlarmEventType::PLAYING, now, alarm);
+    }
+    this->journal(AlarmJournalEvent::START, now, alarm, (std::uint8_t)alarm->level.load(), (std::uint32_t)std::min<std::chrono::milliseconds::rep>(position.count(), 0xFFFFFFFF));
+    alarm->escalationBase = alarm->level;
+    alarm->escalationSince = now;
+    alarm->escalationStep = 0;
+    this->scheduleEscalation(alarm);
+    return true;
+}
+
+void AlarmPlayer::detachLocked(AlarmSlot* alarm, std::chrono::steady_clock::time_point now, AlarmState state){
+    if(m_alarmList.contains(alarm)){
+        m_changedAt = std::min(m_changedAt, now);
+        this->journal(AlarmJournalEvent::STOP, now, alarm, (std::uint8_t)alarm->level.load());
+    }
+    m_alarmList.remove(alarm); // No effect if the alarm isn't attached
+    m_escalations.remove(alarm);
+    if(state == AlarmState::IDLE) alarm->level = alarm->escalationBase; // A stopped alarm is started again at its own level
+    if(m_current == alarm) m_current = nullptr; // Never keep a reference to a detached alarm
+    if(m_playing && m_alarmList.empty()){ // Otherwise the next update publishes the alarm it plays
+        m_playing = false;
+        this->publish(AlarmEventType::PLAYING, now, alarm);
+        this->publish(AlarmEventType::ACTIVE, now, nullptr);
+    }
+    if(m_sliceTop == alarm) m_sliceTop = nullptr;
+    if(m_slice == alarm) m_slice = m_sliceTop = nullptr; // Slices are counted again from the highest priority alarm
+    if(m_audible == alarm) this->endAudible(now); // The beep ends on the next update
+    alarm->awaitingAudible = false;
+    alarm->state = state;
+}
+
+bool AlarmPlayer::relevelLocked(AlarmSlot* alarm, AlarmLevel level, bool restart, std::chrono::steady_clock::time_point now){
+    bool moved = alarm->level != level;
+    alarm->level = level;
+    if(!m_alarmList.contains(alarm)) return false; // Taken into account on attachment
+    if(moved){ // Requeued at the end of its new level bucket, the playback position is kept
+        m_alarmList.remove(alarm);
+        m_alarmList.push(alarm, (int)level);
+        m_changedAt = std::min(m_changedAt, now);
+        this->journal(AlarmJournalEvent::LEVEL, now, alarm, (std::uint8_t)level);
+    }
+    if(restart){
+        if(m_current == alarm) alarm->origin = now;
+        else alarm->position = std::chrono::steady_clock::duration::zero();
+        alarm->rewind = false;
+        alarm->toneEdge = true;
+    }
+    return moved || restart;
+}
+
+bool AlarmPlayer::acknowledgeLocked(AlarmSlot* alarm, std::chrono::steady_clock::time_point now){
+    if(!m_alarmList.contains(alarm)) return false;
+    this->relevelLocked(alarm, alarm->escalationBase, false, now);
+    alarm->escalationSince = now;
+    alarm->escalationStep = 0;
+    this->scheduleEscalation(alarm);
+    return true;
+}
+
+void AlarmPlayer::scheduleEscalation(AlarmSlot* alarm){
+    if(alarm->escalationStep >= alarm->escalation.count){
+        m_escalations.remove(alarm);
+        return;
+    }
+    const AlarmEscalationStep& step = alarm->escalation.steps[alarm->escalationStep];
+    m_escalations.insert(alarm, this->escalationTick(alarm->escalationSince + step.after, true));
+}
+
+void AlarmPlayer::escalateLocked(std::chrono::steady_clock::time_point now){
+    // Only the due steps are looked at, whatever the number of pending escalations
+    std::uint64_t tick = this->escalationTick(now, false);
+    while(AlarmSlot* alarm = m_escalations.pop(tick)){
+        const AlarmEscalationStep& step = alarm->escalation.steps[alarm->escalationStep];
+        if(now < alarm->escalationSince + step.after){ // Shortened to the horizon of the wheel, not due yet
+            this->scheduleEscalation(alarm);
+            continue;
+        }
+        if(step.level > alarm->level) this->relevelLocked(alarm, step.level, false, now); // In place, as setLevel()
+        alarm->escalationStep++;
+        this->scheduleEscalation(alarm); // Popped again by this loop if it is also due
+    }
+}
+
+std::uint64_t AlarmPlayer::escalationTick(std::chrono::steady_clock::time_point time, bool roundUp) const {
+    if(time <= m_escalationEpoch) return 0;
+    std::chrono::steady_clock::duration elapsed = time - m_escalationEpoch;
+    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    return ms.count() + (roundUp && ms < elapsed ? 1 : 0);
+}
+
+void AlarmPlayer::apply(std::initializer_list<AlarmChange> changes){
+    this->apply(changes.begin(), changes.size());
+}
+
+void AlarmPlayer::apply(const std::vector<AlarmChange>& changes){
+    this->apply(changes.data(), changes.size());
 }
 
-void AlarmPlayer::attach(Alarm* alarm){
+void AlarmPlayer::apply(const AlarmChange* changes, std::size_t count){
+    std::chrono::steady_clock::time_point now = m_scheduler.now();
+    bool changed = false;
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
     if(!m_alive) return; // Do not attach while destroying
-    m_alarmList_mtx.lock();
-    if(std::find(m_alarmList.begin(), m_alarmList.end(), alarm) == m_alarmList.end()) // Make sure alarm isn't yet attached
-        m_alarmList.push_back(alarm);
-    // Sort alarms by level, higest priority first
-    std::sort(m_alarmList.begin(), m_alarmList.end(), [](Alarm* a, Alarm* b) {return (int)a->getLevel() > (int)b->getLevel(); });
-    m_alarmList_mtx.unlock();
+    for(std::size_t i=0;i<count;i++){
+        const AlarmChange& change = changes[i];
+        AlarmSlotPin pin(change.alarm);
+        AlarmSlot* alarm = pin.get();
+        if(!alarm || !this->owns(alarm)) continue;
+        switch(change.type){
+            case AlarmChange::Type::START:
+                if(alarm->state != AlarmState::IDLE) break;
+                this->attachLocked(alarm, change.position, now);
+                changed = true;
+                break;
+            case AlarmChange::Type::STOP:
+                if(alarm->state == AlarmState::IDLE) break;
+                this->detachLocked(alarm, now, AlarmState::IDLE);
+                changed = true;
+                break;
+            case AlarmChange::Type::SET_LEVEL:
+                alarm->escalationBase = change.level;
+                if(this->relevelLocked(alarm, change.level, false, now)) changed = true;
+                break;
+            case AlarmChange::Type::ACKNOWLEDGE:
+                if(this->acknowledgeLocked(alarm, now)) changed = true;
+                break;
+        }
+    }
+    lock.unlock();
+    this->wakeWaiters();
+    if(changed) m_scheduler.schedule(this); // A single priority decision for the whole batch
 }
 
-void AlarmPlayer::detach(Alarm* alarm){
-    m_alarmList_mtx.lock();
-    m_alarmList.erase(std::remove(m_alarmList.begin(), m_alarmList.end(), alarm), m_alarmList.end());
-    // Sort alarms by level, higest priority first, not mandatory on detach but future-proof
-    std::sort(m_alarmList.begin(), m_alarmList.end(), [](Alarm* a, Alarm* b) {return (int)a->getLevel() > (int)b->getLevel(); });
-    m_alarmList_mtx.unlock();
+void AlarmPlayer::refresh(){
+    m_scheduler.schedule(this);
+}
+
+bool AlarmPlayer::seek(AlarmHandle handle, std::chrono::milliseconds position){
+    position = std::max(position, std::chrono::milliseconds(0));
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(alarm->state == AlarmState::IDLE || std::atomic_load(&alarm->source)) return true; // A source can't seek
+    if(m_current == alarm) alarm->origin = m_scheduler.now() - position;
+    else alarm->position = position;
+    alarm->rewind = false;
+    alarm->toneEdge = true;
+    lock.unlock();
+    m_scheduler.schedule(this); // The next tone edge has moved
+    return true;
+}
+
+bool AlarmPlayer::getPosition(AlarmHandle handle, std::chrono::milliseconds& position){
+    position = std::chrono::milliseconds(0);
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    if(alarm->state == AlarmState::IDLE) return true;
+    std::chrono::steady_clock::duration elapsed = alarm->position;
+    if(m_current == alarm) elapsed = m_scheduler.now() - alarm->origin;
+    std::chrono::milliseconds::rep duration = std::atomic_load(&alarm->sequence)->duration();
+    if(std::atomic_load(&alarm->source)){ // Time played by the source, from the start of its current tone
+        position = std::chrono::milliseconds(alarm->sourcePlayed) + std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+        return true;
+    }
+    lock.unlock();
+    std::chrono::milliseconds::rep ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    position = std::chrono::milliseconds(duration ? ms % duration : 0);
+    return true;
+}
+
+bool AlarmPlayer::getStats(AlarmHandle handle, AlarmStats& stats){
+    stats = AlarmStats();
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    AlarmSlotPin pin(handle);
+    AlarmSlot* alarm = pin.get();
+    if(!alarm) return true;
+    if(!this->owns(alarm)) return false;
+    std::chrono::steady_clock::duration audible = alarm->audible;
+    if(m_audible == alarm) audible += std::max(m_scheduler.now() - m_audibleSince, std::chrono::steady_clock::duration::zero());
+    stats.audible = std::chrono::duration_cast<std::chrono::nanoseconds>(audible);
+    stats.preempted = alarm->preempted;
+    return true;
+}
+
+void AlarmPlayer::setArbitration(const AlarmArbitration& arbitration){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    m_arbitration = arbitration;
+    m_arbitration.interleave = std::max(m_arbitration.interleave, 1u);
+    m_slice = m_sliceTop = nullptr;
+    lock.unlock();
+    m_scheduler.schedule(this);
+}
+
+AlarmArbitration AlarmPlayer::getArbitration(){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    return m_arbitration;
+}
+
+void AlarmPlayer::setJournal(AlarmJournal* journal, std::uint16_t zone){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    m_journal = journal;
+    m_journalZone = zone;
+}
+
+AlarmPlayerMetrics AlarmPlayer::getMetrics(){
+    AlarmPlayerMetrics metrics;
+    double tick = AlarmStopwatch::nanosecondsPerTick();
+    metrics.tickLateness = m_tickLateness.snapshot();
+    metrics.switchLatency = m_switchLatency.snapshot();
+    metrics.alarmList.wait = m_listWait.snapshot(tick);
+    metrics.alarmList.hold = m_listHold.snapshot(tick);
+    metrics.sequence.wait = AlarmPool::Instance().sequenceWait.snapshot(tick);
+    metrics.sequence.hold = AlarmPool::Instance().sequenceHold.snapshot(tick);
+    for(std::size_t level=0;level<AlarmPlayerMetrics::LEVELS;level++) metrics.attachToAudible[level] = m_attachToAudible[level].snapshot();
+    metrics.updates = m_updates;
+    metrics.preemptions = m_preemptions;
+    return metrics;
 }
 
-void AlarmPlayer::run() {
-    while(m_alive){
-        //Get highest priority alarm
-        m_alarmList_mtx.lock();
-        if(m_alarmList.size()){
-            // Highest priority alarm is always first in vector (thanks to sorting on insert)
-            Alarm* alarm = m_alarmList.at(0);
-            this->updateAlarm(alarm); // Play the alarm tone
+void AlarmPlayer::resetMetrics(){
+    m_tickLateness.reset();
+    m_switchLatency.reset();
+    m_listWait.reset();
+    m_listHold.reset();
+    AlarmPool::Instance().sequenceWait.reset();
+    AlarmPool::Instance().sequenceHold.reset();
+    for(AlarmHistogram& histogram : m_attachToAudible) histogram.reset();
+    m_updates = 0;
+    m_preemptions = 0;
+}
+
+std::chrono::steady_clock::time_point AlarmPlayer::update(std::chrono::steady_clock::time_point now) {
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    if(!m_alive) return deadline;
+    m_updates.fetch_add(1, std::memory_order_relaxed);
+    if(m_deadline != deadline && now >= m_deadline){ // Not an early update requested by an attachment or a refresh
+        m_tickLateness.recordSerialized(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_deadline).count());
+    }
+    if(m_edgePending && m_scheduler.post(m_sink, m_pendingEdge)) m_edgePending = false; // Room is available again
+    this->escalateLocked(now); // Before the arbitration, so a raised alarm preempts at once
+    while(!m_alarmList.empty()){
+        AlarmSlot* alarm = this->arbitrate(now);
+        if(alarm != m_current && m_changedAt != deadline){ // Promoted by a change, typically a preemption
+            m_switchLatency.recordSerialized(std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(now - m_changedAt, std::chrono::steady_clock::duration::zero())).count());
+        }
+        deadline = this->updateAlarm(alarm, now); // Play the alarm tone
+        if(m_alarmList.contains(alarm)){
+            if(m_slice) deadline = std::min(deadline, m_sliceEnd);
+            break;
         }
-        else this->beep(false); // Turn beep off when no alarm to playback
-        m_alarmList_mtx.unlock();
+        deadline = std::chrono::steady_clock::time_point::max(); // Its source is exhausted, the next alarm plays from now
+    }
+    if(m_alarmList.empty() && (m_current || m_noisy)){
+        this->beep(false, now); // Turn beep off when no alarm to playback
+        m_current = nullptr;
+    }
+    m_changedAt = std::chrono::steady_clock::time_point::max(); // Changes so far are resolved
+    std::uint64_t escalation = m_escalations.nextTick();
+    if(escalation != m_escalations.NONE) deadline = std::min(deadline, m_escalationEpoch + std::chrono::milliseconds(escalation));
+    // Retry a coalesced edge soon, so the sink ends up in the played state
+    if(m_edgePending) deadline = std::min(deadline, now + std::chrono::milliseconds(1));
+    m_deadline = deadline;
+    lock.unlock();
+    this->wakeWaiters();
+    return deadline; // Idle player is not scheduled until the next attach
+}
+
+AlarmSlot* AlarmPlayer::arbitrate(std::chrono::steady_clock::time_point now){
+    // Highest priority alarm is the oldest alarm of the highest non-empty level
+    AlarmSlot* top = m_alarmList.top();
+    if(m_arbitration.policy == AlarmArbitrationPolicy::STRICT) return top;
+    AlarmSequence::Ptr sequence = std::atomic_load(&top->sequence);
+    AlarmSlot* lower = m_alarmList.topBelow(m_alarmList.level(top));
+    if(!lower || !sequence->duration()){
+        m_slice = m_sliceTop = nullptr;
+        return top;
+    }
+    // Sequence cycle the highest priority alarm is in, its position is kept while a slice preempts it
+    std::chrono::steady_clock::duration position = m_current == top ? now - top->origin : top->position;
+    unsigned long long cycle = std::chrono::duration_cast<std::chrono::milliseconds>(position).count() / sequence->duration();
+    if(top != m_sliceTop){ // New highest priority alarm, its slices are counted from now
+        m_sliceTop = top;
+        m_slice = nullptr;
+        m_sliceCycle = cycle + m_arbitration.interleave;
+    }
+    if(m_slice){
+        if(m_slice == lower && now < m_sliceEnd) return lower; // Slice still running
+        m_slice = nullptr;
+        m_sliceCycle = cycle + m_arbitration.interleave;
+        return top;
+    }
+    if(cycle < m_sliceCycle) return top;
+    // Cycle boundary reached: the lower level alarm plays one cycle of its sequence
+    std::chrono::milliseconds::rep slice = std::atomic_load(&lower->sequence)->duration();
+    if(!slice){
+        m_sliceCycle = cycle + m_arbitration.interleave; // Nothing to hear, skip its turn
+        return top;
+    }
+    m_slice = lower;
+    m_sliceEnd = now + std::chrono::milliseconds(slice);
+    return lower;
+}
 
-        //Sleep until next turn. The sleep precision is well enough for this audio alarm.
-        std::this_thread::sleep_for(std::chrono::milliseconds(m_interval_ms));
+std::chrono::steady_clock::time_point AlarmPlayer::updateAlarm(AlarmSlot* alarm, std::chrono::steady_clock::time_point now){
+    if(m_current != alarm){
+        // Preemption: pause the previous alarm where it was, resume the new one where it paused
+        if(m_current){
+            m_current->position = now - m_current->origin;
+            m_current->state = AlarmState::PREEMPTED;
+            m_current->preempted++;
+            m_preemptions.fetch_add(1, std::memory_order_relaxed);
+            this->journal(AlarmJournalEvent::PREEMPT, now, m_current, (std::uint8_t)alarm->level.load(), alarm->index);
+            this->publish(AlarmEventType::PREEMPT, now, m_current, alarm);
+        }
+        alarm->origin = now - alarm->position;
+        alarm->toneEdge = true;
+        alarm->state = AlarmState::PLAYING;
+        m_current = alarm;
+        this->publish(AlarmEventType::ACTIVE, now, alarm);
+    }
+    if(alarm->rewind.exchange(false)){ // Sequence has been replaced, restart from its begining
+        alarm->origin = now;
+        alarm->toneEdge = true;
+        alarm->sourcePulled = false;
+        alarm->sourcePlayed = 0;
     }
+    AlarmToneSource::Ptr source = std::atomic_load(&alarm->source);
+    if(source) return this->updateSource(alarm, *source, now);
+    // Read the published snapshot: no copy of the tones, no allocation and no per-alarm lock
+    AlarmSequence::Ptr sequence = std::atomic_load(&alarm->sequence);
+    if(!sequence->duration()){
+        if(alarm->toneEdge) this->beep(false, now); // Turn beep off when alarm has no tone
+        alarm->toneEdge = false;
+        return std::chrono::steady_clock::time_point::max();
+    }
+    // Look the tone up in the sequence timeline, the position being relative to the sequence origin
+    unsigned long long position = std::chrono::duration_cast<std::chrono::milliseconds>(now - alarm->origin).count();
+    unsigned long long cycle = position / sequence->duration();
+    std::size_t index = sequence->indexAt(position);
+    if(alarm->toneEdge || index != alarm->toneIndex || cycle != alarm->toneCycle){
+        this->beep((*sequence)[index].beep, now);
+        if((*sequence)[index].beep && alarm->awaitingAudible){
+            m_attachToAudible[(int)alarm->level.load()].recordSerialized(std::chrono::duration_cast<std::chrono::nanoseconds>(now - alarm->attachedAt).count());
+            alarm->awaitingAudible = false;
+        }
+        alarm->toneIndex = index;
+        alarm->toneCycle = cycle;
+        alarm->toneEdge = false;
+    }
+    // Next edge is the end of the current tone, computed from the origin so edges never drift
+    return alarm->origin + std::chrono::milliseconds(cycle * sequence->duration() + sequence->edge(index));
 }
 
-void AlarmPlayer::updateAlarm(Alarm* alarm){
-    alarm->m_sequence_mtx.lock();
-    std::vector<AlarmTone> sequence = alarm->getSequence();
-    if(sequence.size()){
-        if(alarm->m_toneIndex>sequence.size()-1) alarm->m_toneIndex = 0; // Reset playback to begining of sequence
-        AlarmTone tone = sequence.at(alarm->m_toneIndex);
-        alarm->m_toneMsElapsed += m_interval_ms;
-        if(alarm->m_toneMsElapsed>=tone.duration){ // Switch to next tone in sequence
-            alarm->m_toneIndex++;
-            alarm->m_toneMsElapsed = 0;
+std::chrono::steady_clock::time_point AlarmPlayer::updateSource(AlarmSlot* alarm, AlarmToneSource& source, std::chrono::steady_clock::time_point now){
+    static const unsigned int MAX_PULLS = 1024; // Bounds the time spent on null tones in one update
+    // Tones ended since the last update are skipped without a beep, their ends being computed from the origin so edges never drift
+    for(unsigned int pulls=0; !alarm->sourcePulled || now >= alarm->origin + std::chrono::milliseconds(alarm->sourceTone.duration); pulls++){
+        if(alarm->sourcePulled){
+            alarm->origin += std::chrono::milliseconds(alarm->sourceTone.duration);
+            alarm->sourcePlayed += alarm->sourceTone.duration;
+            alarm->sourcePulled = false;
+            alarm->toneEdge = true;
+        }
+        if(pulls == MAX_PULLS) return now; // Resumed on the next tick
+        if(!source.next(alarm->sourceTone, std::chrono::milliseconds(alarm->sourcePlayed))){
+            this->detachLocked(alarm, now, AlarmState::IDLE); // Exhausted: the alarm stops itself
+            return std::chrono::steady_clock::time_point::max();
+        }
+        alarm->sourcePulled = true;
+    }
+    if(alarm->toneEdge){
+        this->beep(alarm->sourceTone.beep, now);
+        if(alarm->sourceTone.beep && alarm->awaitingAudible){
+            m_attachToAudible[(int)alarm->level.load()].recordSerialized(std::chrono::duration_cast<std::chrono::nanoseconds>(now - alarm->attachedAt).count());
+            alarm->awaitingAudible = false;
         }
-        this->beep(tone.beep);
+        alarm->toneEdge = false;
     }
-    else this->beep(false); // Turn beep off when alarm has no tone
-    alarm->m_sequence_mtx.unlock();
+    return alarm->origin + std::chrono::milliseconds(alarm->sourceTone.duration);
+}
+
+void AlarmPlayer::journal(AlarmJournalEvent event, std::chrono::steady_clock::time_point now, const AlarmSlot* alarm, std::uint8_t value, std::uint32_t other){
+    if(!m_journal) return;
+    m_journal->append(event, now, m_journalZone, handleOf(alarm), value, other);
+}
+
+void AlarmPlayer::publish(AlarmEventType type, std::chrono::steady_clock::time_point now, const AlarmSlot* alarm, const AlarmSlot* other){
+    m_lastEvent.sequence++;
+    m_lastEvent.time = now;
+    m_lastEvent.type = type;
+    m_lastEvent.noisy = m_noisy.load(std::memory_order_relaxed);
+    m_lastEvent.playing = m_playing.load(std::memory_order_relaxed);
+    m_lastEvent.alarm = handleOf(alarm);
+    m_lastEvent.other = handleOf(other);
+    m_sequence.store(m_lastEvent.sequence, std::memory_order_release);
+    m_changeWord.store((std::uint32_t)m_lastEvent.sequence, std::memory_order_release);
+    for(AlarmObserver* observer : m_observers) observer->notify(m_lastEvent);
+    // Pairs with the waiters: either a waiter sees the new word, or this thread sees it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_waiters.load(std::memory_order_relaxed)) m_wakePending.store(true, std::memory_order_release); // Woken once unlocked
+}
+
+void AlarmPlayer::wakeWaiters(){
+    // Whichever thread takes the flag wakes the waiters, after the words of every change that raised it
+    if(!m_wakePending.load(std::memory_order_relaxed) || !m_wakePending.exchange(false, std::memory_order_acq_rel)) return;
+    ::syscall(SYS_futex, &m_changeWord, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void AlarmPlayer::endAudible(std::chrono::steady_clock::time_point now){
+    if(m_audible) m_audible->audible += std::max(now - m_audibleSince, std::chrono::steady_clock::duration::zero());
+    m_audible = nullptr;
 }
 
-void AlarmPlayer::beep(bool noisy){
+void AlarmPlayer::beep(bool noisy, std::chrono::steady_clock::time_point now){
+    // Count the audible time of the alarm that was beeping, then of the one beeping from now on
+    this->endAudible(now);
+    if(noisy){
+        m_audible = m_current;
+        m_audibleSince = now;
+    }
     m_noisy = noisy;
-    std::cout << (noisy?"X\a":"_") << std::flush;
+    this->journal(AlarmJournalEvent::EDGE, now, m_alarmList.empty() ? nullptr : m_current, noisy);
+    this->publish(AlarmEventType::NOISE, now, m_alarmList.empty() ? nullptr : m_current);
+    AlarmEdge edge;
+    edge.time = now;
+    edge.noisy = noisy;
+    if(m_scheduler.post(m_sink, edge)){
+        if(m_edgePending) m_scheduler.m_sinkCoalesced++; // The pending edge is superseded by this one
+        m_edgePending = false;
+        return;
+    }
+    // Ring is full: keep the latest edge aside, it is queued by a later update
+    if(m_edgePending) m_scheduler.m_sinkCoalesced++;
+    m_pendingEdge = edge;
+    m_edgePending = true;
 }
 
 bool AlarmPlayer::isPlaying(){
-    return m_alarmList.size();
+    return m_playing.load(std::memory_order_acquire);
 }
 
 bool AlarmPlayer::isNoisy(){
-    return m_noisy;
-}
\ No newline at end of file
+    return m_noisy.load(std::memory_order_acquire);
+}
+
+std::uint64_t AlarmPlayer::getSequence(){
+    return m_sequence.load(std::memory_order_acquire);
+}
+
+AlarmEvent AlarmPlayer::getLastEvent(){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    return m_lastEvent;
+}
+
+std::uint64_t AlarmPlayer::waitForChange(std::uint64_t lastSequence, std::chrono::nanoseconds timeout){
+    // The timeout is measured on the clock of the scheduler, and converted to the steady clock of the futex like the scheduler deadlines.
+    // Other clocks don't wake the futex when they move, so their waits are sliced to notice it.
+    static const std::chrono::milliseconds CLOCK_SLICE(1);
+    AlarmClock& clock = m_scheduler.getClock();
+    bool steady = dynamic_cast<AlarmSteadyClock*>(&clock) != nullptr;
+    bool forever = timeout == std::chrono::nanoseconds::max();
+    std::chrono::steady_clock::time_point deadline = forever ? std::chrono::steady_clock::time_point::max() : clock.now() + timeout;
+    m_waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::uint64_t sequence;
+    while(true){
+        // The word is read first: if it changes after, the futex doesn't sleep
+        std::uint32_t word = m_changeWord.load(std::memory_order_acquire);
+        sequence = m_sequence.load(std::memory_order_acquire);
+        if(sequence != lastSequence) break;
+        timespec remaining;
+        if(!forever){
+            std::chrono::nanoseconds left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - clock.now());
+            if(left <= std::chrono::nanoseconds::zero()) break;
+            if(!steady) left = std::min<std::chrono::nanoseconds>(left, CLOCK_SLICE);
+            remaining.tv_sec = left.count() / 1000000000;
+            remaining.tv_nsec = left.count() % 1000000000;
+        }
+        ::syscall(SYS_futex, &m_changeWord, FUTEX_WAIT_PRIVATE, word, forever ? nullptr : &remaining, nullptr, 0);
+    }
+    m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    return sequence;
+}
+
+void AlarmPlayer::addObserver(AlarmObserver* observer){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    if(std::find(m_observers.begin(), m_observers.end(), observer) == m_observers.end()) m_observers.push_back(observer);
+}
+
+void AlarmPlayer::removeObserver(AlarmObserver* observer){
+    AlarmTimedLock<std::mutex> lock(m_alarmList_mtx, m_listWait, m_listHold);
+    m_observers.erase(std::remove(m_observers.begin(), m_observers.end(), observer), m_observers.end());
+}
+
+bool AlarmPlayer::isRunning(){
+    return m_scheduler.isRunning();
+}
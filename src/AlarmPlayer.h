@@ -14,92 +14,520 @@
 #include <algorithm>
 #include <thread>
 #include <mutex>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
 
-class Alarm; //Forward-declaration of the Alarm class
+#include "Alarm.h"
+#include "AlarmTimingWheel.h"
+#include "AlarmSink.h"
+#include "AlarmMetrics.h"
+#include "AlarmJournal.h"
+#include "AlarmObserver.h"
+
+class AlarmScheduler; //Forward-declaration of the AlarmScheduler class
+
+/**
+ * @brief Change of an \see Alarm applied by \see AlarmPlayer::apply() together with other changes
+ */
+struct AlarmChange {
+    /**
+     * @brief Kind of change
+     */
+    enum class Type { START, STOP, SET_LEVEL, ACKNOWLEDGE };
+
+    Type type = Type::START; /**< Kind of change */
+    AlarmHandle alarm; /**< Handle of the changed alarm */
+    AlarmLevel level = AlarmLevel::LOW; /**< New level, for SET_LEVEL */
+    std::chrono::milliseconds position = std::chrono::milliseconds(0); /**< Position to start playing from, for START */
+
+    /**
+     * @brief Change starting an alarm, \see Alarm::start()
+     */
+    static AlarmChange start(const Alarm& alarm, std::chrono::milliseconds position = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Change stopping an alarm, \see Alarm::stop()
+     */
+    static AlarmChange stop(const Alarm& alarm);
+
+    /**
+     * @brief Change of the level of an alarm, a started alarm keeps its playback position
+     */
+    static AlarmChange setLevel(const Alarm& alarm, AlarmLevel level);
+
+    /**
+     * @brief Change acknowledging an alarm, \see Alarm::acknowledge()
+     */
+    static AlarmChange acknowledge(const Alarm& alarm);
+};
+
+/**
+ * @brief Policies of the \see AlarmPlayer to choose the played alarm among the attached ones
+ */
+enum class AlarmArbitrationPolicy {
+    STRICT, /**< The highest priority alarm is always played, lower levels are muted as long as it is attached */
+    INTERLEAVED /**< Every few cycles of the highest priority alarm, the highest priority alarm of the levels below plays for one cycle */
+};
+
+/**
+ * @brief Arbitration settings of an \see AlarmPlayer
+ * Whatever the policy, a change of the attached alarms is resolved by the next update of the player,
+ * which the \see AlarmScheduler runs immediately: its delay is recorded in \see AlarmPlayerMetrics::switchLatency.
+ */
+struct AlarmArbitration {
+    AlarmArbitrationPolicy policy = AlarmArbitrationPolicy::STRICT; /**< Policy choosing the played alarm */
+    unsigned int interleave = 4; /**< For INTERLEAVED, number of sequence cycles of the highest priority alarm between two cycles of a lower level one, at least 1 */
+};
 
 /**
  * @brief Representation of an alarm player that emit with a tone sequence
  * This class plays attached \see Alarms depending on their priority level
- * \warning This class is a singleton, access to its single-instance is availbale through the Instance() static function
+ * Alarms are referenced through their \see AlarmHandle, so a stale reference is detected instead of dereferenced
+ * Each AlarmPlayer is an independent output (e.g. one per zone) with its own alarms and priority resolution,
+ * Alarms play on the default player returned by Instance() unless bound to another one with \see Alarm::setPlayer()
+ * Players don't own a thread, their tone edges are played by an \see AlarmScheduler shared by many players
  */
 class AlarmPlayer  {
 friend Alarm;
+friend AlarmScheduler;
 public:
 
     /**
-     * @brief Getter of signle Instance of the AlarmPlayer (Singleton)
-     * \return the instance of the AlarmPlayer
+     * @brief Getter of the default AlarmPlayer, used by Alarms not bound to another player
+     * \return the default instance of the AlarmPlayer, created on first use and printing to the standard output
      */
     static AlarmPlayer& Instance();
 
+    /**
+     * @brief Constructor of an AlarmPlayer printing to a stream, played by the default \see AlarmScheduler
+     * No thread is started until an Alarm is attached
+     * \param output : the stream tones are printed to through an \see AlarmStreamSink, must outlive the AlarmPlayer
+     */
+    AlarmPlayer(std::ostream& output = std::cout);
+
+    /**
+     * @brief Constructor of an AlarmPlayer printing to a stream, played by a chosen \see AlarmScheduler
+     * \param output : the stream tones are printed to through an \see AlarmStreamSink, must outlive the AlarmPlayer
+     * \param scheduler : the scheduler playing the tone edges, must outlive the AlarmPlayer
+     */
+    AlarmPlayer(std::ostream& output, AlarmScheduler& scheduler);
+
+    /**
+     * @brief Constructor of an AlarmPlayer emitting to a sink, played by the default \see AlarmScheduler
+     * \param sink : the output of the tone edges, must outlive the AlarmPlayer
+     */
+    AlarmPlayer(AlarmSink& sink);
+
+    /**
+     * @brief Constructor of an AlarmPlayer emitting to a sink, played by a chosen \see AlarmScheduler
+     * \param sink : the output of the tone edges, must outlive the AlarmPlayer
+     * \param scheduler : the scheduler playing the tone edges, must outlive the AlarmPlayer
+     */
+    AlarmPlayer(AlarmSink& sink, AlarmScheduler& scheduler);
+
+    /**
+     * @brief Destructor of the AlarmPlayer, detaches every alarm and stops the thread
+     * \warning Alarms bound to this player must not be started again once it is destroyed
+     */
+    ~AlarmPlayer();
+
     /**
      * @brief Wether an Alarm is currently being played
-     * This can be used for sync with any other user-feedback system, and useful for tests
+     * Read atomically without lock, other feedback systems should rather follow the changes with \see waitForChange()
      * \return true if an alarm is currently being played, false otherwise
      */
     bool isPlaying();
 
     /**
      * @brief Wether the AlarmPlayer is currently eitting noise
-     * This can be used for sync with any other user-feedback system, and useful for tests
+     * Read atomically without lock, other feedback systems should rather follow the changes with \see waitForChange()
      * \return true if a noise is currently being emitted, false otherwise
      */
     bool isNoisy();
 
+    /**
+     * @brief Getter of the sequence number of the last change, see \see AlarmEvent
+     * \return 0 before the first change
+     */
+    std::uint64_t getSequence();
+
+    /**
+     * @brief Getter of the last change
+     * \return the change, a default event before the first one
+     */
+    AlarmEvent getLastEvent();
+
+    /**
+     * @brief Waits for a change of the player, blocking on a futex: a waiting thread costs nothing until woken
+     * Changes are never waited for through a lock of the player, and players only wake the futex while a thread waits on it
+     * \param lastSequence : the sequence number of the last change seen by the caller, e.g. returned by the previous call
+     * \param timeout : the longest wait on the clock of the scheduler, nanoseconds::max() to wait without timeout
+     * \return the sequence number of the last change, lastSequence on timeout
+     * \warning Waiting threads must return before the player is destroyed
+     */
+    std::uint64_t waitForChange(std::uint64_t lastSequence, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+
+    /**
+     * @brief Registers an observer notified of every change, see \see AlarmObserver
+     * \param observer : the observer, must stay valid until removed
+     */
+    void addObserver(AlarmObserver* observer);
+
+    /**
+     * @brief Unregisters an observer, it is not notified anymore once this function returns
+     * \param observer : the observer, no effect if it is not registered
+     */
+    void removeObserver(AlarmObserver* observer);
+
+    /**
+     * @brief Wether the thread of the \see AlarmScheduler has been started, which happens on the first attachment
+     * \return true if the playback thread is running, false otherwise
+     */
+    bool isRunning();
+
+    /**
+     * @brief Applies several changes of alarms bound to this player as a single transaction
+     * Changes are applied in order under a single lock, then the priority is resolved once:
+     * the playback never observes a partially applied batch, and emits at most one edge for it.
+     * \param changes : the changes, changes of alarms bound to another player or with a stale handle are ignored
+     */
+    void apply(std::initializer_list<AlarmChange> changes);
+
+    /**
+     * @brief Applies several changes as a single transaction, \see apply()
+     * \param changes : the changes
+     */
+    void apply(const std::vector<AlarmChange>& changes);
+
+    /**
+     * @brief Setter of the arbitration between the attached alarms
+     * \param arbitration : the new settings, strict priority by default
+     */
+    void setArbitration(const AlarmArbitration& arbitration);
+
+    /**
+     * @brief Getter of the arbitration between the attached alarms
+     */
+    AlarmArbitration getArbitration();
+
+    /**
+     * @brief Setter of the journal recording the starts, stops, level changes, preemptions and tone edges of the player
+     * Records are appended from the playback and the alarm calls without lock nor syscall, see \see AlarmJournal
+     * \param journal : the journal, must outlive its use by the player, nullptr to stop journaling
+     * \param zone : the zone of the records of the player, telling apart the players sharing a journal
+     */
+    void setJournal(AlarmJournal* journal, std::uint16_t zone = 0);
+
+    /**
+     * @brief Getter of the instrumentation of the player
+     * Recording costs a few nanoseconds per update and per lock, the snapshot can be taken at any time from any thread
+     * \return a copy of the histograms and counters, durations in nanoseconds
+     */
+    AlarmPlayerMetrics getMetrics();
+
+    /**
+     * @brief Forgets the instrumentation recorded so far, including the process-wide sequence lock times
+     */
+    void resetMetrics();
+
 protected:
 
+    // Functions acting on an alarm return false without effect when the alarm is bound to another player,
+    // its binding having changed concurrently: the Alarm then retries on that player
+
     /**
      * @brief Attaches a new alarm to the AlarmPlayer for playback
-     * \param alarm : the alarm to be attached
-     * \warning if the alarm has already been attached, this function has no effect
+     * \param alarm : the handle of the alarm to be attached
+     * \param position : the position in the alarm sequence to start playing from
+     * \return false if the alarm is bound to another player
+     * \warning if the alarm has already been started, or its handle is stale, this function has no effect
      */
-    void attach(Alarm* alarm);
+    bool attach(AlarmHandle alarm, std::chrono::milliseconds position);
 
     /**
      * @brief Detaches an alarm from the AlarmPlayer
-     * \param alarm : the alarm to be detached
-     * \warning if the alarm has already been detached, or has not been attached, this function has no effect
+     * \param alarm : the handle of the alarm to be detached
+     * \return false if the alarm is bound to another player
+     * \warning if the alarm has not been started, or its handle is stale, this function has no effect
+     */
+    bool detach(AlarmHandle alarm);
+
+    /**
+     * @brief Changes the level of an alarm, moving it to its new priority bucket in place if it is attached
+     * \param alarm : the handle of the alarm
+     * \param level : the new level
+     * \param restart : wether the playback restarts from the begining of the sequence, otherwise its position is kept
+     * \return false if the alarm is bound to another player
      */
-    void detach(Alarm* alarm);
+    bool relevel(AlarmHandle alarm, AlarmLevel level, bool restart);
+
+    /**
+     * @brief Changes the escalation of an alarm, rescheduling its next step if it is attached
+     * \param alarm : the handle of the alarm
+     * \param escalation : the new escalation
+     * \return false if the alarm is bound to another player
+     */
+    bool escalate(AlarmHandle alarm, const AlarmEscalation& escalation);
+
+    /**
+     * @brief Getter of the escalation of an alarm
+     * \param alarm : the handle of the alarm to look at
+     * \param escalation : receives the escalation, empty if the handle is stale
+     * \return false if the alarm is bound to another player
+     */
+    bool getEscalation(AlarmHandle alarm, AlarmEscalation& escalation);
+
+    /**
+     * @brief Acknowledges an attached alarm, restoring its level and restarting its escalation
+     * \param alarm : the handle of the alarm
+     * \return false if the alarm is bound to another player
+     */
+    bool acknowledge(AlarmHandle alarm);
+
+    /**
+     * @brief Binds an alarm to another player, detaching it from this one
+     * The alarm keeps its started state, it must then be attached to its new player with \see resume()
+     * \param alarm : the handle of the alarm
+     * \param player : the new player of the alarm
+     * \param moved : set to true if the alarm is started and must be resumed on its new player
+     * \return false if the alarm is bound to another player
+     */
+    bool rebind(AlarmHandle alarm, AlarmPlayer& player, bool& moved);
+
+    /**
+     * @brief Attaches a started alarm bound from another player by \see rebind(), from the begining of its sequence
+     * \param alarm : the handle of the alarm
+     * \return false if the alarm is bound to another player
+     * \warning if the alarm has been stopped meanwhile, or is already attached, this function has no effect
+     */
+    bool resume(AlarmHandle alarm);
+
+    /**
+     * @brief Requests the \see AlarmScheduler to re-evaluate the attached alarms
+     * Used by \see Alarm when its sequence changes while being played
+     */
+    void refresh();
+
+    /**
+     * @brief Moves the playback cursor of an attached alarm
+     * \param alarm : the handle of the alarm to move
+     * \param position : the new position in the alarm sequence
+     * \return false if the alarm is bound to another player
+     */
+    bool seek(AlarmHandle alarm, std::chrono::milliseconds position);
+
+    /**
+     * @brief Getter of the playback cursor of an attached alarm
+     * \param alarm : the handle of the alarm to look at
+     * \param position : receives the position in the alarm sequence, wrapped at the end of the sequence,
+     * 0 if the handle is stale or the alarm has not been started
+     * \return false if the alarm is bound to another player
+     */
+    bool getPosition(AlarmHandle alarm, std::chrono::milliseconds& position);
+
+    /**
+     * @brief Getter of the counters of an alarm
+     * \param alarm : the handle of the alarm to look at
+     * \param stats : receives the counters, the ongoing beep included, zero if the handle is stale
+     * \return false if the alarm is bound to another player
+     */
+    bool getStats(AlarmHandle alarm, AlarmStats& stats);
 
 private:
 
     /**
-     * @brief Playback thread of the AlarmPlayer
+     * @brief Applies changes, \see apply()
+     * \param changes : the first change
+     * \param count : the number of changes
      */
-    void run();
-    bool m_alive = true; /**< Used during destruction to stop the thread and prevent attachments  */
-    std::thread m_playerThread; /**< Stores the playback thread instance */
+    void apply(const AlarmChange* changes, std::size_t count);
+
+    /**
+     * @brief Wether an alarm is bound to this player, only this player may then change its state
+     * \param alarm : the state of the alarm
+     */
+    bool owns(const AlarmSlot* alarm) const;
+
+    /**
+     * @brief Attaches an alarm in the STARTED state, m_alarmList_mtx must be locked
+     * \param alarm : the state of the alarm
+     * \param position : the position in the alarm sequence to start playing from
+     * \param now : the time of the attachment
+     * \return false if the alarm was already attached
+     */
+    bool attachLocked(AlarmSlot* alarm, std::chrono::milliseconds position, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Detaches an alarm started again through its handle while being destroyed, see \see Alarm::destroy()
+     * \param alarm : the retired state of the alarm, see \see AlarmPool::retire()
+     */
+    void detachRetired(AlarmSlot* alarm);
+
+    /**
+     * @brief Detaches an alarm, m_alarmList_mtx must be locked
+     * \param alarm : the state of the alarm
+     * \param now : the time of the detachment
+     * \param state : the state of the alarm once detached
+     */
+    void detachLocked(AlarmSlot* alarm, std::chrono::steady_clock::time_point now, AlarmState state);
+
+    /**
+     * @brief Changes the level of an alarm, \see relevel(), m_alarmList_mtx must be locked
+     * \param alarm : the state of the alarm
+     * \param level : the new level
+     * \param restart : wether the playback restarts from the begining of the sequence
+     * \param now : the time of the change
+     * \return true if the playback of the player may change
+     */
+    bool relevelLocked(AlarmSlot* alarm, AlarmLevel level, bool restart, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Acknowledges an alarm, \see acknowledge(), m_alarmList_mtx must be locked
+     * \param alarm : the state of the alarm
+     * \param now : the time of the acknowledgment
+     * \return false if the alarm is not attached
+     */
+    bool acknowledgeLocked(AlarmSlot* alarm, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Schedules the next escalation step of an attached alarm in \see m_escalations, m_alarmList_mtx must be locked
+     * \param alarm : the state of the alarm, unscheduled if it has no step left
+     */
+    void scheduleEscalation(AlarmSlot* alarm);
+
+    /**
+     * @brief Raises the alarms whose escalation step is due, m_alarmList_mtx must be locked
+     * \param now : the current time of the scheduler thread
+     */
+    void escalateLocked(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Converts a time point to a tick of \see m_escalations, the milliseconds since \see m_escalationEpoch
+     * \param time : the time point
+     * \param roundUp : wether a partial millisecond counts as a whole one, so a deadline is never reached early
+     */
+    std::uint64_t escalationTick(std::chrono::steady_clock::time_point time, bool roundUp) const;
+
+    /**
+     * @brief Chooses the alarm to play according to \see m_arbitration, m_alarmList_mtx must be locked and the list not empty
+     * \param now : the current time of the scheduler thread
+     * \return the alarm to play
+     */
+    AlarmSlot* arbitrate(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Plays the highest priority alarm, called by the \see AlarmScheduler
+     * The scheduler calls it again at the returned deadline, or earlier after \see attach(), \see detach() or \see refresh()
+     * \param now : the current time of the scheduler thread
+     * \return the deadline of the next tone edge, or time_point::max() if the player is idle
+     */
+    std::chrono::steady_clock::time_point update(std::chrono::steady_clock::time_point now);
+    bool m_alive = true; /**< Used during destruction to prevent attachments, protected by m_alarmList_mtx */
+    AlarmScheduler& m_scheduler; /**< Scheduler playing the tone edges of this player */
+    AlarmTimerHook<AlarmPlayer> m_timer; /**< Links the player in the \see AlarmScheduler timing wheel */
 
     /**
      * @brief Update playback position of an alarm
-     * This function will select the tone in the Alarm's sequence, and call the \see beep() function
-     * \param alarm : the alarm to playback
+     * This function will look up the tone in the Alarm's sequence timeline, and call the \see beep() function on tone edges
+     * \param alarm : the state of the alarm to playback
+     * \param now : the current time of the playback thread
+     * \return the deadline of the next tone edge, or time_point::max() if the alarm has nothing to play
+     */
+    std::chrono::steady_clock::time_point updateAlarm(AlarmSlot* alarm, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Update playback of an alarm playing an \see AlarmToneSource
+     * Pulls the tones ended since the last update, and detaches the alarm once its source is exhausted
+     * \param alarm : the state of the alarm to playback, \see AlarmSlot::origin being the start of its current tone
+     * \param source : the source of the alarm
+     * \param now : the current time of the playback thread
+     * \return the deadline of the end of the current tone, \see updateAlarm()
      */
-    void updateAlarm(Alarm* alarm);
+    std::chrono::steady_clock::time_point updateSource(AlarmSlot* alarm, AlarmToneSource& source, std::chrono::steady_clock::time_point now);
 
     /**
      * @brief Emits noise depending on \see noisy parameter
+     * The edge is queued for the sink thread of the \see AlarmScheduler, this function never waits for the \see AlarmSink
      * \param noisy : true for a sound to be played, false for silence
-     * \warning This function is a mockup and doesn't actually communicates with noise-emitting hardware
-     *          An 'X' will be printed to the standard output when noisy is true
-     *          An '_' will be printed to the standard output when noisy is false
-     *          As an attempt to produce sound, a '\a' is also printed when noisy is true
+     * \param now : the time of the edge
+     */
+    void beep(bool noisy, std::chrono::steady_clock::time_point now);
+    std::atomic<bool> m_noisy; /**< Stores the latest request to the \see beep() function, written under m_alarmList_mtx */
+    std::atomic<bool> m_playing; /**< Wether an alarm is attached, written under m_alarmList_mtx */
+    std::unique_ptr<AlarmStreamSink> m_streamSink; /**< Sink owned by the player when built from a stream */
+    AlarmSink& m_sink; /**< Output of the tone edges */
+    AlarmEdge m_pendingEdge; /**< Latest edge not queued yet, the ring being full, with the COALESCE \see AlarmSinkPolicy */
+    bool m_edgePending = false; /**< Wether \see m_pendingEdge is waiting to be queued */
+
+    AlarmSlot* m_current = nullptr; /**< State of the alarm currently being played, used to detect preemption */
+    AlarmSlot* m_audible = nullptr; /**< State of the alarm currently beeping, nullptr while silent, its audible time is counted on the next edge */
+    std::chrono::steady_clock::time_point m_audibleSince; /**< Time at which \see m_audible started beeping */
+    std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max(); /**< Deadline returned by the last \see update() */
+    std::chrono::steady_clock::time_point m_changedAt = std::chrono::steady_clock::time_point::max(); /**< Time of the first change of the attached alarms since the last \see update() */
+
+    AlarmArbitration m_arbitration; /**< Arbitration settings */
+    AlarmSlot* m_sliceTop = nullptr; /**< Highest priority alarm the INTERLEAVED slices are counted for */
+    unsigned long long m_sliceCycle = 0; /**< Cycle of \see m_sliceTop at which the next slice starts */
+    AlarmSlot* m_slice = nullptr; /**< Lower level alarm being played for a slice, nullptr outside of slices */
+    std::chrono::steady_clock::time_point m_sliceEnd; /**< End of the slice of \see m_slice */
+
+    /**
+     * @brief Appends a record to \see m_journal, if any, m_alarmList_mtx must be locked
+     * \param event : the kind of event
+     * \param now : the time of the event
+     * \param alarm : the state of the alarm, nullptr for none
+     * \param value : the detail of the event
+     * \param other : the detail of the event
+     */
+    void journal(AlarmJournalEvent event, std::chrono::steady_clock::time_point now, const AlarmSlot* alarm, std::uint8_t value, std::uint32_t other = 0);
+    AlarmJournal* m_journal = nullptr; /**< Journal of the events, protected by m_alarmList_mtx */
+    std::uint16_t m_journalZone = 0; /**< Zone of the records in \see m_journal */
+
+    /**
+     * @brief Publishes a change: numbers it, notifies the observers and flags the threads waiting for it, m_alarmList_mtx must be locked
+     * The caller wakes the flagged threads with \see wakeWaiters() once unlocked, so the syscall never holds the lock
+     * \param type : the kind of change
+     * \param now : the time of the change
+     * \param alarm : the state of the alarm of the change, nullptr for none
+     * \param other : the state of the second alarm of the change, nullptr for none
+     */
+    void publish(AlarmEventType type, std::chrono::steady_clock::time_point now, const AlarmSlot* alarm, const AlarmSlot* other = nullptr);
+    std::vector<AlarmObserver*> m_observers; /**< Observers of the changes, protected by m_alarmList_mtx */
+    AlarmEvent m_lastEvent; /**< Last change, protected by m_alarmList_mtx */
+    std::atomic<std::uint64_t> m_sequence; /**< Sequence number of the last change */
+    std::atomic<std::uint32_t> m_changeWord; /**< Low bits of \see m_sequence, the futex word the waiters block on */
+    std::atomic<unsigned int> m_waiters; /**< Number of threads in \see waitForChange(), the futex is only woken for them */
+    std::atomic<bool> m_wakePending; /**< Set by \see publish() when threads wait, cleared by the wake */
+
+    /**
+     * @brief Wakes the threads waiting for a change published since the last wake, if any, m_alarmList_mtx must not be locked
+     */
+    void wakeWaiters();
+
+    /**
+     * @brief Stops counting the audible time of \see m_audible, m_alarmList_mtx must be locked
+     * \param now : the end of the beep
      */
-    void beep(bool noisy);
-    volatile bool m_noisy = false; /**< Stores the latest request to the \see beep() function */
+    void endAudible(std::chrono::steady_clock::time_point now);
 
-    unsigned int m_interval_ms = 250; /**< Fixed duration of a single \see beep() */
+    AlarmHistogram m_tickLateness; /**< \see AlarmPlayerMetrics::tickLateness, in nanoseconds */
+    AlarmHistogram m_switchLatency; /**< \see AlarmPlayerMetrics::switchLatency, in nanoseconds */
+    AlarmHistogram m_listWait; /**< \see AlarmPlayerMetrics::alarmList, in \see AlarmStopwatch ticks */
+    AlarmHistogram m_listHold; /**< \see AlarmPlayerMetrics::alarmList, in \see AlarmStopwatch ticks */
+    AlarmHistogram m_attachToAudible[AlarmPlayerMetrics::LEVELS]; /**< \see AlarmPlayerMetrics::attachToAudible, in nanoseconds */
+    std::atomic<unsigned long long> m_updates; /**< \see AlarmPlayerMetrics::updates */
+    std::atomic<unsigned long long> m_preemptions; /**< \see AlarmPlayerMetrics::preemptions */
 
-    std::vector<Alarm*> m_alarmList; /**< List of attached alarm, sorted by priority level, highest first */
+    AlarmQueue<AlarmSlot, &AlarmSlot::queueHook> m_alarmList; /**< Priority index of attached alarms, one FIFO list per level */
+    AlarmTimingWheel<AlarmSlot, &AlarmSlot::escalationTimer> m_escalations; /**< Next escalation deadline of every attached alarm having one, protected by m_alarmList_mtx */
+    std::chrono::steady_clock::time_point m_escalationEpoch; /**< Time of tick 0 of \see m_escalations */
     std::mutex m_alarmList_mtx; /**< Protects the alarmList from concurrent access */
 
-    //AlarmPlayer is a singleton, so its constructors are private
     AlarmPlayer& operator= (const AlarmPlayer&) = delete;
-    AlarmPlayer (const AlarmPlayer&);
-    static AlarmPlayer m_instance;
-    AlarmPlayer(); /**< Constructor of the AlarmPlayer, privatized by Singleton */
-    ~AlarmPlayer(); /**< Destructor of the AlarmPlayer, privatized by Singleton. Detaches every alarm and stops the thread. */
+    AlarmPlayer (const AlarmPlayer&) = delete;
 };
 
 #endif //AlarmPlayer_h
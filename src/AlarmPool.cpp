@@ -0,0 +1,145 @@
+#include "AlarmPool.h"
+#include <thread>
+
+static const std::uint32_t NO_SLOT = 0xFFFFFFFF; // End of the free list
+
+AlarmEscalation::AlarmEscalation(std::initializer_list<AlarmEscalationStep> steps){
+    for(const AlarmEscalationStep& step : steps){
+        if(count == MAX_STEPS) break;
+        // Insertion sort by delay, steps of equal delay keep their order
+        std::size_t i = count++;
+        for(;i && this->steps[i-1].after > step.after;i--) this->steps[i] = this->steps[i-1];
+        this->steps[i] = step;
+    }
+}
+
+AlarmPool& AlarmPool::Instance() {
+    static AlarmPool instance; // Function-local so it is ready before any Alarm, whatever the static-initialization order
+    return instance;
+}
+
+AlarmPool::AlarmPool() : m_freeHead(NO_SLOT) {
+    for(std::atomic<AlarmSlot*>& chunk : m_chunks) chunk = nullptr;
+}
+
+AlarmPool::~AlarmPool() {
+    for(std::size_t i=0;i<m_chunkCount;i++) delete[] m_chunks[i].load();
+}
+
+AlarmHandle AlarmPool::create(){
+    AlarmHandle handle;
+    m_mtx.lock();
+    if(m_freeHead != NO_SLOT || this->grow()){
+        handle.index = m_freeHead;
+        AlarmSlot* slot = &m_chunks[handle.index / CHUNK_SIZE].load()[handle.index % CHUNK_SIZE];
+        m_freeHead = slot->nextFree;
+        handle.generation = slot->generation;
+        m_size++;
+    }
+    m_mtx.unlock();
+    return handle;
+}
+
+void AlarmPool::destroy(AlarmHandle handle){
+    if(AlarmSlot* slot = this->retire(handle)) this->recycle(slot);
+}
+
+AlarmSlot* AlarmPool::retire(AlarmHandle handle){
+    AlarmSlot* slot = this->get(handle);
+    if(!slot) return nullptr;
+    std::uint32_t next = handle.generation + 1;
+    if(!next) next++; // Generation 0 is reserved to null handles
+    // Stale first, so no new pin is granted, then wait for the pins granted before: their users hold them for the length of a call
+    if(!slot->generation.compare_exchange_strong(handle.generation, next, std::memory_order_seq_cst)) return nullptr; // Destroyed meanwhile
+    while(slot->pins.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    return slot;
+}
+
+void AlarmPool::recycle(AlarmSlot* slot){
+    // Reset the state for the next alarm, the slot memory is kept
+    slot->level = AlarmLevel::LOW;
+    slot->state = AlarmState::IDLE;
+    slot->player = nullptr;
+    std::atomic_store(&slot->sequence, AlarmSequence::empty());
+    slot->inlineSequence = AlarmSequence(nullptr, 0, nullptr, 0);
+    std::atomic_store(&slot->source, AlarmToneSource::Ptr());
+    slot->sourcePulled = false;
+    slot->sourcePlayed = 0;
+    slot->toneIndex = 0;
+    slot->toneCycle = 0;
+    slot->position = std::chrono::steady_clock::duration::zero();
+    slot->toneEdge = true;
+    slot->rewind = false;
+    slot->awaitingAudible = false;
+    slot->audible = std::chrono::steady_clock::duration::zero();
+    slot->preempted = 0;
+    slot->escalation = AlarmEscalation();
+    slot->escalationStep = 0;
+    m_mtx.lock();
+    slot->nextFree = m_freeHead;
+    m_freeHead = slot->index;
+    m_size--;
+    m_mtx.unlock();
+}
+
+AlarmSlot* AlarmPool::get(AlarmHandle handle) const {
+    if(!handle || handle.index / CHUNK_SIZE >= MAX_CHUNKS) return nullptr;
+    AlarmSlot* chunk = m_chunks[handle.index / CHUNK_SIZE].load(std::memory_order_acquire);
+    if(!chunk) return nullptr;
+    AlarmSlot* slot = &chunk[handle.index % CHUNK_SIZE];
+    return slot->generation == handle.generation ? slot : nullptr; // Stale handle
+}
+
+AlarmSlot* AlarmPool::pin(AlarmHandle handle){
+    if(!handle || handle.index / CHUNK_SIZE >= MAX_CHUNKS) return nullptr;
+    AlarmSlot* chunk = m_chunks[handle.index / CHUNK_SIZE].load(std::memory_order_acquire);
+    if(!chunk) return nullptr;
+    AlarmSlot* slot = &chunk[handle.index % CHUNK_SIZE];
+    // Pinned before the generation is checked: either retire() sees the pin, or the pin sees the new generation
+    slot->pins.fetch_add(1, std::memory_order_seq_cst);
+    if(slot->generation.load(std::memory_order_seq_cst) == handle.generation) return slot;
+    this->unpin(slot); // Stale handle
+    return nullptr;
+}
+
+void AlarmPool::unpin(AlarmSlot* slot){
+    slot->pins.fetch_sub(1, std::memory_order_release);
+}
+
+void AlarmPool::reserve(std::size_t count){
+    m_mtx.lock();
+    while(m_chunkCount * CHUNK_SIZE < count && this->grow());
+    m_mtx.unlock();
+}
+
+std::size_t AlarmPool::size(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_size;
+}
+
+std::size_t AlarmPool::capacity(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_chunkCount * CHUNK_SIZE;
+}
+
+bool AlarmPool::grow(){
+    if(m_chunkCount == MAX_CHUNKS) return false;
+    AlarmSlot* chunk = new AlarmSlot[CHUNK_SIZE];
+    // Link the new slots in the free list, lowest index first
+    std::uint32_t first = m_chunkCount * CHUNK_SIZE;
+    for(std::size_t i=0;i<CHUNK_SIZE;i++){
+        chunk[i].index = first + i;
+        chunk[i].nextFree = i+1 < CHUNK_SIZE ? first+i+1 : m_freeHead;
+    }
+    m_freeHead = first;
+    m_chunks[m_chunkCount++].store(chunk, std::memory_order_release);
+    return true;
+}
+
+AlarmSlotPin::AlarmSlotPin(AlarmHandle handle) : m_slot(AlarmPool::Instance().pin(handle)) {
+
+}
+
+AlarmSlotPin::~AlarmSlotPin() {
+    if(m_slot) AlarmPool::Instance().unpin(m_slot);
+}
@@ -0,0 +1,252 @@
+/**
+ *  @file   AlarmPool.h
+ *  @brief  Define the AlarmPool storing the state of every Alarm, and its AlarmHandle
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmPool_h
+#define AlarmPool_h
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <initializer_list>
+
+#include "AlarmSequence.h"
+#include "AlarmToneSource.h"
+#include "AlarmQueue.h"
+#include "AlarmMetrics.h"
+#include "AlarmTimingWheel.h"
+
+class AlarmPlayer; //Forward-declaration of the AlarmPlayer class
+
+/**
+ * @brief Generation-checked reference to an \see AlarmSlot of the \see AlarmPool
+ * A handle becomes stale once its slot is destroyed, even if the slot is reused by another alarm
+ */
+struct AlarmHandle {
+    std::uint32_t index = 0; /**< Index of the slot in the pool */
+    std::uint32_t generation = 0; /**< Generation of the slot when the handle was created, 0 for a null handle */
+
+    bool operator==(const AlarmHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const AlarmHandle& other) const { return !(*this == other); }
+    explicit operator bool() const { return generation != 0; }
+};
+
+/**
+ * @brief Lifecycle of an alarm
+ * IDLE until started, STARTED while attached to its player and waiting to be played,
+ * PLAYING while being the highest priority alarm of its player, PREEMPTED once paused for a higher priority one
+ */
+enum class AlarmState { IDLE, STARTED, PLAYING, PREEMPTED };
+
+/**
+ * @brief Step of an \see AlarmEscalation: the level an alarm is raised to once unacknowledged for a while
+ */
+struct AlarmEscalationStep {
+    std::chrono::milliseconds after = std::chrono::milliseconds(0); /**< Time since the start or the last acknowledgment of the alarm */
+    AlarmLevel level = AlarmLevel::LOW; /**< Level the alarm is raised to, a step not raising the alarm is skipped */
+
+    AlarmEscalationStep() = default;
+    AlarmEscalationStep(std::chrono::milliseconds after, AlarmLevel level) : after(after), level(level) {}
+};
+
+/**
+ * @brief Levels an alarm is raised to while it is not acknowledged, e.g. LOW to MEDIUM after 5 minutes then HIGH after 15:
+ * `AlarmEscalation({{std::chrono::minutes(5), AlarmLevel::MEDIUM}, {std::chrono::minutes(15), AlarmLevel::HIGH}})`
+ * Stored inside the alarm state, so escalating alarms don't allocate
+ */
+struct AlarmEscalation {
+    static const std::size_t MAX_STEPS = 4; /**< Most steps an escalation holds, later steps are ignored */
+
+    AlarmEscalationStep steps[MAX_STEPS]; /**< Steps, sorted by delay */
+    std::size_t count = 0; /**< Number of steps, 0 for an alarm that never escalates */
+
+    AlarmEscalation() = default;
+
+    /**
+     * @brief Constructor of an AlarmEscalation from its steps, in any order
+     * \param steps : the steps, only the first \see MAX_STEPS are kept
+     */
+    AlarmEscalation(std::initializer_list<AlarmEscalationStep> steps);
+};
+
+/**
+ * @brief State of an alarm, stored in the \see AlarmPool
+ * \warning Internal to Alarm and AlarmPlayer, use the \see Alarm class instead
+ */
+struct AlarmSlot {
+    //Alarm attributes, read lock-free and written under the alarm list mutex of the bound \see AlarmPlayer
+    std::atomic<AlarmLevel> level; /**< The stored \see AlarmLevel of the Alarm */
+    std::atomic<AlarmState> state; /**< The stored \see AlarmState of the Alarm */
+    std::atomic<AlarmPlayer*> player; /**< The \see AlarmPlayer the Alarm is bound to, nullptr for the default one */
+    AlarmSequence::Ptr sequence; /**< The stored sequence snapshot, only accessed through std::atomic_load/atomic_store */
+    std::mutex sequence_mtx; /**< Serializes the writers of the sequence snapshot, never taken by the \see AlarmPlayer */
+    AlarmTone inlineTones[AlarmSequence::INLINE_CAPACITY]; /**< Storage of a short sequence given at construction, never modified afterwards */
+    AlarmSequence inlineSequence = AlarmSequence(nullptr, 0, nullptr, 0); /**< Snapshot over \see inlineTones */
+    AlarmToneSource::Ptr source; /**< Source played instead of the sequence, only accessed through std::atomic_load/atomic_store */
+
+    //Playback attributes, owned by the bound \see AlarmPlayer and protected by its alarm list mutex
+    std::size_t toneIndex = 0; /**< Index of the last emitted \see AlarmTone */
+    unsigned long long toneCycle = 0; /**< Sequence cycle of the last emitted \see AlarmTone */
+    std::chrono::steady_clock::duration position = std::chrono::steady_clock::duration::zero(); /**< Playback position while not being played, in the current tone of a source */
+    std::chrono::steady_clock::time_point origin; /**< Time at which the sequence, or the current tone of a source, started while being played */
+    AlarmTone sourceTone; /**< Tone of the source being played */
+    bool sourcePulled = false; /**< \see sourceTone has been pulled from the source and not fully played yet */
+    unsigned long long sourcePlayed = 0; /**< Milliseconds played by the source before \see sourceTone */
+    bool toneEdge = true; /**< The current \see AlarmTone has not been emitted yet */
+    std::atomic<bool> rewind; /**< Set when the sequence is cleared, so the \see AlarmPLayer restarts from its begining */
+    AlarmQueueHook<AlarmSlot> queueHook; /**< Links the slot in the \see AlarmPlayer priority index */
+    std::chrono::steady_clock::time_point attachedAt; /**< Time of the attachment, for the attach-to-audible latency */
+    bool awaitingAudible = false; /**< The alarm has been attached and has not beeped yet */
+    std::chrono::steady_clock::duration audible = std::chrono::steady_clock::duration::zero(); /**< \see AlarmStats::audible, ongoing beep excluded */
+    unsigned long long preempted = 0; /**< \see AlarmStats::preempted */
+    AlarmEscalation escalation; /**< Escalation of the alarm while started */
+    AlarmLevel escalationBase = AlarmLevel::LOW; /**< Level the alarm was started or last set at, restored by an acknowledgment */
+    std::chrono::steady_clock::time_point escalationSince; /**< Start or last acknowledgment of the alarm, origin of the escalation delays */
+    std::size_t escalationStep = 0; /**< Index of the next escalation step */
+    AlarmTimerHook<AlarmSlot> escalationTimer; /**< Links the slot in the \see AlarmPlayer escalation wheel, at the deadline of its next step */
+
+    //Pool attributes
+    std::atomic<std::uint32_t> generation; /**< Incremented on destruction, so handles to the previous alarm become stale */
+    std::atomic<unsigned int> pins; /**< Number of \see AlarmSlotPin using the slot, waited for by its destruction */
+    std::uint32_t nextFree = 0; /**< Index of the next free slot while this one is free */
+    std::uint32_t index = 0; /**< Index of the slot in the pool, for the handle of its alarm */
+
+    AlarmSlot() : level(AlarmLevel::LOW), state(AlarmState::IDLE), player(nullptr), sequence(AlarmSequence::empty()), rewind(false), generation(1), pins(0) {}
+};
+
+/**
+ * @brief Arena of \see AlarmSlot referenced through \see AlarmHandle
+ * Slots are allocated by chunks of contiguous memory that are never moved nor freed before the pool,
+ * destroyed slots are recycled through a free list: once reserved, creating and destroying alarms
+ * doesn't touch the heap. Stale handles are detected by \see get() instead of being dereferenced.
+ * Threads using a slot through its handle pin it (\see AlarmSlotPin), so its destruction never resets it under them.
+ */
+class AlarmPool {
+public:
+    static const std::size_t CHUNK_SIZE = 1024; /**< Number of slots allocated at once */
+    static const std::size_t MAX_CHUNKS = 4096; /**< Maximum number of chunks, about 4 million alarms */
+
+    /**
+     * @brief Getter of the pool used by every \see Alarm
+     * \return the instance of the AlarmPool, created on first use
+     */
+    static AlarmPool& Instance();
+
+    AlarmPool();
+    ~AlarmPool();
+
+    /**
+     * @brief Creates a new alarm state, with default attributes
+     * \return the handle of the new slot, a null handle if the pool is full
+     */
+    AlarmHandle create();
+
+    /**
+     * @brief Destroys an alarm state, the slot will be reused: \see retire() then \see recycle()
+     * \param handle : the handle of the slot to destroy
+     * \warning if the handle is stale, this function has no effect
+     */
+    void destroy(AlarmHandle handle);
+
+    /**
+     * @brief Makes the handle of a slot stale, the first step of its destruction
+     * The generation is bumped before anything is reset, then the pins taken before are waited for:
+     * once returned, no other thread uses the slot through its handle
+     * \param handle : the handle of the slot to destroy
+     * \return the slot, to be given to \see recycle(), nullptr if the handle is null or stale
+     */
+    AlarmSlot* retire(AlarmHandle handle);
+
+    /**
+     * @brief Resets the state of a retired slot and adds it to the free list, the second step of its destruction
+     * \param slot : the slot returned by \see retire()
+     */
+    void recycle(AlarmSlot* slot);
+
+    /**
+     * @brief Getter of the slot of a handle, lock-free
+     * \param handle : the handle of the slot
+     * \return the slot, nullptr if the handle is null or stale
+     */
+    AlarmSlot* get(AlarmHandle handle) const;
+
+    /**
+     * @brief Getter of the slot of a handle, kept from being reset until \see unpin(), lock-free
+     * \param handle : the handle of the slot
+     * \return the slot, nullptr if the handle is null or stale
+     */
+    AlarmSlot* pin(AlarmHandle handle);
+
+    /**
+     * @brief Releases a slot returned by \see pin()
+     * \param slot : the pinned slot
+     */
+    void unpin(AlarmSlot* slot);
+
+    /**
+     * @brief Allocates slots in advance, so the next creations don't allocate
+     * \param count : the number of alarms that should fit in the pool
+     */
+    void reserve(std::size_t count);
+
+    /**
+     * @brief Number of alive alarm states
+     */
+    std::size_t size();
+
+    /**
+     * @brief Number of allocated slots
+     */
+    std::size_t capacity();
+
+    AlarmHistogram sequenceWait; /**< Wait for the sequence mutexes of the slots, in \see AlarmStopwatch ticks */
+    AlarmHistogram sequenceHold; /**< Hold of the sequence mutexes of the slots, in \see AlarmStopwatch ticks */
+
+private:
+    /**
+     * @brief Allocates a new chunk of slots and adds them to the free list, m_mtx must be locked
+     * \return false if the pool is full
+     */
+    bool grow();
+
+    std::atomic<AlarmSlot*> m_chunks[MAX_CHUNKS]; /**< Chunks of slots, published atomically for the lock-free \see get() */
+    std::size_t m_chunkCount = 0; /**< Number of allocated chunks */
+    std::uint32_t m_freeHead; /**< Index of the first free slot */
+    std::size_t m_size = 0; /**< Number of alive alarm states */
+    std::mutex m_mtx; /**< Protects the free list and chunk allocation */
+
+    AlarmPool& operator= (const AlarmPool&) = delete;
+    AlarmPool (const AlarmPool&) = delete;
+};
+
+/**
+ * @brief Scoped use of the slot of a handle by another thread than the one owning its \see Alarm, see \see AlarmPool::pin()
+ * The Alarm may be destroyed meanwhile: its destruction makes the handle stale, then waits for the pin instead of resetting the slot under its user
+ */
+class AlarmSlotPin {
+public:
+    /**
+     * @brief Pins the slot of a handle in the \see AlarmPool instance
+     * \param handle : the handle of the slot
+     */
+    explicit AlarmSlotPin(AlarmHandle handle);
+    ~AlarmSlotPin();
+
+    /**
+     * @brief Getter of the pinned slot
+     * \return the slot, nullptr if the handle is null or stale
+     */
+    AlarmSlot* get() const { return m_slot; }
+
+private:
+    AlarmSlot* m_slot; /**< Pinned slot, nullptr for none */
+
+    AlarmSlotPin& operator= (const AlarmSlotPin&) = delete;
+    AlarmSlotPin (const AlarmSlotPin&) = delete;
+};
+
+#endif //AlarmPool_h
@@ -0,0 +1,131 @@
+/**
+ *  @file   AlarmQueue.h
+ *  @brief  Define the AlarmLevel enum and the AlarmQueue priority index used by the AlarmPlayer
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmQueue_h
+#define AlarmQueue_h
+
+#include <cstddef>
+
+/**
+ * @brief Levels available to define an Alarm priority
+ * Order is important as int-conversion is used to define priority (with lower value = lower priority)
+ */
+enum class AlarmLevel { LOW=0, MEDIUM=1, HIGH=2 };
+
+/**
+ * @brief Intrusive links stored inside every queued item
+ * An item can be linked in a single \see AlarmQueue at a time
+ */
+template<typename T>
+struct AlarmQueueHook {
+    T* prev = nullptr; /**< Previous item of the same level, nullptr for the first one */
+    T* next = nullptr; /**< Next item of the same level, nullptr for the last one */
+    int level = -1; /**< Level bucket the item is linked in, -1 when not queued */
+};
+
+/**
+ * @brief Priority index of items, made of one intrusive FIFO list per level
+ * Insertion, removal and access to the highest priority item are O(1) and never allocate.
+ * Items of the same level are kept in insertion order (first in, first played).
+ * \tparam T : type of the queued items
+ * \tparam Hook : the \see AlarmQueueHook member of T used for linking
+ * \warning This class is not thread-safe, the owner must protect it
+ */
+template<typename T, AlarmQueueHook<T> T::*Hook>
+class AlarmQueue {
+public:
+    static const int LEVEL_COUNT = (int)AlarmLevel::HIGH + 1; /**< Number of levels of the \see AlarmLevel enum */
+
+    /**
+     * @brief Appends an item at the end of its level list
+     * \param item : the item to queue
+     * \param level : the priority level of the item, higher value = higher priority
+     * \warning if the item is already queued, this function has no effect
+     */
+    void push(T* item, int level){
+        AlarmQueueHook<T>& hook = item->*Hook;
+        if(hook.level >= 0) return;
+        Bucket& bucket = m_buckets[level];
+        hook.level = level;
+        hook.prev = bucket.tail;
+        hook.next = nullptr;
+        if(bucket.tail) (bucket.tail->*Hook).next = item;
+        else bucket.head = item;
+        bucket.tail = item;
+        m_size++;
+    }
+
+    /**
+     * @brief Unlinks an item from its level list
+     * \param item : the item to remove
+     * \warning if the item is not queued, this function has no effect
+     */
+    void remove(T* item){
+        AlarmQueueHook<T>& hook = item->*Hook;
+        if(hook.level < 0) return;
+        Bucket& bucket = m_buckets[hook.level];
+        if(hook.prev) (hook.prev->*Hook).next = hook.next;
+        else bucket.head = hook.next;
+        if(hook.next) (hook.next->*Hook).prev = hook.prev;
+        else bucket.tail = hook.prev;
+        hook.prev = hook.next = nullptr;
+        hook.level = -1;
+        m_size--;
+    }
+
+    /**
+     * @brief Getter of the highest priority item
+     * \return the oldest item of the highest non-empty level, nullptr if the queue is empty
+     */
+    T* top() const {
+        for(int level=LEVEL_COUNT-1; level>=0; level--)
+            if(m_buckets[level].head) return m_buckets[level].head;
+        return nullptr;
+    }
+
+    /**
+     * @brief Getter of the highest priority item of the levels below a level
+     * \param level : the level, items of this level and above are ignored
+     * \return the oldest item of the highest non-empty level below, nullptr if there is none
+     */
+    T* topBelow(int level) const {
+        for(level=level-1; level>=0; level--)
+            if(m_buckets[level].head) return m_buckets[level].head;
+        return nullptr;
+    }
+
+    /**
+     * @brief Getter of the level of a queued item
+     * \return the level bucket of the item, -1 if it is not queued
+     */
+    int level(const T* item) const { return (item->*Hook).level; }
+
+    /**
+     * @brief Wether an item is currently queued
+     */
+    bool contains(const T* item) const { return (item->*Hook).level >= 0; }
+
+    /**
+     * @brief Number of queued items
+     */
+    std::size_t size() const { return m_size; }
+
+    /**
+     * @brief Wether the queue has no item
+     */
+    bool empty() const { return m_size == 0; }
+
+private:
+    struct Bucket {
+        T* head = nullptr; /**< Oldest item of the level */
+        T* tail = nullptr; /**< Newest item of the level */
+    };
+    Bucket m_buckets[LEVEL_COUNT]; /**< One FIFO list per level */
+    std::size_t m_size = 0; /**< Number of queued items, all levels included */
+};
+
+#endif //AlarmQueue_h
@@ -0,0 +1,145 @@
+#include "AlarmRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const std::size_t AlarmRenderer::BLOCK_SIZE;
+
+AlarmRenderer::AlarmRenderer(const AlarmRenderSettings& settings) : m_settings(settings) {
+    if(!m_settings.sampleRate) m_settings.sampleRate = 1;
+    m_settings.amplitude = std::min(std::max(m_settings.amplitude, 0.f), 1.f); // Samples must not overflow
+}
+
+const AlarmRenderSettings& AlarmRenderer::getSettings() const {
+    return m_settings;
+}
+
+std::vector<AlarmRenderEdge> AlarmRenderer::timeline(const std::vector<AlarmRenderTrack>& tracks, std::chrono::milliseconds duration){
+    std::vector<AlarmRenderEdge> edges;
+    if(duration.count() <= 0) return edges;
+    unsigned long long end = duration.count();
+
+    // The played alarm can only change when an alarm starts or stops
+    std::vector<unsigned long long> changes = {0, end};
+    for(const AlarmRenderTrack& track : tracks){
+        if(track.start.count() > 0 && (unsigned long long)track.start.count() < end) changes.push_back(track.start.count());
+        if(track.stop.count() > 0 && (unsigned long long)track.stop.count() < end) changes.push_back(track.stop.count());
+    }
+    std::sort(changes.begin(), changes.end());
+    changes.erase(std::unique(changes.begin(), changes.end()), changes.end());
+
+    std::vector<unsigned long long> positions(tracks.size(), 0); // Playback position of paused alarms
+    int current = -1;
+    unsigned long long origin = 0; // Time at which the current alarm sequence started
+    bool noisy = false;
+    for(std::size_t change=0; change+1<changes.size(); change++){
+        unsigned long long from = changes[change], to = changes[change+1];
+        // Highest priority alarm is the oldest alarm of the highest level, as in the AlarmPlayer
+        int active = -1;
+        for(std::size_t i=0;i<tracks.size();i++){
+            const AlarmRenderTrack& track = tracks[i];
+            if(track.start.count() > (long long)from || track.stop.count() <= (long long)from) continue;
+            if(active < 0 || track.level > tracks[active].level
+               || (track.level == tracks[active].level && track.start < tracks[active].start)) active = i;
+        }
+        if(active != current){
+            // Preemption: pause the previous alarm where it was, resume the new one where it paused
+            if(current >= 0) positions[current] = from - origin;
+            if(active >= 0) origin = from - positions[active];
+            current = active;
+        }
+        const AlarmSequence* sequence = active >= 0 ? tracks[active].sequence.get() : nullptr;
+        if(!sequence || !sequence->duration()){
+            if(noisy) edges.push_back(AlarmRenderEdge{from, false});
+            noisy = false;
+            continue;
+        }
+        // Walk the tones of the sequence timeline until the next change
+        for(unsigned long long time = from; time < to;){
+            unsigned long long position = time - origin;
+            unsigned long long cycle = position / sequence->duration();
+            std::size_t index = sequence->indexAt(position);
+            if((*sequence)[index].beep != noisy) edges.push_back(AlarmRenderEdge{time, !noisy});
+            noisy = (*sequence)[index].beep;
+            time = origin + cycle * sequence->duration() + sequence->edge(index);
+        }
+    }
+    return edges;
+}
+
+std::vector<AlarmRenderEdge> AlarmRenderer::timeline(const std::vector<AlarmEdge>& edges){
+    std::vector<AlarmRenderEdge> timeline;
+    bool noisy = false;
+    for(const AlarmEdge& edge : edges){
+        if(edge.noisy == noisy) continue; // Only changes of the output state matter
+        std::chrono::milliseconds time = std::chrono::duration_cast<std::chrono::milliseconds>(edge.time - edges.front().time);
+        timeline.push_back(AlarmRenderEdge{(unsigned long long)time.count(), edge.noisy});
+        noisy = edge.noisy;
+    }
+    return timeline;
+}
+
+std::size_t AlarmRenderer::render(const std::vector<AlarmRenderEdge>& edges, std::chrono::milliseconds duration, AlarmPcmSink& sink){
+    if(duration.count() <= 0) return 0;
+    std::size_t total = (unsigned long long)duration.count() * m_settings.sampleRate / 1000;
+    std::int16_t block[BLOCK_SIZE];
+    std::size_t frame = 0, next = 0;
+    bool gate = false;
+    while(frame < total){
+        // Blocks are split at edges, so the gate is constant within a block
+        while(next < edges.size() && edges[next].time * m_settings.sampleRate / 1000 <= frame) gate = edges[next++].noisy;
+        std::size_t end = next < edges.size() ? std::min<std::size_t>(total, edges[next].time * m_settings.sampleRate / 1000) : total;
+        std::size_t count = std::min(BLOCK_SIZE, end - frame);
+        this->synthesize(block, count, gate);
+        sink.write(block, count);
+        frame += count;
+    }
+    return total;
+}
+
+void AlarmRenderer::synthesize(std::int16_t* output, std::size_t count, bool gate){
+    const float increment = m_settings.frequency / m_settings.sampleRate; // Oscillator cycles per frame
+    const float phase = float(m_phase);
+    m_phase = std::fmod(m_phase + double(increment) * count, 1.0);
+
+    if(!gate && m_envelope <= 0){
+        std::memset(output, 0, count * sizeof(std::int16_t)); // Silence, the oscillator still runs
+        return;
+    }
+
+    // Envelope: linear ramp towards the gate, then constant once the gate level is reached
+    const int frames = int(count); // Signed 32-bit indexes convert to float in vector registers
+    float rampFrames = (gate ? m_settings.attack : m_settings.release) * m_settings.sampleRate / 1000;
+    float step = rampFrames >= 1 ? 1 / rampFrames : 1;
+    float target = gate ? 1.f : 0.f;
+    if(!gate) step = -step;
+    const float envelope = m_envelope;
+    int ramp = int(std::min(float(frames), std::ceil((target - envelope) / step))); // Frames until the gate level is reached
+    for(int i=0;i<ramp;i++) m_gain[i] = envelope + (i+1) * step;
+    for(int i=std::max(ramp, 0);i<frames;i++) m_gain[i] = target;
+    if(ramp > 0) m_gain[ramp-1] = std::min(std::max(m_gain[ramp-1], 0.f), 1.f); // Last ramp frame may overshoot
+    m_envelope = m_gain[count-1];
+
+    // Oscillator, from the fractional phase of every frame
+    if(m_settings.waveform == AlarmWaveform::SQUARE){
+        for(int i=0;i<frames;i++){
+            float cycle = phase + i * increment;
+            cycle -= float(int(cycle));
+            m_oscillator[i] = 1.f - 2.f * float(int(2 * cycle)); // 1 on the first half of the cycle, -1 on the second
+        }
+    }
+    else {
+        for(int i=0;i<frames;i++){
+            float cycle = phase + i * increment;
+            cycle -= float(int(cycle));
+            // sin(2*pi*cycle) = -sin(2*pi*t) with t in [-0.5,0.5), from a refined parabola (error below 0.1%)
+            float t = cycle - 0.5f;
+            float y = 8 * t - 16 * t * std::fabs(t);
+            y = 0.225f * (y * std::fabs(y) - y) + y;
+            m_oscillator[i] = -y;
+        }
+    }
+
+    const float scale = m_settings.amplitude * 32767;
+    for(int i=0;i<frames;i++) output[i] = std::int16_t(m_oscillator[i] * m_gain[i] * scale);
+}
@@ -0,0 +1,118 @@
+/**
+ *  @file   AlarmRenderer.h
+ *  @brief  Define the AlarmRenderer turning alarm timelines into PCM audio
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmRenderer_h
+#define AlarmRenderer_h
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+#include "AlarmSequence.h"
+#include "AlarmQueue.h"
+#include "AlarmSink.h"
+#include "AlarmPcmSink.h"
+
+/**
+ * @brief Waveform of the rendered beeps
+ */
+enum class AlarmWaveform { SQUARE, SINE };
+
+/**
+ * @brief Audio settings of the \see AlarmRenderer
+ */
+struct AlarmRenderSettings {
+    unsigned int sampleRate = 44100; /**< Sample rate in Hz */
+    float frequency = 880; /**< Frequency of the beeps in Hz */
+    AlarmWaveform waveform = AlarmWaveform::SQUARE; /**< Waveform of the beeps */
+    float amplitude = 0.5f; /**< Peak amplitude of the beeps, from 0 to 1 */
+    float attack = 5; /**< Duration of the fade-in at the start of a beep in milliseconds, avoids clicks */
+    float release = 5; /**< Duration of the fade-out at the end of a beep in milliseconds, avoids clicks */
+};
+
+/**
+ * @brief Alarm of an offline score, played from a start time until a stop time
+ */
+struct AlarmRenderTrack {
+    AlarmSequence::Ptr sequence; /**< Tones of the alarm */
+    AlarmLevel level = AlarmLevel::LOW; /**< Priority level of the alarm */
+    std::chrono::milliseconds start = std::chrono::milliseconds(0); /**< Time at which the alarm is started */
+    std::chrono::milliseconds stop = std::chrono::milliseconds::max(); /**< Time at which the alarm is stopped */
+};
+
+/**
+ * @brief Change of the output state in an offline timeline
+ */
+struct AlarmRenderEdge {
+    unsigned long long time; /**< Time of the change in milliseconds */
+    bool noisy; /**< true from this time on for a beep, false for a silence */
+};
+
+/**
+ * @brief Offline renderer of alarm timelines to mono 16-bit PCM
+ * Samples are synthesized by blocks of \see BLOCK_SIZE frames with branch-free loops the compiler vectorizes,
+ * and streamed to an \see AlarmPcmSink, so rendering hours of audio only needs a block of memory.
+ * The oscillator runs continuously and beeps are shaped by linear attack and release ramps.
+ */
+class AlarmRenderer {
+public:
+    static const std::size_t BLOCK_SIZE = 512; /**< Number of frames synthesized at once */
+
+    /**
+     * @brief Constructor of an AlarmRenderer
+     * \param settings : the audio settings
+     */
+    AlarmRenderer(const AlarmRenderSettings& settings = AlarmRenderSettings());
+
+    /**
+     * @brief Resolves a score into the timeline of the output, with the priority rules of the \see AlarmPlayer
+     * The highest level alarm is played, the oldest one first within a level. A preempted alarm resumes where it paused.
+     * \param tracks : the alarms of the score, in attachment order for alarms started at the same time
+     * \param duration : the duration of the timeline
+     * \return the changes of the output state, starting silent at 0
+     */
+    static std::vector<AlarmRenderEdge> timeline(const std::vector<AlarmRenderTrack>& tracks, std::chrono::milliseconds duration);
+
+    /**
+     * @brief Converts edges recorded from an \see AlarmPlayer (e.g. by an \see AlarmRecorderSink) into a timeline
+     * \param edges : the recorded edges, the first one being the time origin
+     * \return the changes of the output state
+     */
+    static std::vector<AlarmRenderEdge> timeline(const std::vector<AlarmEdge>& edges);
+
+    /**
+     * @brief Renders a timeline
+     * \param edges : the changes of the output state, sorted by time
+     * \param duration : the duration to render
+     * \param sink : the output of the samples
+     * \return the number of rendered samples
+     */
+    std::size_t render(const std::vector<AlarmRenderEdge>& edges, std::chrono::milliseconds duration, AlarmPcmSink& sink);
+
+    /**
+     * @brief Getter of the audio settings
+     */
+    const AlarmRenderSettings& getSettings() const;
+
+private:
+    /**
+     * @brief Synthesizes a block of frames with a constant gate, starting from the current oscillator and envelope state
+     * \param output : receives the samples
+     * \param count : number of frames, at most \see BLOCK_SIZE
+     * \param gate : true while beeping, the envelope ramps towards it
+     */
+    void synthesize(std::int16_t* output, std::size_t count, bool gate);
+
+    AlarmRenderSettings m_settings; /**< Audio settings */
+    double m_phase = 0; /**< Oscillator phase, in cycles from 0 to 1 */
+    float m_envelope = 0; /**< Envelope level, from 0 (silent) to 1 (beeping) */
+    float m_oscillator[BLOCK_SIZE]; /**< Oscillator block */
+    float m_gain[BLOCK_SIZE]; /**< Envelope block */
+};
+
+#endif //AlarmRenderer_h
@@ -0,0 +1,89 @@
+/**
+ *  @file   AlarmRing.h
+ *  @brief  Define the AlarmRing lock-free single-producer single-consumer queue
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmRing_h
+#define AlarmRing_h
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue between exactly one producer thread and one consumer thread
+ * Storage is allocated once at construction, \see push() and \see pop() never allocate nor block.
+ * \tparam T : type of the queued items, copied in and out of the ring
+ * \warning Calls to \see push() must not be concurrent, nor calls to \see pop()
+ */
+template<typename T>
+class AlarmRing {
+public:
+    /**
+     * @brief Constructor of an AlarmRing
+     * \param capacity : minimum number of items the ring holds, rounded up to a power of two
+     */
+    explicit AlarmRing(std::size_t capacity) {
+        std::size_t size = 2;
+        while(size < capacity) size *= 2;
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+
+    /**
+     * @brief Appends an item, producer side
+     * \param item : the item to append
+     * \return false if the ring is full, the item is not appended
+     */
+    bool push(const T& item){
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        if(head - m_cachedTail > m_mask){
+            m_cachedTail = m_tail.load(std::memory_order_acquire); // Only read the consumer index when the ring looks full
+            if(head - m_cachedTail > m_mask) return false;
+        }
+        m_items[head & m_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, consumer side
+     * \param item : receives the removed item
+     * \return false if the ring is empty
+     */
+    bool pop(T& item){
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail == m_cachedHead){
+            m_cachedHead = m_head.load(std::memory_order_acquire); // Only read the producer index when the ring looks empty
+            if(tail == m_cachedHead) return false;
+        }
+        item = m_items[tail & m_mask];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Wether the ring has no item, from any thread
+     */
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Number of items the ring holds
+     */
+    std::size_t capacity() const { return m_mask + 1; }
+
+private:
+    std::vector<T> m_items; /**< Storage of the items */
+    std::size_t m_mask = 0; /**< Capacity minus one, indexes wrap with it */
+    char m_padding0[64]; /**< Keeps the producer and consumer indexes on separate cache lines */
+    std::atomic<std::size_t> m_head{0}; /**< Index of the next pushed item, written by the producer */
+    std::size_t m_cachedTail = 0; /**< Producer copy of \see m_tail */
+    char m_padding1[64];
+    std::atomic<std::size_t> m_tail{0}; /**< Index of the next popped item, written by the consumer */
+    std::size_t m_cachedHead = 0; /**< Consumer copy of \see m_head */
+    char m_padding2[64];
+};
+
+#endif //AlarmRing_h
@@ -0,0 +1,285 @@
+#include "AlarmScheduler.h"
+#include <algorithm>
+#include <cerrno>
+#include <alloca.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+
+AlarmScheduler& AlarmScheduler::Instance() {
+    static AlarmScheduler instance; // Function-local so binaries that never raise an alarm don't pay for it
+    return instance;
+}
+
+AlarmScheduler::AlarmScheduler(std::size_t sinkCapacity) : AlarmScheduler(AlarmSteadyClock::Instance(), sinkCapacity) {
+
+}
+
+AlarmScheduler::AlarmScheduler(AlarmClock& clock, std::size_t sinkCapacity)
+ : m_clock(clock), m_driven(false), m_steady(dynamic_cast<AlarmSteadyClock*>(&clock) != nullptr), m_epoch(clock.now()), m_sinkRing(sinkCapacity), m_sinkPolicy(AlarmSinkPolicy::COALESCE),
+   m_sinkQueued(0), m_sinkDelivered(0), m_sinkDropped(0), m_sinkCoalesced(0), m_sinkSleeping(false) {
+    m_driven = m_clock.attach(this);
+}
+
+AlarmScheduler::~AlarmScheduler() {
+    m_clock.detach(this);
+    m_mtx.lock();
+    m_alive = false; // Contact the scheduler thread for termination
+    m_mtx.unlock();
+    m_wakeup.notify_all();
+    if(m_thread.joinable()) m_thread.join(); // Wait for the scheduler thread, if it has been started
+    m_sinkMtx.lock();
+    m_sinkAlive = false; // The sink thread writes the remaining edges, then terminates
+    m_sinkMtx.unlock();
+    m_sinkWakeup.notify_all();
+    if(m_sinkThread.joinable()) m_sinkThread.join();
+}
+
+void AlarmScheduler::schedule(AlarmPlayer* player, std::chrono::steady_clock::time_point deadline){
+    std::uint64_t tick = this->toTick(deadline);
+    std::lock_guard<std::mutex> lock(m_mtx);
+    this->insert(player, tick);
+}
+
+void AlarmScheduler::schedule(AlarmPlayer* player){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    this->insert(player, 0); // Past ticks expire at the current tick of the wheel
+}
+
+void AlarmScheduler::insert(AlarmPlayer* player, std::uint64_t tick){
+    if(!m_alive) return;
+    if(m_wheel.contains(player) && m_wheel.tick(player) <= tick) return; // Keep the earliest deadline
+    m_wheel.insert(player, tick);
+    if(m_driven) return; // The clock looks at the wheel when advanced
+    // Lazy startup, the thread waits for the lock before looking at the wheel
+    if(!m_thread.joinable()) this->startThreads();
+    else if(m_wheel.tick(player) < m_sleepTick) m_wakeup.notify_one(); // Only wake the thread for an earlier deadline
+}
+
+void AlarmScheduler::startThreads(){
+    m_sinkThread = std::thread(&AlarmScheduler::runSink, this);
+    m_thread = std::thread(&AlarmScheduler::run, this);
+}
+
+void AlarmScheduler::cancel(AlarmPlayer* player){
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while(m_running == player) m_updated.wait(lock); // The thread may reschedule the player once updated
+    m_wheel.remove(player);
+}
+
+bool AlarmScheduler::isRunning(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_thread.joinable();
+}
+
+std::chrono::steady_clock::time_point AlarmScheduler::now(){
+    return m_clock.now();
+}
+
+AlarmClock& AlarmScheduler::getClock(){
+    return m_clock;
+}
+
+std::size_t AlarmScheduler::size(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_wheel.size();
+}
+
+std::uint64_t AlarmScheduler::toTick(std::chrono::steady_clock::time_point time){
+    if(time <= m_epoch) return 0;
+    std::chrono::steady_clock::duration elapsed = time - m_epoch;
+    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    if(ms < elapsed) ms += std::chrono::milliseconds(1);
+    return ms.count();
+}
+
+void AlarmScheduler::process(std::unique_lock<std::mutex>& lock, std::uint64_t tick){
+    // Update expired players one at a time, outside of the lock so players can schedule themselves meanwhile
+    while(AlarmPlayer* player = m_wheel.pop(tick)){
+        m_running = player;
+        lock.unlock();
+        std::chrono::steady_clock::time_point deadline = player->update(m_clock.now());
+        lock.lock();
+        if(deadline != std::chrono::steady_clock::time_point::max()) this->insert(player, this->toTick(deadline));
+        m_running = nullptr;
+        m_updated.notify_all();
+    }
+}
+
+bool AlarmScheduler::nextDeadline(std::chrono::steady_clock::time_point& deadline){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::uint64_t next = m_wheel.nextTick();
+    if(next == m_wheel.NONE) return false;
+    deadline = m_epoch + std::chrono::milliseconds(next);
+    return true;
+}
+
+void AlarmScheduler::advance(std::chrono::steady_clock::time_point now){
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if(now < m_epoch || !m_alive) return;
+    this->process(lock, std::chrono::duration_cast<std::chrono::milliseconds>(now - m_epoch).count());
+}
+
+void AlarmScheduler::run() {
+    this->prepareThread();
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while(m_alive){
+        m_sleepTick = AWAKE;
+        std::chrono::steady_clock::time_point now = m_clock.now();
+        std::uint64_t tick = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_epoch).count();
+        this->process(lock, tick);
+
+        //Sleep until next deadline or earlier schedule. Idle scheduler sleeps without timeout.
+        std::uint64_t next = m_wheel.nextTick();
+        if(!m_alive) break;
+        if(next == m_wheel.NONE){
+            m_sleepTick = IDLE;
+            m_wakeup.wait(lock);
+        }
+        else if(next > tick){
+            m_sleepTick = next;
+            // Absolute wait on the monotonic clock, so the wakeup doesn't drift by the time spent computing it.
+            // Other clocks are converted to the steady clock, whatever their time base.
+            std::chrono::steady_clock::time_point deadline = m_epoch + std::chrono::milliseconds(next);
+            std::chrono::steady_clock::time_point wakeup = deadline;
+            if(!m_steady) wakeup = std::chrono::steady_clock::now() + (deadline - m_clock.now());
+            if(m_wakeup.wait_until(lock, wakeup) == std::cv_status::timeout){
+                std::chrono::steady_clock::duration lateness = std::max(m_clock.now() - deadline, std::chrono::steady_clock::duration::zero());
+                m_wakeupLateness.recordSerialized(std::chrono::duration_cast<std::chrono::nanoseconds>(lateness).count());
+            }
+        }
+    }
+}
+
+void AlarmScheduler::setSinkPolicy(AlarmSinkPolicy policy){
+    m_sinkPolicy = policy;
+}
+
+AlarmSinkPolicy AlarmScheduler::getSinkPolicy(){
+    return m_sinkPolicy;
+}
+
+AlarmSinkStats AlarmScheduler::getSinkStats(){
+    AlarmSinkStats stats;
+    stats.queued = m_sinkQueued;
+    stats.delivered = m_sinkDelivered;
+    stats.dropped = m_sinkDropped;
+    stats.coalesced = m_sinkCoalesced;
+    return stats;
+}
+
+void AlarmScheduler::drain(){
+    unsigned long long queued = m_sinkQueued;
+    std::unique_lock<std::mutex> lock(m_sinkMtx);
+    while(m_sinkDelivered < queued && m_sinkThread.joinable()) m_sinkDrained.wait(lock);
+}
+
+bool AlarmScheduler::post(AlarmSink& sink, const AlarmEdge& edge){
+    if(m_driven){
+        // No sink thread: the edge is written before the clock advance returns, in edge order
+        sink.write(edge);
+        m_sinkQueued++;
+        m_sinkDelivered++;
+        return true;
+    }
+    SinkEvent event;
+    event.sink = &sink;
+    event.edge = edge;
+    if(!m_sinkRing.push(event)){
+        if(m_sinkPolicy == AlarmSinkPolicy::COALESCE) return false;
+        m_sinkDropped++;
+        return true;
+    }
+    m_sinkQueued++;
+    // Pairs with the fence of the sink thread: either it sees the new edge, or this thread sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(m_sinkSleeping.load(std::memory_order_relaxed)){
+        std::lock_guard<std::mutex> lock(m_sinkMtx);
+        m_sinkWakeup.notify_one();
+    }
+    return true;
+}
+
+void AlarmScheduler::runSink() {
+    this->prepareThread();
+    SinkEvent event;
+    std::unique_lock<std::mutex> lock(m_sinkMtx);
+    while(true){
+        // Write the queued edges outside of the lock, the producer never waits for a sink
+        lock.unlock();
+        while(m_sinkRing.pop(event)){
+            event.sink->write(event.edge);
+            m_sinkDelivered++;
+        }
+        lock.lock();
+        m_sinkDrained.notify_all();
+        if(!m_sinkAlive && m_sinkRing.empty()) break;
+
+        //Sleep until edges are queued
+        m_sinkSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while(m_sinkAlive && m_sinkRing.empty()) m_sinkWakeup.wait(lock);
+        m_sinkSleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+AlarmRealtimeStatus AlarmScheduler::setRealtime(const AlarmRealtimeSettings& settings){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_realtimeRequested = true;
+    m_realtime = settings;
+    AlarmRealtimeStatus status;
+    status.locked = true;
+    if(settings.lockMemory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+        status.locked = false;
+        status.error = errno;
+    }
+    if(!m_driven && m_alive){
+        if(!m_thread.joinable()) this->startThreads(); // Idle threads wait without timeout, they only prepare themselves
+        status.scheduled = status.pinned = true;
+        this->applyRealtime(m_thread, settings.priority, status);
+        // Edges are written right after being played, but never before the next deadline
+        this->applyRealtime(m_sinkThread, std::max(settings.priority - 1, sched_get_priority_min(settings.policy)), status);
+    }
+    m_realtimeStatus = status;
+    return status;
+}
+
+AlarmRealtimeStatus AlarmScheduler::getRealtimeStatus(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_realtimeStatus;
+}
+
+void AlarmScheduler::applyRealtime(std::thread& thread, int priority, AlarmRealtimeStatus& status){
+    sched_param param;
+    param.sched_priority = m_realtime.policy == SCHED_FIFO || m_realtime.policy == SCHED_RR ? priority : 0;
+    int error = pthread_setschedparam(thread.native_handle(), m_realtime.policy, &param);
+    if(error){
+        status.scheduled = false;
+        if(!status.error) status.error = error;
+    }
+    if(m_realtime.cpus.empty()) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for(int cpu : m_realtime.cpus) if(cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpus);
+    error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+    if(error){
+        status.pinned = false;
+        if(!status.error) status.error = error;
+    }
+}
+
+void AlarmScheduler::prepareThread(){
+    std::size_t stack = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if(!m_realtimeRequested) return;
+        stack = m_realtime.prefaultStack;
+    }
+    ::prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0); // Real-time policies have no slack, this only helps the fallback
+    volatile char* pages = static_cast<volatile char*>(alloca(stack));
+    for(std::size_t i=0;i<stack;i+=4096) pages[i] = 0; // Touching a byte per page maps it, the pages stay mapped on return
+}
+
+AlarmHistogramSnapshot AlarmScheduler::getWakeupLateness(){
+    return m_wakeupLateness.snapshot();
+}
@@ -0,0 +1,293 @@
+/**
+ *  @file   AlarmScheduler.h
+ *  @brief  Define the AlarmScheduler driving the playback of AlarmPlayers
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmScheduler_h
+#define AlarmScheduler_h
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <sched.h>
+
+#include "AlarmClock.h"
+#include "AlarmMetrics.h"
+#include "AlarmTimingWheel.h"
+#include "AlarmRing.h"
+#include "AlarmSink.h"
+#include "AlarmPlayer.h"
+
+/**
+ * @brief Real-time scheduling of the threads of an \see AlarmScheduler, \see AlarmScheduler::setRealtime()
+ */
+struct AlarmRealtimeSettings {
+    int policy = SCHED_FIFO; /**< Scheduling policy, SCHED_FIFO or SCHED_RR, SCHED_OTHER returns to the default time sharing */
+    int priority = 80; /**< Priority of the scheduler thread for real-time policies, the sink thread runs one below */
+    std::vector<int> cpus; /**< CPUs the threads are pinned to, empty to let them run on any CPU */
+    bool lockMemory = true; /**< Wether every page of the process, current and future, is locked in memory with mlockall() */
+    std::size_t prefaultStack = 64 * 1024; /**< Bytes of stack each thread touches when started, so deadlines never page fault on it */
+};
+
+/**
+ * @brief What the system granted of the \see AlarmRealtimeSettings, each request failing independently
+ */
+struct AlarmRealtimeStatus {
+    bool scheduled = false; /**< Wether both threads run with the requested policy and priority */
+    bool pinned = false; /**< Wether both threads are pinned to the requested CPUs, or no CPU was requested */
+    bool locked = false; /**< Wether the memory of the process is locked, or locking was not requested */
+    int error = 0; /**< errno of the first refused request, typically EPERM without CAP_SYS_NICE or CAP_IPC_LOCK, 0 if all were granted */
+};
+
+/**
+ * @brief Single thread playing the tone edges of many \see AlarmPlayer
+ * The next tone-edge deadline of every active player is kept in an \see AlarmTimingWheel with a millisecond tick.
+ * The thread sleeps until the earliest deadline, updates the expired players and schedules their next deadline,
+ * so hundreds of players (one per zone or output) cost a single thread. The thread is started on the first schedule.
+ * Tone edges are pushed to a lock-free ring drained by a second thread writing to the \see AlarmSink of each player,
+ * so a slow output never delays the playback nor priority switching.
+ * Time is read from an \see AlarmClock: with an \see AlarmManualClock no thread is started,
+ * the clock updates the players itself when advanced and edges are written to their sink synchronously.
+ */
+class AlarmScheduler {
+friend AlarmPlayer;
+friend AlarmManualClock;
+public:
+    static const std::size_t DEFAULT_SINK_CAPACITY = 4096; /**< Default number of edges the ring holds */
+
+    /**
+     * @brief Getter of the scheduler used by default by every \see AlarmPlayer
+     * \return the default instance of the AlarmScheduler, created on first use
+     */
+    static AlarmScheduler& Instance();
+
+    /**
+     * @brief Constructor of an AlarmScheduler
+     * No thread is started until a player is scheduled
+     * \param sinkCapacity : number of edges waiting for their sink before the \see AlarmSinkPolicy applies
+     */
+    explicit AlarmScheduler(std::size_t sinkCapacity = DEFAULT_SINK_CAPACITY);
+
+    /**
+     * @brief Constructor of an AlarmScheduler reading a chosen clock
+     * \param clock : the time source of the scheduler and its players, must outlive the AlarmScheduler
+     * \param sinkCapacity : number of edges waiting for their sink before the \see AlarmSinkPolicy applies
+     */
+    explicit AlarmScheduler(AlarmClock& clock, std::size_t sinkCapacity = DEFAULT_SINK_CAPACITY);
+
+    /**
+     * @brief Destructor of the AlarmScheduler, stops the threads once the queued edges are written
+     * \warning Players using this scheduler must be destroyed first
+     */
+    ~AlarmScheduler();
+
+    /**
+     * @brief Requests a player update at a deadline
+     * If the player is already scheduled earlier, the earlier deadline is kept
+     * \param player : the player to update
+     * \param deadline : the time at which the player must be updated, rounded up to the next millisecond
+     */
+    void schedule(AlarmPlayer* player, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Requests a player update as soon as possible
+     * \param player : the player to update
+     */
+    void schedule(AlarmPlayer* player);
+
+    /**
+     * @brief Cancels the updates of a player
+     * Once returned, the player is neither scheduled nor being updated by the thread
+     * \param player : the player to cancel
+     */
+    void cancel(AlarmPlayer* player);
+
+    /**
+     * @brief Wether the scheduler thread has been started, which happens on the first schedule
+     * \return true if the scheduler thread is running, false otherwise, always false when driven by an \see AlarmManualClock
+     */
+    bool isRunning();
+
+    /**
+     * @brief Getter of the current time of the scheduler clock
+     */
+    std::chrono::steady_clock::time_point now();
+
+    /**
+     * @brief Getter of the clock of the scheduler
+     */
+    AlarmClock& getClock();
+
+    /**
+     * @brief Number of scheduled players
+     */
+    std::size_t size();
+
+    /**
+     * @brief Setter of the policy applied when the edge ring is full
+     * \param policy : the new \see AlarmSinkPolicy, COALESCE by default
+     */
+    void setSinkPolicy(AlarmSinkPolicy policy);
+
+    /**
+     * @brief Getter of the policy applied when the edge ring is full
+     */
+    AlarmSinkPolicy getSinkPolicy();
+
+    /**
+     * @brief Getter of the edge counters
+     * \return a copy of the counters, each one read atomically
+     */
+    AlarmSinkStats getSinkStats();
+
+    /**
+     * @brief Waits until every edge queued so far has been written to its sink
+     */
+    void drain();
+
+    /**
+     * @brief Runs the threads of the scheduler in real time, for alarms that must sound on time on a loaded host
+     * The threads are started if needed, then rescheduled with the policy and priority and pinned to the CPUs,
+     * and the memory of the process is locked. A request the system refuses (e.g. without privileges) is reported
+     * and the threads keep running as before: the playback never depends on it.
+     * The threads of a scheduler driven by an \see AlarmManualClock are never started, only the memory is locked.
+     * \param settings : the requested scheduling
+     * \return what was granted
+     * Threads started by this call also prefault their stack and minimize their timer slack, see \see AlarmRealtimeSettings.
+     * \warning Locking memory applies to the whole process and lasts after the scheduler is destroyed
+     */
+    AlarmRealtimeStatus setRealtime(const AlarmRealtimeSettings& settings = AlarmRealtimeSettings());
+
+    /**
+     * @brief Getter of what was granted by the last \see setRealtime(), a default status if it was never called
+     */
+    AlarmRealtimeStatus getRealtimeStatus();
+
+    /**
+     * @brief Getter of the delay of the wakeups of the scheduler thread after their deadline, in nanoseconds
+     * Only wakeups at a deadline are recorded, not the ones for an earlier schedule
+     */
+    AlarmHistogramSnapshot getWakeupLateness();
+
+private:
+    /**
+     * @brief Scheduler thread
+     * The thread sleeps until the earliest deadline, or until woken by an earlier \see schedule(). It doesn't wake up at all while idle.
+     */
+    void run();
+
+    /**
+     * @brief Starts the scheduler and sink threads, m_mtx must be locked
+     */
+    void startThreads();
+
+    /**
+     * @brief Prepares the calling thread for real time if \see setRealtime() was called, called first by each thread
+     * Touches its stack and minimizes its timer slack, the delay the system may add to its wakeups under time sharing
+     */
+    void prepareThread();
+
+    /**
+     * @brief Applies the scheduling of \see m_realtime to a thread, m_mtx must be locked
+     * \param thread : the thread
+     * \param priority : the priority of the thread for a real-time policy
+     * \param status : receives what was granted, requests already refused stay refused
+     */
+    void applyRealtime(std::thread& thread, int priority, AlarmRealtimeStatus& status);
+
+    /**
+     * @brief Updates the players expired at a tick, one at a time and outside of the lock
+     * \param lock : the lock of \see m_mtx, held on entry and on return
+     * \param tick : the current tick
+     */
+    void process(std::unique_lock<std::mutex>& lock, std::uint64_t tick);
+
+    /**
+     * @brief Getter of the earliest deadline, for the \see AlarmManualClock
+     * \param deadline : receives the deadline, which may be in the past for updates requested as soon as possible
+     * \return false if no player is scheduled
+     */
+    bool nextDeadline(std::chrono::steady_clock::time_point& deadline);
+
+    /**
+     * @brief Updates the players expired at a time, called by the \see AlarmManualClock driving the scheduler
+     * \param now : the current time of the clock
+     */
+    void advance(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Converts a time point to a wheel tick, rounded up so a player is never updated before its deadline
+     */
+    std::uint64_t toTick(std::chrono::steady_clock::time_point time);
+
+    /**
+     * @brief Schedules a player at a tick, m_mtx must be locked
+     */
+    void insert(AlarmPlayer* player, std::uint64_t tick);
+
+    /**
+     * @brief Queues an edge for a sink, called by players from the scheduler thread only (single producer)
+     * \param sink : the sink to write the edge to
+     * \param edge : the edge to write
+     * \return false if the ring is full and the policy is COALESCE, the caller keeps the edge to queue it later
+     */
+    bool post(AlarmSink& sink, const AlarmEdge& edge);
+
+    /**
+     * @brief Sink thread, writes the queued edges to their sink
+     * The thread sleeps while the ring is empty
+     */
+    void runSink();
+
+    /**
+     * @brief Edge waiting in the ring for its sink
+     */
+    struct SinkEvent {
+        AlarmSink* sink = nullptr; /**< Sink to write the edge to */
+        AlarmEdge edge; /**< Edge to write */
+    };
+
+    static const std::uint64_t AWAKE = 0; /**< \see m_sleepTick value while the thread is updating players */
+    static const std::uint64_t IDLE = ~0ull; /**< \see m_sleepTick value while the thread waits without timeout */
+
+    AlarmClock& m_clock; /**< Time source of the scheduler */
+    bool m_driven; /**< Wether \see m_clock updates the players itself, no thread is started then */
+    bool m_steady; /**< Wether \see m_clock is an \see AlarmSteadyClock, whose deadlines are waited for as they are */
+    AlarmTimingWheel<AlarmPlayer, &AlarmPlayer::m_timer> m_wheel; /**< Next update deadline of every scheduled player */
+    std::chrono::steady_clock::time_point m_epoch; /**< Time of tick 0 */
+    bool m_alive = true; /**< Used during destruction to stop the thread */
+    std::uint64_t m_sleepTick = AWAKE; /**< Tick the thread sleeps until, used to only wake it for earlier deadlines */
+    AlarmPlayer* m_running = nullptr; /**< Player currently being updated by the thread, outside of the lock */
+    std::thread m_thread; /**< Stores the scheduler thread instance, started by the first \see schedule() */
+    std::condition_variable m_wakeup; /**< Wakes the thread early on earlier deadlines */
+    std::condition_variable m_updated; /**< Notified when the thread is done updating a player, for \see cancel() */
+    std::mutex m_mtx; /**< Protects the wheel and the thread state */
+    bool m_realtimeRequested = false; /**< Wether \see setRealtime() has been called */
+    AlarmRealtimeSettings m_realtime; /**< Settings of the last \see setRealtime() */
+    AlarmRealtimeStatus m_realtimeStatus; /**< Status of the last \see setRealtime() */
+    AlarmHistogram m_wakeupLateness; /**< \see getWakeupLateness(), written by the scheduler thread under m_mtx */
+
+    AlarmRing<SinkEvent> m_sinkRing; /**< Edges pushed by the scheduler thread, popped by the sink thread */
+    std::atomic<AlarmSinkPolicy> m_sinkPolicy; /**< Policy applied when \see m_sinkRing is full */
+    std::atomic<unsigned long long> m_sinkQueued; /**< \see AlarmSinkStats::queued */
+    std::atomic<unsigned long long> m_sinkDelivered; /**< \see AlarmSinkStats::delivered */
+    std::atomic<unsigned long long> m_sinkDropped; /**< \see AlarmSinkStats::dropped */
+    std::atomic<unsigned long long> m_sinkCoalesced; /**< \see AlarmSinkStats::coalesced, counted by the players */
+    std::atomic<bool> m_sinkSleeping; /**< Set while the sink thread waits, so the producer only locks to wake it */
+    bool m_sinkAlive = true; /**< Used during destruction to stop the sink thread */
+    std::thread m_sinkThread; /**< Stores the sink thread instance, started with the scheduler thread */
+    std::condition_variable m_sinkWakeup; /**< Wakes the sink thread when edges are queued */
+    std::condition_variable m_sinkDrained; /**< Notified when the sink thread has written the queued edges, for \see drain() */
+    std::mutex m_sinkMtx; /**< Protects the sink thread state */
+
+    AlarmScheduler& operator= (const AlarmScheduler&) = delete;
+    AlarmScheduler (const AlarmScheduler&) = delete;
+};
+
+#endif //AlarmScheduler_h
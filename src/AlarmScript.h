@@ -0,0 +1,112 @@
+/**
+ *  @file   AlarmScript.h
+ *  @brief  Define the AlarmScript, an AlarmToneSource written as a C++20 coroutine
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmScript_h
+#define AlarmScript_h
+
+#if !defined(__cpp_impl_coroutine)
+#error "AlarmScript.h requires C++20 coroutines, the rest of the library only requires C++11"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "AlarmToneSource.h"
+
+/**
+ * @brief Tone source written as a coroutine yielding its tones, resumed by the \see AlarmPlayer each time a tone ends
+ * A script is a function returning an AlarmScript, e.g. a siren beeping 3 times and then stopping its alarm:
+ *
+ *     AlarmScript siren(){
+ *         for(int i=0;i<3;i++){
+ *             co_yield AlarmTone(250, true);
+ *             co_yield AlarmTone(750, false);
+ *         }
+ *     }
+ *     alarm.setSource(std::make_shared<AlarmScript>(siren()));
+ *
+ * Its state lives in the coroutine frame, allocated once when the script is called: there is no thread per script,
+ * scripts run on the scheduler thread of their player. A script may `co_await AlarmScript::played()` to read the time
+ * it has played so far, its only awaitable: it must not wait for anything else, see \see AlarmToneSource::next().
+ * Exceptions escaping a script terminate the program.
+ */
+class AlarmScript : public AlarmToneSource {
+public:
+    /**
+     * @brief Awaitable of the time played by the script, \see played()
+     */
+    struct Played {};
+
+    /**
+     * @brief Coroutine state of a script
+     */
+    struct promise_type {
+        AlarmTone tone; /**< Last yielded tone */
+        std::chrono::milliseconds played = std::chrono::milliseconds(0); /**< Time played before the requested tone */
+
+        AlarmScript get_return_object(){ return AlarmScript(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; } // Runs on the first pull only
+        std::suspend_always final_suspend() noexcept { return {}; } // The frame is destroyed by the AlarmScript
+        std::suspend_always yield_value(AlarmTone yielded) noexcept {
+            tone = yielded;
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        /**
+         * @brief Awaiter of \see Played, ready at once with the played time
+         */
+        struct PlayedAwaiter {
+            std::chrono::milliseconds played;
+            bool await_ready() const noexcept { return true; }
+            void await_suspend(std::coroutine_handle<>) const noexcept {}
+            std::chrono::milliseconds await_resume() const noexcept { return played; }
+        };
+        PlayedAwaiter await_transform(Played) const noexcept { return PlayedAwaiter{played}; }
+    };
+
+    /**
+     * @brief Awaitable returning the time played by the script, the start of the tone it is about to yield
+     */
+    static Played played(){ return Played(); }
+
+    AlarmScript(AlarmScript&& other) noexcept : m_coroutine(std::exchange(other.m_coroutine, nullptr)) {}
+    AlarmScript& operator=(AlarmScript&& other) noexcept {
+        if(this != &other){
+            if(m_coroutine) m_coroutine.destroy();
+            m_coroutine = std::exchange(other.m_coroutine, nullptr);
+        }
+        return *this;
+    }
+    ~AlarmScript() override {
+        if(m_coroutine) m_coroutine.destroy();
+    }
+
+    /**
+     * @brief Resumes the script until its next tone, \see AlarmToneSource::next()
+     */
+    bool next(AlarmTone& tone, std::chrono::milliseconds played) override {
+        if(!m_coroutine || m_coroutine.done()) return false;
+        m_coroutine.promise().played = played;
+        m_coroutine.resume();
+        if(m_coroutine.done()) return false;
+        tone = m_coroutine.promise().tone;
+        return true;
+    }
+
+private:
+    explicit AlarmScript(std::coroutine_handle<promise_type> coroutine) : m_coroutine(coroutine) {}
+
+    std::coroutine_handle<promise_type> m_coroutine; /**< Frame of the script, owned */
+
+    AlarmScript& operator= (const AlarmScript&) = delete;
+    AlarmScript (const AlarmScript&) = delete;
+};
+
+#endif //AlarmScript_h
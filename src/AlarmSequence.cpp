@@ -0,0 +1,150 @@
+#include "AlarmSequence.h"
+
+constexpr unsigned int AlarmTone::MAX_DURATION;
+constexpr std::size_t AlarmSequence::INLINE_CAPACITY;
+
+namespace {
+
+/**
+ * @brief Computes the cycle duration of tones, and the duration they share (0 if they differ)
+ */
+void measure(const AlarmTone* tones, std::size_t size, unsigned long long* edges, unsigned long long& duration, unsigned int& uniform){
+    duration = 0;
+    uniform = size ? tones[0].duration : 0;
+    for(std::size_t i=0;i<size;i++){
+        duration += tones[i].duration;
+        if(edges) edges[i] = duration;
+        if(tones[i].duration != uniform) uniform = 0;
+    }
+}
+
+/**
+ * @brief Storage of a short snapshot created at runtime, tones are stored inline and scanned without edges
+ * \tparam Capacity : number of inline tones, so short sequences don't pay for \see AlarmSequence::INLINE_CAPACITY
+ */
+template<std::size_t Capacity>
+struct InlineSequence {
+    InlineSequence(const std::vector<AlarmTone>& _tones) : sequence(nullptr, 0, nullptr, 0) {
+        std::copy(_tones.begin(), _tones.end(), tones);
+        sequence = AlarmSequence::wrap(tones, _tones.size());
+    }
+    InlineSequence(const InlineSequence&) = delete; // The sequence references the tones of this very object
+    AlarmSequence sequence;
+    AlarmTone tones[Capacity];
+};
+
+template<std::size_t Capacity>
+AlarmSequence::Ptr createInline(const std::vector<AlarmTone>& tones){
+    std::shared_ptr<InlineSequence<Capacity>> storage = std::make_shared<InlineSequence<Capacity>>(tones);
+    return AlarmSequence::Ptr(storage, &storage->sequence); // Aliasing: the snapshot keeps its storage alive
+}
+
+/**
+ * @brief Storage of a long snapshot created at runtime, the snapshot references its own vectors
+ */
+struct OwnedSequence {
+    OwnedSequence(const std::vector<AlarmTone>& _tones) : tones(_tones), edges(_tones.size()), sequence(nullptr, 0, nullptr, 0) {
+        unsigned long long duration;
+        unsigned int uniform;
+        measure(tones.data(), tones.size(), edges.data(), duration, uniform);
+        sequence = AlarmSequence(tones.data(), tones.size(), edges.data(), duration, uniform);
+    }
+    OwnedSequence(const OwnedSequence&) = delete; // The sequence references the vectors of this very object
+    std::vector<AlarmTone> tones;
+    std::vector<unsigned long long> edges;
+    AlarmSequence sequence;
+};
+
+const AlarmSequence emptySequence(nullptr, 0, nullptr, 0);
+
+/**
+ * @brief Duration shared by every tone of a tree, 0 if durations differ
+ */
+unsigned int uniformDuration(const AlarmSequenceNode* node){
+    if(!node->count) return node->tone.duration;
+    unsigned int uniform = uniformDuration(node->first());
+    for(unsigned int i=1;i<node->count && uniform;i++){
+        if(uniformDuration(node->first() + i) != uniform) uniform = 0;
+    }
+    return uniform;
+}
+
+/**
+ * @brief Child of a group holding a value, the last one starting at or before it
+ * \param key : member compared, \see AlarmSequenceNode::start or \see AlarmSequenceNode::offset
+ */
+const AlarmSequenceNode* childAt(const AlarmSequenceNode* group, unsigned long long AlarmSequenceNode::* key, unsigned long long value){
+    const AlarmSequenceNode* first = group->first();
+    return std::upper_bound(first + 1, first + group->count, value, [key](unsigned long long v, const AlarmSequenceNode& node){ return v < node.*key; }) - 1;
+}
+
+}
+
+AlarmSequence::Ptr AlarmSequence::create(const std::vector<AlarmTone>& tones){
+    if(tones.empty()) return empty();
+    static_assert(INLINE_CAPACITY == 8, "Inline capacities must be updated with INLINE_CAPACITY");
+    if(tones.size() <= 2) return createInline<2>(tones);
+    if(tones.size() <= 4) return createInline<4>(tones);
+    if(tones.size() <= 8) return createInline<8>(tones);
+    std::shared_ptr<OwnedSequence> storage = std::make_shared<OwnedSequence>(tones);
+    return Ptr(storage, &storage->sequence); // Aliasing: the snapshot keeps its storage alive
+}
+
+AlarmSequence AlarmSequence::wrap(const AlarmTone* tones, std::size_t size){
+    unsigned long long duration;
+    unsigned int uniform;
+    measure(tones, size, nullptr, duration, uniform);
+    return AlarmSequence(tones, size, nullptr, duration, uniform);
+}
+
+AlarmSequence AlarmSequence::tree(const AlarmSequenceNode* root){
+    AlarmSequence sequence(nullptr, root->tones * root->repeat, nullptr, root->period * root->repeat, uniformDuration(root));
+    sequence.m_root = root;
+    return sequence;
+}
+
+const AlarmTone& AlarmSequence::treeTone(std::size_t index) const {
+    const AlarmSequenceNode* node = m_root;
+    unsigned long long rest = index;
+    while(node->count){
+        rest %= node->tones; // Every iteration of a group holds the same tones
+        node = childAt(node, &AlarmSequenceNode::offset, rest);
+        rest -= node->offset;
+    }
+    return node->tone;
+}
+
+unsigned long long AlarmSequence::treeEdge(std::size_t index) const {
+    const AlarmSequenceNode* node = m_root;
+    unsigned long long rest = index, end = 0;
+    while(node->count){
+        end += rest / node->tones * node->period; // Whole iterations before the tone
+        rest %= node->tones;
+        node = childAt(node, &AlarmSequenceNode::offset, rest);
+        rest -= node->offset;
+        end += node->start;
+    }
+    return end + node->tone.duration;
+}
+
+std::size_t AlarmSequence::treeIndexAt(unsigned long long position) const {
+    const AlarmSequenceNode* node = m_root;
+    unsigned long long index = 0;
+    while(node->count){
+        index += position / node->period * node->tones; // Whole iterations before the position
+        position %= node->period;
+        node = childAt(node, &AlarmSequenceNode::start, position);
+        position -= node->start;
+        index += node->offset;
+    }
+    return index;
+}
+
+AlarmSequence::Ptr AlarmSequence::reference(const AlarmSequence& sequence){
+    return Ptr(Ptr(), &sequence); // Aliasing an empty owner: no control block, no allocation
+}
+
+const AlarmSequence::Ptr& AlarmSequence::empty(){
+    static const Ptr instance = reference(emptySequence);
+    return instance;
+}
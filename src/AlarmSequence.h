@@ -0,0 +1,254 @@
+/** 
+ *  @file   AlarmSequence.h 
+ *  @brief  Define the AlarmTone struct and the immutable AlarmSequence snapshot
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07 
+ **/
+
+#ifndef AlarmSequence_h
+#define AlarmSequence_h
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @brief Tone played during an alarm
+ * Packed in 32 bits: 31 bits of duration and 1 bit of beep
+ */
+typedef struct AlarmTone{
+    static constexpr unsigned int MAX_DURATION = 0x7FFFFFFF; /**< Longest duration of a tone in milliseconds (about 24 days) */
+
+    /**
+     *  \brief AlarmTone default contructor, a null silence
+     */
+    constexpr AlarmTone() : duration(0), beep(0) {};
+
+    /**
+     *  \brief AlarmTone contructor
+     *  \param _duration : initializes the \see duration attribute (in milliseconds), saturated to \see MAX_DURATION
+     *  \param _beep : initializes the \see beep attribute, true false noise, false for silence
+     */
+    constexpr AlarmTone(unsigned int _duration, bool _beep) : duration(_duration > MAX_DURATION ? MAX_DURATION : _duration), beep(_beep) {};
+    unsigned int duration : 31; /**< Duration of the tone in milliseconds */
+    unsigned int beep : 1; /**< Wether the tone should produce noise (true) or not (false) */
+} AlarmTone;
+static_assert(sizeof(AlarmTone) == 4, "AlarmTone must be packed in 32 bits");
+
+/**
+ * @brief Node of a compressed sequence, either a tone or a repeated group of nodes
+ * Nodes are stored in post-order: the children of a group are contiguous and placed before it,
+ * so a tree is relocatable and referenced by its root, the last node. See \see AlarmPatternCompiler
+ */
+struct AlarmSequenceNode {
+    AlarmTone tone; /**< Tone of a leaf, unused by a group */
+    unsigned int count = 0; /**< Number of children of a group, 0 for a tone */
+    unsigned int children = 0; /**< Distance from a group back to its first child, in nodes */
+    unsigned int repeat = 1; /**< Number of iterations of a group, 1 for a tone */
+    unsigned long long start = 0; /**< Start time in an iteration of the parent group, in milliseconds */
+    unsigned long long offset = 0; /**< Index of its first tone in an iteration of the parent group */
+    unsigned long long period = 0; /**< Duration of one iteration in milliseconds, the tone duration for a tone */
+    unsigned long long tones = 0; /**< Number of tones of one iteration, 1 for a tone */
+
+    /**
+     * @brief Getter of the first child of a group
+     */
+    const AlarmSequenceNode* first() const { return this - children; }
+};
+
+/**
+ * @brief Immutable snapshot of an \see AlarmTone sequence
+ * An Alarm publishes a new snapshot each time its sequence changes, so the \see AlarmPlayer
+ * can keep reading the previous one without copy nor lock (read-copy-update).
+ * The snapshot only references its tones and edges: they are either owned by the snapshot (\see create())
+ * or stored in static read-only storage (\see AlarmPattern).
+ * Edges form a prefix-sum timeline: the tone played at any position is found by binary search,
+ * or directly when every tone has the same duration. Short sequences may have no edges,
+ * their tones are then scanned linearly, which is as fast for a few tones.
+ * A compressed sequence instead references a tree of repeated groups (\see tree()), which is never expanded:
+ * lookups descend the tree with a binary search per level.
+ */
+class AlarmSequence {
+public:
+    typedef std::shared_ptr<const AlarmSequence> Ptr; /**< Reference-counted snapshot, shared by Alarm and AlarmPlayer */
+
+    static constexpr std::size_t INLINE_CAPACITY = 8; /**< Sequences up to this size are stored without edges nor separate tone allocation */
+
+    /**
+     * @brief Constructor of a snapshot referencing external storage
+     * \param tones : the tones of the sequence
+     * \param size : the number of tones
+     * \param edges : the cumulative end time of every tone, in milliseconds from the begining of the sequence,
+     *                nullptr to scan the tones instead (only for short sequences)
+     * \param duration : the duration of a whole cycle of the sequence, in milliseconds
+     * \param uniform : the duration shared by every tone, 0 if durations differ
+     * \warning tones and edges are not copied, they must outlive the snapshot
+     */
+    constexpr explicit AlarmSequence(const AlarmTone* tones, std::size_t size, const unsigned long long* edges, unsigned long long duration, unsigned int uniform=0)
+        : m_tones(tones), m_edges(edges), m_duration(duration), m_size(size), m_uniform(uniform), m_root(nullptr) {}
+
+    /**
+     * @brief Iterator over the tones of a snapshot, by index so it also walks compressed sequences
+     */
+    class const_iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef AlarmTone value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const AlarmTone* pointer;
+        typedef const AlarmTone& reference;
+
+        const_iterator(const AlarmSequence* sequence, std::size_t index) : m_sequence(sequence), m_index(index) {}
+        reference operator*() const { return (*m_sequence)[m_index]; }
+        pointer operator->() const { return &(*m_sequence)[m_index]; }
+        reference operator[](difference_type offset) const { return (*m_sequence)[m_index + offset]; }
+        const_iterator& operator++(){ m_index++; return *this; }
+        const_iterator operator++(int){ const_iterator copy = *this; m_index++; return copy; }
+        const_iterator& operator--(){ m_index--; return *this; }
+        const_iterator operator--(int){ const_iterator copy = *this; m_index--; return copy; }
+        const_iterator& operator+=(difference_type offset){ m_index += offset; return *this; }
+        const_iterator& operator-=(difference_type offset){ m_index -= offset; return *this; }
+        const_iterator operator+(difference_type offset) const { return const_iterator(m_sequence, m_index + offset); }
+        const_iterator operator-(difference_type offset) const { return const_iterator(m_sequence, m_index - offset); }
+        difference_type operator-(const const_iterator& other) const { return difference_type(m_index - other.m_index); }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+        bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+        bool operator>(const const_iterator& other) const { return m_index > other.m_index; }
+        bool operator<=(const const_iterator& other) const { return m_index <= other.m_index; }
+        bool operator>=(const const_iterator& other) const { return m_index >= other.m_index; }
+
+    private:
+        const AlarmSequence* m_sequence; /**< Iterated sequence */
+        std::size_t m_index; /**< Index of the current tone */
+    };
+
+    /**
+     * @brief Creates a new snapshot owning a copy of a tone sequence
+     * \param tones : the tones of the sequence
+     * \return the new immutable snapshot, sequences up to \see INLINE_CAPACITY tones are stored in a single allocation
+     */
+    static Ptr create(const std::vector<AlarmTone>& tones);
+
+    /**
+     * @brief Builds a sequence over short external tones, without edges
+     * \param tones : the tones of the sequence, not copied
+     * \param size : the number of tones, should not exceed \see INLINE_CAPACITY as tones are scanned linearly
+     * \return the sequence, to be published with \see reference()
+     */
+    static AlarmSequence wrap(const AlarmTone* tones, std::size_t size);
+
+    /**
+     * @brief Builds a compressed sequence over a tree of nodes, without expanding its repetitions
+     * \param root : the root group of the tree, its children being stored before it, see \see AlarmSequenceNode
+     * \return the sequence, to be published with \see reference() or owned by the storage of the nodes
+     * \warning the nodes are not copied, they must outlive the sequence. The tree must have less than 2^32 tones
+     */
+    static AlarmSequence tree(const AlarmSequenceNode* root);
+
+    /**
+     * @brief Creates a non-owning snapshot of a sequence in static storage, without allocation
+     * \param sequence : the static sequence, see \see AlarmPattern
+     * \return a snapshot pointing to the static sequence
+     */
+    static Ptr reference(const AlarmSequence& sequence);
+
+    /**
+     * @brief Getter of the shared empty snapshot
+     * \return an empty snapshot, never allocated
+     */
+    static const Ptr& empty();
+
+    /**
+     * @brief Copies the tones of the snapshot
+     */
+    std::vector<AlarmTone> toVector() const { return std::vector<AlarmTone>(begin(), end()); }
+
+    /**
+     * @brief Number of tones in the snapshot
+     */
+    std::size_t size() const { return m_size; }
+
+    /**
+     * @brief Getter of a tone, without bounds checking
+     */
+    const AlarmTone& operator[](std::size_t index) const {
+        if(m_root) return this->treeTone(index);
+        return m_tones[index];
+    }
+
+    /**
+     * @brief Iterators over the tones of the snapshot
+     */
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+
+    /**
+     * @brief Getter of the stored tones of a flat sequence, referenced in place
+     * \return the tones, nullptr for a compressed sequence
+     */
+    const AlarmTone* tones() const { return m_tones; }
+
+    /**
+     * @brief Wether the sequence is a tree of repeated groups, \see tree()
+     */
+    bool isCompressed() const { return m_root != nullptr; }
+
+    /**
+     * @brief Getter of the end time of a tone, without bounds checking
+     * \return the end time of the tone in milliseconds from the begining of the sequence
+     */
+    unsigned long long edge(std::size_t index) const {
+        if(m_edges) return m_edges[index];
+        if(m_root) return this->treeEdge(index);
+        unsigned long long end = 0;
+        for(std::size_t i=0;i<=index;i++) end += m_tones[i].duration;
+        return end;
+    }
+
+    /**
+     * @brief Duration of a whole cycle of the sequence, precomputed at creation
+     * \return the sum of the tone durations in milliseconds
+     */
+    unsigned long long duration() const { return m_duration; }
+
+    /**
+     * @brief Index of the tone played at a position of the timeline, O(log n) or O(1) for uniform durations
+     * \param position : position in milliseconds from the begining of the sequence, wraps at \see duration()
+     * \return the index of the tone, \see size() if the sequence has nothing to play
+     */
+    std::size_t indexAt(unsigned long long position) const {
+        if(!m_duration) return m_size;
+        position %= m_duration;
+        if(m_uniform) return position / m_uniform;
+        if(m_root) return this->treeIndexAt(position);
+        if(m_edges) return std::upper_bound(m_edges, m_edges + m_size, position) - m_edges; // First tone ending after position
+        std::size_t index = 0;
+        while(position >= m_tones[index].duration) position -= m_tones[index++].duration;
+        return index;
+    }
+
+    /**
+     * @brief Tone played at a position of the timeline, see \see indexAt()
+     * \warning the sequence must have a non-null \see duration()
+     */
+    const AlarmTone& toneAt(unsigned long long position) const { return (*this)[indexAt(position)]; }
+
+private:
+    /**
+     * @brief Lookups of a compressed sequence, descending the tree from its root
+     */
+    const AlarmTone& treeTone(std::size_t index) const;
+    unsigned long long treeEdge(std::size_t index) const;
+    std::size_t treeIndexAt(unsigned long long position) const;
+
+    const AlarmTone* m_tones; /**< The tones of the sequence */
+    const unsigned long long* m_edges; /**< Cumulative end time of every tone in milliseconds */
+    unsigned long long m_duration; /**< Sum of the tone durations in milliseconds */
+    unsigned int m_size; /**< Number of tones */
+    unsigned int m_uniform; /**< Duration shared by every tone, 0 if durations differ */
+    const AlarmSequenceNode* m_root; /**< Root group of a compressed sequence, nullptr for a flat one */
+};
+
+#endif //AlarmSequence_h
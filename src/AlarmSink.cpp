@@ -0,0 +1,60 @@
+#include "AlarmSink.h"
+
+AlarmStreamSink::AlarmStreamSink(std::ostream& output) : m_output(output) {
+
+}
+
+void AlarmStreamSink::write(const AlarmEdge& edge){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_output << (edge.noisy?"X\a":"_") << std::flush;
+}
+
+AlarmConsoleSink::AlarmConsoleSink() : AlarmStreamSink(std::cout) {
+
+}
+
+AlarmFileSink::AlarmFileSink(const std::string& path) : m_file(path, std::ios::out | std::ios::trunc) {
+
+}
+
+void AlarmFileSink::write(const AlarmEdge& edge){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::chrono::milliseconds time = std::chrono::duration_cast<std::chrono::milliseconds>(edge.time.time_since_epoch());
+    m_file << time.count() << ' ' << (edge.noisy?'X':'_') << '\n' << std::flush;
+}
+
+bool AlarmFileSink::isOpen(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_file.is_open();
+}
+
+void AlarmRecorderSink::write(const AlarmEdge& edge){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_edges.push_back(edge);
+}
+
+std::vector<AlarmEdge> AlarmRecorderSink::getEdges(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_edges;
+}
+
+std::string AlarmRecorderSink::getText(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::string text;
+    for(const AlarmEdge& edge : m_edges) text += edge.noisy ? 'X' : '_';
+    return text;
+}
+
+void AlarmRecorderSink::clear(){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_edges.clear();
+}
+
+AlarmCallbackSink::AlarmCallbackSink(std::function<void(const AlarmEdge&)> callback) : m_callback(callback) {
+
+}
+
+void AlarmCallbackSink::write(const AlarmEdge& edge){
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if(m_callback) m_callback(edge);
+}
@@ -0,0 +1,156 @@
+/**
+ *  @file   AlarmSink.h
+ *  @brief  Define the AlarmSink output interface and its console, file, recorder and callback implementations
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmSink_h
+#define AlarmSink_h
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <functional>
+
+/**
+ * @brief Tone edge emitted by an \see AlarmPlayer
+ */
+struct AlarmEdge {
+    std::chrono::steady_clock::time_point time; /**< Time at which the player emitted the edge */
+    bool noisy = false; /**< true for a beep, false for a silence */
+};
+
+/**
+ * @brief Policy of the \see AlarmScheduler when its edge ring is full, because sinks are slower than the playback
+ */
+enum class AlarmSinkPolicy {
+    COALESCE, /**< The latest edge of each player is kept aside and queued once room is available, intermediate edges are skipped */
+    DROP /**< New edges are discarded, a sink may stay in a stale state until the next edge */
+};
+
+/**
+ * @brief Counters of the edges sent to the sinks by an \see AlarmScheduler
+ */
+struct AlarmSinkStats {
+    unsigned long long queued = 0; /**< Edges pushed to the ring */
+    unsigned long long delivered = 0; /**< Edges written to their sink */
+    unsigned long long dropped = 0; /**< Edges discarded by the \see AlarmSinkPolicy::DROP policy */
+    unsigned long long coalesced = 0; /**< Edges skipped by the \see AlarmSinkPolicy::COALESCE policy, replaced by a later edge */
+};
+
+/**
+ * @brief Output of an \see AlarmPlayer, receiving its tone edges
+ * Edges are written by the sink thread of the \see AlarmScheduler, away from the playback thread,
+ * so a slow output never delays the playback. A sink can be shared by several players.
+ * \warning \see write() may be called from several threads, implementations must be thread-safe
+ */
+class AlarmSink {
+public:
+    virtual ~AlarmSink() {}
+
+    /**
+     * @brief Emits a tone edge
+     * \param edge : the edge to emit
+     */
+    virtual void write(const AlarmEdge& edge) = 0;
+};
+
+/**
+ * @brief Sink mocking-up noise-emitting hardware on a stream
+ * An 'X' will be printed when noisy, as an attempt to produce sound a '\a' is also printed
+ * An '_' will be printed when silent
+ */
+class AlarmStreamSink : public AlarmSink {
+public:
+    /**
+     * @brief Constructor of an AlarmStreamSink
+     * \param output : the stream edges are printed to, must outlive the sink
+     */
+    AlarmStreamSink(std::ostream& output);
+    void write(const AlarmEdge& edge) override;
+
+private:
+    std::ostream& m_output; /**< Stream the edges are printed to */
+    std::mutex m_mtx; /**< Serializes the writers */
+};
+
+/**
+ * @brief \see AlarmStreamSink printing to the standard output
+ */
+class AlarmConsoleSink : public AlarmStreamSink {
+public:
+    AlarmConsoleSink();
+};
+
+/**
+ * @brief Sink logging edges to a file, one line per edge: the edge time in milliseconds followed by 'X' or '_'
+ */
+class AlarmFileSink : public AlarmSink {
+public:
+    /**
+     * @brief Constructor of an AlarmFileSink
+     * \param path : path of the file, truncated if it exists
+     */
+    AlarmFileSink(const std::string& path);
+    void write(const AlarmEdge& edge) override;
+
+    /**
+     * @brief Wether the file has been opened successfully
+     */
+    bool isOpen();
+
+private:
+    std::ofstream m_file; /**< Output file */
+    std::mutex m_mtx; /**< Serializes the writers */
+};
+
+/**
+ * @brief Sink storing edges in memory, useful for tests
+ */
+class AlarmRecorderSink : public AlarmSink {
+public:
+    void write(const AlarmEdge& edge) override;
+
+    /**
+     * @brief Getter of the recorded edges
+     * \return a copy of the edges, oldest first
+     */
+    std::vector<AlarmEdge> getEdges();
+
+    /**
+     * @brief Getter of the recorded edges as text, 'X' for a beep and '_' for a silence
+     */
+    std::string getText();
+
+    /**
+     * @brief Forgets the recorded edges
+     */
+    void clear();
+
+private:
+    std::vector<AlarmEdge> m_edges; /**< Recorded edges */
+    std::mutex m_mtx; /**< Protects the recorded edges */
+};
+
+/**
+ * @brief Sink forwarding edges to a function
+ */
+class AlarmCallbackSink : public AlarmSink {
+public:
+    /**
+     * @brief Constructor of an AlarmCallbackSink
+     * \param callback : the function called for every edge, calls are serialized by the sink
+     */
+    AlarmCallbackSink(std::function<void(const AlarmEdge&)> callback);
+    void write(const AlarmEdge& edge) override;
+
+private:
+    std::function<void(const AlarmEdge&)> m_callback; /**< Function called for every edge */
+    std::mutex m_mtx; /**< Serializes the calls */
+};
+
+#endif //AlarmSink_h
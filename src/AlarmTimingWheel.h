@@ -0,0 +1,195 @@
+/**
+ *  @file   AlarmTimingWheel.h
+ *  @brief  Define the AlarmTimingWheel hierarchical timer index used by the AlarmScheduler
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmTimingWheel_h
+#define AlarmTimingWheel_h
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Intrusive links stored inside every timer of an \see AlarmTimingWheel
+ * An item can be linked in a single \see AlarmTimingWheel at a time
+ */
+template<typename T>
+struct AlarmTimerHook {
+    T* prev = nullptr; /**< Previous item of the same slot, nullptr for the first one */
+    T* next = nullptr; /**< Next item of the same slot, nullptr for the last one */
+    std::uint64_t tick = 0; /**< Expiry tick of the item */
+    int level = -1; /**< Wheel level the item is linked in, -1 when not scheduled */
+    unsigned int slot = 0; /**< Slot of the level the item is linked in */
+};
+
+/**
+ * @brief Hierarchical timing wheel of items expiring at a tick
+ * Each level is made of 64 slots, a slot of level n covering 64^n ticks. Items are linked in the level
+ * of the highest tick digit differing from the current tick, and cascade to lower levels when the
+ * wheel reaches their slot. The top level is circular: its slots before the current one hold the items
+ * of the next \see HORIZON block. Insertion and cancellation are O(1), expiry is O(1) amortized, and the
+ * next expiry is found from per-level occupancy bitmaps without scanning the slots. Never allocates.
+ * \tparam T : type of the scheduled items
+ * \tparam Hook : the \see AlarmTimerHook member of T used for linking
+ * \warning This class is not thread-safe, the owner must protect it
+ */
+template<typename T, AlarmTimerHook<T> T::*Hook>
+class AlarmTimingWheel {
+public:
+    static const int LEVELS = 5; /**< Number of levels of the wheel */
+    static const int SLOT_BITS = 6; /**< Number of tick bits covered by a level */
+    static const unsigned int SLOTS = 1u << SLOT_BITS; /**< Number of slots per level */
+    static const std::uint64_t HORIZON = 1ull << (SLOT_BITS * LEVELS); /**< Ticks covered by the wheel, 2^30 (about 12 days of milliseconds) */
+    static const std::uint64_t NONE = ~0ull; /**< Returned by \see nextTick() when the wheel is empty */
+
+    /**
+     * @brief Schedules an item, or moves it if already scheduled
+     * \param item : the item to schedule
+     * \param tick : the expiry tick, items in the past expire at the current tick
+     * \note an expiry beyond the horizon is shortened, the item expires early but at least \see HORIZON minus a top level slot ticks from now
+     */
+    void insert(T* item, std::uint64_t tick){
+        this->remove(item);
+        if(tick < m_now) tick = m_now;
+        // Up to the tick before the current top level slot comes back around, so a top level slot never mixes two blocks
+        int top = SLOT_BITS * (LEVELS - 1);
+        std::uint64_t last = ((m_now >> top) << top) + HORIZON - 1;
+        if(tick > last) tick = last;
+        (item->*Hook).tick = tick;
+        this->link(item);
+    }
+
+    /**
+     * @brief Cancels a scheduled item
+     * \param item : the item to cancel
+     * \warning if the item is not scheduled, this function has no effect
+     */
+    void remove(T* item){
+        AlarmTimerHook<T>& hook = item->*Hook;
+        if(hook.level < 0) return;
+        T*& head = m_slots[hook.level][hook.slot];
+        if(hook.prev) (hook.prev->*Hook).next = hook.next;
+        else head = hook.next;
+        if(hook.next) (hook.next->*Hook).prev = hook.prev;
+        if(!head) m_occupied[hook.level] &= ~(1ull << hook.slot);
+        hook.prev = hook.next = nullptr;
+        hook.level = -1;
+        m_size--;
+    }
+
+    /**
+     * @brief Removes one expired item
+     * The wheel moves forward up to the target tick, cascading the slots it reaches
+     * \param target : the current tick, items expiring at or before it are expired
+     * \return an expired item, nullptr if no item expired
+     */
+    T* pop(std::uint64_t target){
+        for(std::uint64_t tick = this->nextTick(); tick != NONE && tick <= target; tick = this->nextTick()){
+            m_now = tick; // No item expires between the previous tick and this one
+            T* item = m_slots[0][m_now % SLOTS];
+            if(item && (item->*Hook).tick == m_now){
+                this->remove(item);
+                return item;
+            }
+            this->cascade();
+        }
+        if(target > m_now) m_now = target; // Nothing expires until the target, the wheel can jump there
+        return nullptr;
+    }
+
+    /**
+     * @brief Getter of the next tick the wheel has to be looked at
+     * This is the expiry of the earliest item, or the start of the slot it has to be cascaded from
+     * \return the next tick, \see NONE if the wheel is empty
+     */
+    std::uint64_t nextTick() const {
+        for(int level=0; level<LEVELS; level++){
+            int shift = SLOT_BITS * level;
+            unsigned int current = (m_now >> shift) % SLOTS;
+            std::uint64_t pending = m_occupied[level] & (~0ull << current); // Slots before the current one are empty
+            std::uint64_t block = (m_now >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+            if(!pending && level == LEVELS-1 && m_occupied[level]){ // Only items of the next block
+                pending = m_occupied[level];
+                block += HORIZON;
+            }
+            if(!pending) continue;
+            unsigned int slot = __builtin_ctzll(pending);
+            std::uint64_t start = block | (std::uint64_t(slot) << shift);
+            return start > m_now ? start : m_now;
+        }
+        return NONE;
+    }
+
+    /**
+     * @brief Wether an item is currently scheduled
+     */
+    bool contains(const T* item) const { return (item->*Hook).level >= 0; }
+
+    /**
+     * @brief Getter of the expiry tick of a scheduled item
+     */
+    std::uint64_t tick(const T* item) const { return (item->*Hook).tick; }
+
+    /**
+     * @brief Getter of the current tick of the wheel
+     */
+    std::uint64_t now() const { return m_now; }
+
+    /**
+     * @brief Number of scheduled items
+     */
+    std::size_t size() const { return m_size; }
+
+    /**
+     * @brief Wether the wheel has no item
+     */
+    bool empty() const { return m_size == 0; }
+
+private:
+    /**
+     * @brief Links an item in the slot of its expiry tick, relative to the current tick
+     */
+    void link(T* item){
+        AlarmTimerHook<T>& hook = item->*Hook;
+        int level = 0;
+        while(level < LEVELS-1 && (hook.tick >> (SLOT_BITS * (level+1))) != (m_now >> (SLOT_BITS * (level+1)))) level++;
+        hook.level = level;
+        hook.slot = (hook.tick >> (SLOT_BITS * level)) % SLOTS;
+        T*& head = m_slots[level][hook.slot];
+        hook.prev = nullptr;
+        hook.next = head;
+        if(head) (head->*Hook).prev = item;
+        head = item;
+        m_occupied[level] |= 1ull << hook.slot;
+        m_size++;
+    }
+
+    /**
+     * @brief Moves the items of the slots starting at the current tick to lower levels
+     */
+    void cascade(){
+        for(int level=1; level<LEVELS; level++){
+            unsigned int slot = (m_now >> (SLOT_BITS * level)) % SLOTS;
+            T* item = m_slots[level][slot];
+            while(item){
+                T* next = (item->*Hook).next;
+                this->remove(item);
+                this->link(item);
+                item = next;
+            }
+        }
+    }
+
+    T* m_slots[LEVELS][SLOTS] = {}; /**< Head of the item list of every slot */
+    std::uint64_t m_occupied[LEVELS] = {}; /**< One bit per non-empty slot */
+    std::uint64_t m_now = 0; /**< Current tick, items expiring before it have been popped */
+    std::size_t m_size = 0; /**< Number of scheduled items */
+};
+template<typename T, AlarmTimerHook<T> T::*Hook>
+const std::uint64_t AlarmTimingWheel<T, Hook>::HORIZON;
+template<typename T, AlarmTimerHook<T> T::*Hook>
+const std::uint64_t AlarmTimingWheel<T, Hook>::NONE;
+
+#endif //AlarmTimingWheel_h
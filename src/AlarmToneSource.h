@@ -0,0 +1,39 @@
+/**
+ *  @file   AlarmToneSource.h
+ *  @brief  Define the AlarmToneSource interface, tones pulled one at a time by the AlarmPlayer
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07
+ **/
+
+#ifndef AlarmToneSource_h
+#define AlarmToneSource_h
+
+#include <memory>
+#include <chrono>
+
+#include "AlarmSequence.h"
+
+/**
+ * @brief Source of the tones of a scripted alarm, pulled lazily by its \see AlarmPlayer
+ * Instead of looping over a sequence, the player asks the source for the next tone each time the current one ends,
+ * so a source may count its cycles, end after some of them or change its rhythm as it plays, without a thread
+ * nor a new sequence per change. \see AlarmScript writes sources as C++20 coroutines.
+ * \warning \see next() is called by the scheduler thread while the player is locked: it must return quickly,
+ * without blocking nor calling the Alarm or AlarmPlayer functions
+ */
+class AlarmToneSource {
+public:
+    typedef std::shared_ptr<AlarmToneSource> Ptr; /**< Source shared by the Alarm and its AlarmPlayer */
+
+    virtual ~AlarmToneSource() {}
+
+    /**
+     * @brief Pulls the next tone
+     * \param tone : receives the next tone, a null duration skips it
+     * \param played : time played by the source so far, the start of the requested tone in its own timeline
+     * \return false once the source is exhausted, the alarm then stops
+     */
+    virtual bool next(AlarmTone& tone, std::chrono::milliseconds played) = 0;
+};
+
+#endif //AlarmToneSource_h
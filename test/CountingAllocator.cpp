@@ -0,0 +1,22 @@
+#include "CountingAllocator.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counting allocator: every heap allocation of the test binary goes through here
+static std::atomic<unsigned long> g_allocations(0);
+
+void* operator new(std::size_t size){
+    g_allocations++;
+    if(void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){ return ::operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+unsigned long heapAllocations(){
+    return g_allocations;
+}
@@ -0,0 +1,17 @@
+/** 
+ *  @file   CountingAllocator.h 
+ *  @brief  Replacement of the global operator new counting the heap allocations of the unit tests
+ *  @author BREHMER Alexandre
+ *  @date   2020-11-07 
+ **/
+
+#ifndef CountingAllocator_h
+#define CountingAllocator_h
+
+/**
+ * @brief Number of heap allocations made through operator new since the start of the test binary
+ * Tests check that an operation doesn't allocate by comparing the count before and after it
+ */
+unsigned long heapAllocations();
+
+#endif //CountingAllocator_h
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include <AlarmCatalog.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <cstdio>
+#include <fstream>
+
+static std::vector<AlarmCatalogPattern> patterns(){
+    std::vector<AlarmCatalogPattern> patterns(3);
+    patterns[0].name = "fire";
+    patterns[0].level = AlarmLevel::HIGH;
+    patterns[0].tones = {AlarmTone(250, true), AlarmTone(250, false)};
+    patterns[1].name = "door";
+    patterns[1].level = AlarmLevel::LOW;
+    for(unsigned int i=1;i<=10;i++) patterns[1].tones.push_back(AlarmTone(i*100, i % 2)); // Long pattern, with edges
+    patterns[2].name = "empty";
+    return patterns;
+}
+
+TEST(alarm_catalog, write_open){
+    const std::string path = "alarm_catalog_test.alc";
+    ASSERT_EQ(AlarmCatalog::write(path, patterns()), true);
+    {
+        AlarmCatalog catalog(path);
+        ASSERT_EQ(catalog.isOpen(), true);
+        ASSERT_EQ(catalog.verify(), true);
+        ASSERT_EQ(catalog.size(), 3);
+        // Sorted by name
+        ASSERT_EQ(catalog.name(0), "door");
+        ASSERT_EQ(catalog.name(1), "empty");
+        ASSERT_EQ(catalog.name(2), "fire");
+        ASSERT_EQ(catalog.find("fire"), 2);
+        ASSERT_EQ(catalog.find("fir"), 3);
+        ASSERT_EQ(catalog.find("fires"), 3);
+
+        AlarmSequence door = catalog.sequence(catalog.find("door"));
+        ASSERT_EQ(door.size(), 10);
+        ASSERT_EQ(door.duration(), 5500);
+        ASSERT_EQ(door.indexAt(250), 1);
+        ASSERT_EQ(door[1].duration, 200);
+        ASSERT_EQ(door[1].beep, false);
+        ASSERT_EQ(catalog.sequence(1).duration(), 0);
+
+        // Alarms reference the mapped tones, and play them
+        AlarmManualClock clock;
+        AlarmScheduler scheduler(clock);
+        AlarmRecorderSink output;
+        AlarmPlayer player(output, scheduler);
+        Alarm fire = catalog.create("fire");
+        ASSERT_EQ(fire.getLevel(), AlarmLevel::HIGH);
+        ASSERT_EQ(fire.getSequenceSnapshot()->tones(), catalog.sequence(2).tones());
+        fire.setPlayer(player);
+        fire.start();
+        clock.advance(std::chrono::milliseconds(600));
+        ASSERT_EQ(output.getText(), "X_X");
+        fire.stop();
+        ASSERT_EQ(catalog.create("unknown").getSequence().size(), 0);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(alarm_catalog, invalid){
+    const std::string path = "alarm_catalog_invalid.alc";
+    std::vector<AlarmCatalogPattern> duplicated = patterns();
+    duplicated[1].name = "fire";
+    ASSERT_EQ(AlarmCatalog::write(path, duplicated), false);
+    ASSERT_EQ(AlarmCatalog("missing.alc").isOpen(), false);
+
+    // Truncated file
+    ASSERT_EQ(AlarmCatalog::write(path, patterns()), true);
+    std::string content;
+    {
+        std::ifstream file(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(content.data(), content.size() - 1);
+    ASSERT_EQ(AlarmCatalog(path).isOpen(), false);
+
+    // Corrupted precomputed duration, only detected by verify()
+    content[40 + 24] ^= 1;
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(content.data(), content.size());
+    AlarmCatalog catalog(path);
+    ASSERT_EQ(catalog.isOpen(), true);
+    ASSERT_EQ(catalog.verify(), false);
+
+    // Other version
+    content[8] = 2;
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(content.data(), content.size());
+    ASSERT_EQ(AlarmCatalog(path).isOpen(), false);
+    std::remove(path.c_str());
+}
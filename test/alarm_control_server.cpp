@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include <AlarmControlServer.h>
+#include <AlarmPatternCompiler.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+
+// Blocking client of the control protocol, reading whole lines
+class Client {
+public:
+    explicit Client(const std::string& path){
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::copy(path.begin(), path.end(), address.sun_path);
+        m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        timeval timeout = {5, 0}; // A missing reply fails instead of hanging
+        ::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        m_connected = ::connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+    ~Client(){ ::close(m_fd); }
+
+    bool isConnected() const { return m_connected; }
+
+    void send(const std::string& text){
+        ASSERT_EQ(::write(m_fd, text.data(), text.size()), (ssize_t)text.size());
+    }
+
+    // Next line, empty once the server closed the connection
+    std::string line(){
+        std::size_t end;
+        while((end = m_input.find('\n')) == std::string::npos){
+            char buffer[4096];
+            ssize_t size = ::read(m_fd, buffer, sizeof(buffer));
+            if(size <= 0) return "";
+            m_input.append(buffer, size);
+        }
+        std::string line = m_input.substr(0, end);
+        m_input.erase(0, end + 1);
+        return line;
+    }
+
+private:
+    int m_fd;
+    bool m_connected;
+    std::string m_input;
+};
+
+static const char* SOCKET_PATH = "alarm_control_test.sock";
+
+TEST(alarm_control_server, commands){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    AlarmControlServer server(SOCKET_PATH, player);
+    ASSERT_TRUE(server.isOpen());
+    ASSERT_TRUE(server.start());
+    ASSERT_FALSE(server.start());
+
+    Client client(SOCKET_PATH);
+    ASSERT_TRUE(client.isConnected());
+    // Pipelined: every command is sent at once, the replies come in order
+    client.send("ping\ndefine fire HIGH (100X 100_)x2 300_\r\nstart fire\nstate fire\nlevel fire LOW\nstate fire\n"
+                "start nothing\nstop\nfly fire\ndefine bad HIGH (100X\nlevel fire SEVERE\n");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "state fire STARTED HIGH");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "state fire STARTED LOW"); // Played on the next update of the player
+    ASSERT_EQ(client.line(), "error unknown alarm");
+    ASSERT_EQ(client.line(), "error unknown alarm");
+    ASSERT_EQ(client.line(), "error unknown command");
+    ASSERT_EQ(client.line(), "error unbalanced '(' at 16");
+    ASSERT_EQ(client.line(), "error expected a level LOW, MEDIUM or HIGH");
+    ASSERT_EQ(server.getCommandCount(), 11);
+
+    // The alarm plays on the player of the server
+    clock.advance(std::chrono::milliseconds(250));
+    client.send("ack fire\nack nothing\nstop fire\nstate fire\n");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "error unknown alarm");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "state fire IDLE LOW");
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(output.getText(), "X_X_");
+
+    // Lines beyond the limit disconnect the client
+    client.send(std::string(AlarmControlServer::MAX_LINE + 1, 'a'));
+    ASSERT_EQ(client.line(), "error line too long");
+    ASSERT_EQ(client.line(), "");
+    server.stop();
+}
+
+TEST(alarm_control_server, batch_and_events){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    AlarmControlServer server(SOCKET_PATH, player);
+    server.define("low", AlarmPatternCompiler::compile("1000X 1000_"), AlarmLevel::LOW);
+    server.define("high", AlarmPatternCompiler::compile("500X 500_"), AlarmLevel::HIGH);
+    ASSERT_TRUE(server.start());
+
+    Client subscriber(SOCKET_PATH);
+    subscriber.send("subscribe\n");
+    ASSERT_EQ(subscriber.line(), "ok");
+    Client client(SOCKET_PATH);
+    client.send("begin\nstart low\nstart high\ndefine other LOW 1X\nbegin\ncommit\ncommit\n");
+    ASSERT_EQ(client.line(), "ok");
+    ASSERT_EQ(client.line(), "queued");
+    ASSERT_EQ(client.line(), "queued");
+    ASSERT_EQ(client.line(), "error define in a batch");
+    ASSERT_EQ(client.line(), "error already in a batch");
+    ASSERT_EQ(client.line(), "ok 2");
+    ASSERT_EQ(client.line(), "error not in a batch");
+
+    // Both alarms were attached at once: the high one plays first
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(output.getText(), "X");
+    client.send("state high\nstate low\n");
+    ASSERT_EQ(client.line(), "state high PLAYING HIGH");
+    ASSERT_EQ(client.line(), "state low STARTED LOW");
+
+    ASSERT_EQ(subscriber.line(), "event low started LOW");
+    ASSERT_EQ(subscriber.line(), "event high started HIGH");
+    server.define("high", AlarmPatternCompiler::compile("250X 250_"), AlarmLevel::MEDIUM);
+    ASSERT_EQ(subscriber.line(), "event high defined MEDIUM");
+    ASSERT_EQ(server.getClientCount(), 2);
+    server.stop();
+}
+
+TEST(alarm_control_server, stop_while_idle){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    AlarmControlServer server(SOCKET_PATH, player);
+    ASSERT_TRUE(server.isOpen());
+    // Nothing serves yet: stopping must not leak into the next start
+    server.stop();
+    server.stop();
+    ASSERT_TRUE(server.start());
+
+    Client client(SOCKET_PATH);
+    ASSERT_TRUE(client.isConnected());
+    client.send("ping\n");
+    ASSERT_EQ(client.line(), "ok");
+    server.stop();
+
+    // Restarted after a stop, then stopped again
+    ASSERT_TRUE(server.start());
+    Client again(SOCKET_PATH);
+    ASSERT_TRUE(again.isConnected());
+    again.send("ping\n");
+    ASSERT_EQ(again.line(), "ok");
+    server.stop();
+}
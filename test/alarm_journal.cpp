@@ -0,0 +1,339 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmJournal.h>
+#include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include "CountingAllocator.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+static std::chrono::steady_clock::time_point at(long long milliseconds){
+    return std::chrono::steady_clock::time_point(std::chrono::milliseconds(milliseconds));
+}
+
+static long long elapsed(std::chrono::nanoseconds time){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time).count();
+}
+
+// Times of edges in milliseconds, relative to the first one
+static std::vector<long long> relative(const std::vector<AlarmEdge>& edges){
+    std::vector<long long> times;
+    for(const AlarmEdge& edge : edges) times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(edge.time - edges.front().time).count() * (edge.noisy ? 1 : -1));
+    return times;
+}
+
+TEST(alarm_journal, append_read){
+    const std::string path = "alarm_journal_test.alj";
+    std::remove(path.c_str());
+    {
+        AlarmJournal journal(path, 8);
+        ASSERT_EQ(journal.isOpen(), true);
+        ASSERT_EQ(journal.records().size(), 0);
+        AlarmHandle alarm;
+        alarm.index = 3;
+        alarm.generation = 7;
+        journal.append(AlarmJournalEvent::START, at(10), 2, alarm, (std::uint8_t)AlarmLevel::HIGH, 500);
+        journal.append(AlarmJournalEvent::EDGE, at(20), 2, AlarmHandle(), 0);
+
+        std::vector<AlarmJournalRecord> records = journal.records();
+        ASSERT_EQ(records.size(), 2);
+        ASSERT_EQ(records[0].sequence, 1);
+        ASSERT_EQ(records[0].event, AlarmJournalEvent::START);
+        ASSERT_EQ(records[0].time, 10000000);
+        ASSERT_EQ(records[0].zone, 2);
+        ASSERT_EQ(records[0].value, (std::uint8_t)AlarmLevel::HIGH);
+        ASSERT_EQ(records[0].other, 500);
+        ASSERT_EQ(records[0].handle() == alarm, true);
+        ASSERT_EQ(records[1].alarm, AlarmJournal::NO_ALARM);
+        ASSERT_EQ((bool)records[1].handle(), false);
+    }
+    // Read back from the file, and continued when reopened with the same capacity
+    std::vector<AlarmJournalRecord> records;
+    ASSERT_EQ(AlarmJournal::read(path, records), true);
+    ASSERT_EQ(records.size(), 2);
+    {
+        AlarmJournal journal(path, 8);
+        journal.append(AlarmJournalEvent::STOP, at(30), 2, AlarmHandle(), 0);
+        ASSERT_EQ(journal.records().size(), 3);
+        ASSERT_EQ(journal.records()[2].sequence, 3);
+    }
+    // Reset when reopened with another capacity
+    {
+        AlarmJournal journal(path, 4);
+        ASSERT_EQ(journal.records().size(), 0);
+    }
+    std::remove(path.c_str());
+
+    ASSERT_EQ(AlarmJournal::read(path, records), false);
+    ASSERT_EQ(records.size(), 0);
+}
+
+TEST(alarm_journal, rolling){
+    const std::string path = "alarm_journal_rolling.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    AlarmJournal journal(path, 4);
+    ASSERT_EQ(journal.isOpen(), true);
+    for(unsigned int i=0;i<10;i++) journal.append(AlarmJournalEvent::EDGE, at(i), 0, AlarmHandle(), i % 2);
+
+    // The 4 latest records are kept, in order
+    std::vector<AlarmJournalRecord> records = journal.records();
+    ASSERT_EQ(records.size(), 4);
+    for(unsigned int i=0;i<4;i++){
+        ASSERT_EQ(records[i].sequence, 7 + i);
+        ASSERT_EQ(records[i].time, (6 + i) * 1000000);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, concurrent_append){
+    const std::string path = "alarm_journal_concurrent.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    static const unsigned int THREADS = 4;
+    static const unsigned int APPENDS = 10000;
+    AlarmJournal journal(path, THREADS * APPENDS);
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<THREADS;t++){
+        threads.emplace_back([&journal, t](){
+            for(unsigned int i=0;i<APPENDS;i++) journal.append(AlarmJournalEvent::EDGE, at(i), t, AlarmHandle(), 1, i);
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+
+    // Every record is committed once, and the records of a zone are in order
+    std::vector<AlarmJournalRecord> records = journal.records();
+    ASSERT_EQ(records.size(), THREADS * APPENDS);
+    std::vector<std::uint32_t> next(THREADS, 0);
+    for(const AlarmJournalRecord& record : records){
+        ASSERT_LT(record.zone, THREADS);
+        ASSERT_EQ(record.other, next[record.zone]++);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, contended_slots){
+    const std::string path = "alarm_journal_contended.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    static const unsigned int THREADS = 4;
+    static const unsigned int APPENDS = 20000;
+    AlarmJournal journal(path, 2); // Writers a ring apart keep contending for the same slot
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<THREADS;t++){
+        threads.emplace_back([&journal, t](){
+            AlarmHandle alarm;
+            for(unsigned int i=0;i<APPENDS;i++){
+                alarm.index = t;
+                alarm.generation = i;
+                journal.append(AlarmJournalEvent::EDGE, at(i), t, alarm, t, i);
+            }
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+
+    // Every kept record is written by a single writer, the skipped ones are counted
+    std::vector<AlarmJournalRecord> records = journal.records();
+    ASSERT_LE(records.size(), 2);
+    for(const AlarmJournalRecord& record : records){
+        ASSERT_EQ(record.alarm, record.zone);
+        ASSERT_EQ(record.value, record.zone);
+        ASSERT_EQ(record.generation, record.other);
+        ASSERT_EQ(record.time, record.other * 1000000ll);
+    }
+    ASSERT_LE(journal.dropped(), THREADS * APPENDS);
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, reopen_after_reboot){
+    const std::string path = "alarm_journal_reboot.alj";
+    std::remove(path.c_str());
+    {
+        AlarmJournal journal(path, 4);
+        journal.append(AlarmJournalEvent::EDGE, at(10), 0, AlarmHandle(), 1);
+        journal.append(AlarmJournalEvent::EDGE, at(20), 0, AlarmHandle(), 0);
+    }
+    // A writer crashed while writing the third record of the same boot
+    AlarmJournalHeader header;
+    AlarmJournalRecord busy;
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        std::memset(&busy, 0, sizeof(busy));
+        busy.sequence = AlarmJournal::BUSY;
+        file.seekp(sizeof(header) + 2 * sizeof(busy));
+        file.write(reinterpret_cast<const char*>(&busy), sizeof(busy));
+    }
+    {
+        AlarmJournal journal(path, 4);
+        ASSERT_EQ(journal.records().size(), 2);
+        journal.append(AlarmJournalEvent::EDGE, at(30), 0, AlarmHandle(), 1);
+        ASSERT_EQ(journal.records().size(), 3); // The slot left busy is written again
+        ASSERT_EQ(journal.dropped(), 0);
+    }
+    // Reopened in another boot, the times of its clock restarted: the journal is reset
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        header.boot[0] ^= 1;
+        file.seekp(offsetof(AlarmJournalHeader, boot));
+        file.write(reinterpret_cast<const char*>(header.boot), sizeof(header.boot));
+    }
+    std::vector<AlarmJournalRecord> records;
+    ASSERT_EQ(AlarmJournal::read(path, records), true); // Still readable until reopened
+    ASSERT_EQ(records.size(), 3);
+    {
+        AlarmJournal journal(path, 4);
+        ASSERT_EQ(journal.records().size(), 0);
+        journal.append(AlarmJournalEvent::EDGE, at(5), 0, AlarmHandle(), 1);
+        ASSERT_EQ(journal.records().front().sequence, 1);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, no_allocation){
+    const std::string path = "alarm_journal_allocation.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    AlarmJournal journal(path, 16);
+    unsigned long before = heapAllocations();
+    for(unsigned int i=0;i<100;i++) journal.append(AlarmJournalEvent::EDGE, at(i), 0, AlarmHandle(), 1);
+    ASSERT_EQ(heapAllocations() - before, 0);
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, player){
+    const std::string path = "alarm_journal_player.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    AlarmJournal journal(path, 256);
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    player.setJournal(&journal, 1);
+    Alarm low({AlarmTone(1000, true), AlarmTone(1000, false)}, AlarmLevel::LOW);
+    Alarm high({AlarmTone(250, true), AlarmTone(250, false)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+
+    // The high alarm preempts the low one from 1500 to 2400, then the low one is raised while silent
+    low.start();
+    clock.advanceTo(at(1500));
+    high.start();
+    clock.advanceTo(at(2400));
+    high.stop();
+    clock.advanceTo(at(2600));
+    low.setLevel(AlarmLevel::MEDIUM);
+    clock.advanceTo(at(4000));
+    low.stop();
+    clock.advance(std::chrono::milliseconds(0));
+    player.setJournal(nullptr);
+
+    std::vector<AlarmJournalRecord> records = journal.records();
+    ASSERT_EQ(records.front().event, AlarmJournalEvent::START);
+    ASSERT_EQ(records.front().handle() == low.getHandle(), true);
+    std::size_t starts = 0, stops = 0, levels = 0, preemptions = 0;
+    for(const AlarmJournalRecord& record : records){
+        ASSERT_EQ(record.zone, 1);
+        if(record.event == AlarmJournalEvent::START) starts++;
+        if(record.event == AlarmJournalEvent::STOP) stops++;
+        if(record.event == AlarmJournalEvent::LEVEL){
+            levels++;
+            ASSERT_EQ(record.handle() == low.getHandle(), true);
+            ASSERT_EQ(record.value, (std::uint8_t)AlarmLevel::MEDIUM);
+        }
+        if(record.event == AlarmJournalEvent::PREEMPT){
+            preemptions++;
+            ASSERT_EQ(record.handle() == low.getHandle(), true);
+            ASSERT_EQ(record.other, high.getHandle().index);
+            ASSERT_EQ(elapsed(std::chrono::nanoseconds(record.time)), 1500);
+        }
+    }
+    ASSERT_EQ(starts, 2);
+    ASSERT_EQ(stops, 2);
+    ASSERT_EQ(levels, 1);
+    ASSERT_EQ(preemptions, 1);
+
+    // The journaled edges are the ones received by the sink
+    std::vector<AlarmEdge> edges = AlarmJournal::edges(records, 1);
+    std::vector<AlarmEdge> received = output.getEdges();
+    ASSERT_EQ(edges.size(), received.size());
+    for(std::size_t i=0;i<edges.size();i++){
+        ASSERT_EQ(edges[i].time == received[i].time, true);
+        ASSERT_EQ(edges[i].noisy, received[i].noisy);
+    }
+    ASSERT_EQ(AlarmJournal::edges(records, 0).size(), 0);
+
+    // Beeps are attributed to the alarm audible at the time
+    std::vector<AlarmJournalSpan> spans = AlarmJournal::audible(records, 1);
+    ASSERT_EQ(spans.size(), 4);
+    ASSERT_EQ(spans[0].alarm == low.getHandle(), true);
+    ASSERT_EQ(elapsed(spans[0].start), 0);
+    ASSERT_EQ(elapsed(spans[0].end), 1000);
+    for(unsigned int i=1;i<3;i++){
+        ASSERT_EQ(spans[i].alarm == high.getHandle(), true);
+        ASSERT_EQ(spans[i].level, AlarmLevel::HIGH);
+        ASSERT_EQ(elapsed(spans[i].start), 1500 + (i - 1) * 500);
+        ASSERT_EQ(elapsed(spans[i].end), 1750 + (i - 1) * 500);
+    }
+    ASSERT_EQ(spans[3].alarm == low.getHandle(), true);
+    ASSERT_EQ(spans[3].level, AlarmLevel::MEDIUM);
+    ASSERT_EQ(elapsed(spans[3].start), 2900); // Resumed at 2400, 500ms before the end of its silence
+    ASSERT_EQ(elapsed(spans[3].end), 3900);
+    std::remove(path.c_str());
+}
+
+TEST(alarm_journal, replay){
+    const std::string path = "alarm_journal_replay.alj";
+    std::remove(path.c_str()); // A journal of the same capacity would be continued
+    AlarmJournal journal(path, 256);
+    std::vector<AlarmTone> lowTones = {AlarmTone(1000, true), AlarmTone(1000, false)};
+    std::vector<AlarmTone> highTones = {AlarmTone(250, true), AlarmTone(250, false)};
+    std::vector<AlarmEdge> played;
+    AlarmHandle lowHandle, highHandle;
+    {
+        AlarmManualClock clock;
+        clock.advanceTo(at(10000)); // The replay starts from its own time
+        AlarmScheduler scheduler(clock);
+        AlarmRecorderSink output;
+        AlarmPlayer player(output, scheduler);
+        player.setJournal(&journal);
+        Alarm low(lowTones, AlarmLevel::LOW);
+        Alarm high(highTones, AlarmLevel::HIGH);
+        low.setPlayer(player);
+        high.setPlayer(player);
+        lowHandle = low.getHandle();
+        highHandle = high.getHandle();
+        low.start();
+        clock.advanceTo(at(11200));
+        high.start();
+        clock.advanceTo(at(11900));
+        high.setLevel(AlarmLevel::LOW);
+        clock.advanceTo(at(13300));
+        low.stop();
+        clock.advanceTo(at(13600));
+        high.stop();
+        clock.advance(std::chrono::milliseconds(0));
+        player.setJournal(nullptr);
+        played = output.getEdges();
+    }
+
+    // Replayed on other alarms and another player, the playback is the same
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm low(lowTones, AlarmLevel::MEDIUM);
+    Alarm high(highTones, AlarmLevel::MEDIUM);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    AlarmJournal::replay(journal.records(), 0, clock, [&](AlarmHandle handle) -> Alarm* {
+        if(handle == lowHandle) return &low;
+        if(handle == highHandle) return &high;
+        return nullptr;
+    });
+    ASSERT_EQ(player.isPlaying(), false);
+    ASSERT_EQ(output.getText(), "X_X_X_XX_X_");
+    ASSERT_EQ(relative(output.getEdges()), relative(played));
+    ASSERT_EQ(relative(AlarmJournal::edges(journal.records(), 0)), relative(played));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <AlarmMetrics.h>
+#include <mutex>
+#include <sstream>
+
+TEST(alarm_metrics, histogram){
+    AlarmHistogram histogram;
+    for(std::uint64_t value : {0, 1, 2, 3, 1000}) histogram.record(value);
+    AlarmHistogramSnapshot snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.count, 5);
+    ASSERT_EQ(snapshot.counts[0], 1);
+    ASSERT_EQ(snapshot.counts[1], 1);
+    ASSERT_EQ(snapshot.counts[2], 2); // 2 and 3
+    ASSERT_EQ(snapshot.counts[10], 1); // 512 to 1023
+    ASSERT_EQ(snapshot.max, 1000);
+    ASSERT_EQ(snapshot.mean(), 1006. / 5);
+    ASSERT_EQ(snapshot.percentile(50), 3); // Upper bound of the bucket
+    ASSERT_EQ(snapshot.percentile(100), 1000); // Never above the max
+    ASSERT_EQ(histogram.snapshot(2).max, 2000);
+
+    histogram.reset();
+    ASSERT_EQ(histogram.snapshot().count, 0);
+    ASSERT_EQ(histogram.snapshot().percentile(50), 0);
+}
+
+TEST(alarm_metrics, stopwatch){
+    std::uint64_t start = AlarmStopwatch::ticks();
+    ASSERT_GT(AlarmStopwatch::nanosecondsPerTick(), 0);
+    ASSERT_GE(AlarmStopwatch::ticks(), start);
+}
+
+TEST(alarm_metrics, lock_sampling){
+    std::mutex mutex;
+    AlarmHistogram wait, hold;
+    ASSERT_EQ(AlarmLockSampling::period(), AlarmLockSampling::DEFAULT_PERIOD);
+
+    // Every lock counts a wait, one out of period times its hold
+    AlarmLockSampling::setPeriod(4);
+    for(int i=0;i<100;i++) AlarmTimedLock<std::mutex> lock(mutex, wait, hold);
+    ASSERT_EQ(wait.snapshot().count, 100);
+    ASSERT_EQ(hold.snapshot().count, 25);
+
+    AlarmLockSampling::setPeriod(1);
+    for(int i=0;i<100;i++) AlarmTimedLock<std::mutex> lock(mutex, wait, hold);
+    ASSERT_EQ(hold.snapshot().count, 125);
+
+    AlarmLockSampling::setPeriod(0);
+    for(int i=0;i<100;i++) AlarmTimedLock<std::mutex> lock(mutex, wait, hold);
+    ASSERT_EQ(wait.snapshot().count, 300);
+    ASSERT_EQ(hold.snapshot().count, 125);
+
+    AlarmLockSampling::setPeriod(AlarmLockSampling::DEFAULT_PERIOD);
+}
+
+TEST(alarm_metrics, player){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm low = Alarm({AlarmTone(500, false), AlarmTone(500, true)}, AlarmLevel::LOW);
+    Alarm high = Alarm({AlarmTone(100, true)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+
+    low.start();
+    clock.advance(std::chrono::milliseconds(1200));
+    high.start(); // Preempts the LOW alarm in its silence
+    clock.advance(std::chrono::milliseconds(300));
+    high.stop();
+    clock.advance(std::chrono::milliseconds(100));
+
+    // Per-alarm counters, the virtual clock makes them exact
+    AlarmStats stats = low.getStats();
+    ASSERT_EQ(stats.audible, std::chrono::milliseconds(500));
+    ASSERT_EQ(stats.preempted, 1);
+    ASSERT_EQ(high.getStats().audible, std::chrono::milliseconds(300));
+    ASSERT_EQ(high.getStats().preempted, 0);
+    clock.advance(std::chrono::milliseconds(300)); // The LOW alarm resumed at 200ms, beeps from 1800ms
+    ASSERT_EQ(low.getStats().audible, std::chrono::milliseconds(600)); // Ongoing beep included
+
+    AlarmPlayerMetrics metrics = player.getMetrics();
+    ASSERT_EQ(metrics.preemptions, 1);
+    ASSERT_GT(metrics.updates, 0);
+    ASSERT_EQ(metrics.attachToAudible[(int)AlarmLevel::LOW].count, 1);
+    ASSERT_EQ(metrics.attachToAudible[(int)AlarmLevel::LOW].max, 500*1000*1000); // First beep after the silence
+    ASSERT_EQ(metrics.attachToAudible[(int)AlarmLevel::HIGH].count, 1);
+    ASSERT_EQ(metrics.attachToAudible[(int)AlarmLevel::HIGH].max, 0);
+    ASSERT_EQ(metrics.attachToAudible[(int)AlarmLevel::MEDIUM].count, 0);
+    ASSERT_GT(metrics.tickLateness.count, 0);
+    ASSERT_EQ(metrics.tickLateness.max, 0); // Manual clock updates are never late
+    ASSERT_GT(metrics.alarmList.wait.count, 0);
+    ASSERT_LE(metrics.alarmList.hold.count, metrics.alarmList.wait.count); // Hold times are sampled
+
+    // Sequence updates take the sequence lock of the alarm
+    unsigned long long sequenceLocks = metrics.sequence.wait.count;
+    low.addTone(AlarmTone(100, false));
+    ASSERT_EQ(player.getMetrics().sequence.wait.count, sequenceLocks + 1);
+
+    std::ostringstream text;
+    metrics.print(text);
+    ASSERT_NE(text.str().find("tick lateness"), std::string::npos);
+    ASSERT_NE(text.str().find("attach to audible HIGH"), std::string::npos);
+
+    player.resetMetrics();
+    ASSERT_EQ(player.getMetrics().updates, 0);
+    ASSERT_EQ(player.getMetrics().alarmList.hold.count, 0);
+    low.stop();
+}
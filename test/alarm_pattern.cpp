@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+
+typedef AlarmPattern<
+    AlarmBeep<250>,
+    AlarmSilence<500>,
+    AlarmBeep<250>,
+    AlarmSilence<2*1000>
+> TestPattern;
+
+// Everything is computed by the compiler
+static_assert(TestPattern::size == 4, "pattern size");
+static_assert(TestPattern::period == 3000, "pattern period");
+static_assert(TestPattern::tones[1].duration == 500 && !TestPattern::tones[1].beep, "pattern tone");
+static_assert(TestPattern::edges[0] == 250 && TestPattern::edges[1] == 750 && TestPattern::edges[3] == 3000, "pattern edges");
+
+// Periods are 64-bit like the edges of any sequence, only each tone is limited to 31 bits
+typedef AlarmPattern<
+    AlarmBeep<AlarmTone::MAX_DURATION>,
+    AlarmSilence<AlarmTone::MAX_DURATION>,
+    AlarmBeep<AlarmTone::MAX_DURATION>
+> LongPattern;
+static_assert(LongPattern::period == 3ull * AlarmTone::MAX_DURATION, "long pattern period");
+
+TEST(alarm_pattern, sequence){
+    AlarmSequence::Ptr sequence = TestPattern::sequence();
+    ASSERT_EQ(sequence->size(), 4);
+    ASSERT_EQ(sequence->duration(), 3000);
+    ASSERT_EQ(sequence->edge(2), 1000);
+    ASSERT_EQ((*sequence)[0].beep, true);
+    ASSERT_EQ((*sequence)[3].duration, 2*1000);
+    // The snapshot references the static storage, it has no control block
+    ASSERT_EQ(sequence->tones(), TestPattern::tones);
+    ASSERT_EQ(sequence.use_count(), 0);
+}
+
+TEST(alarm_pattern, alarm_constructor){
+    Alarm alarm = Alarm(TestPattern::sequence(), AlarmLevel::HIGH);
+    ASSERT_EQ(alarm.getLevel(), AlarmLevel::HIGH);
+    ASSERT_EQ(alarm.getSequence().size(), 4);
+    ASSERT_EQ(alarm.getSequence().at(2).beep, true);
+    ASSERT_EQ(alarm.getSequenceSnapshot()->tones(), TestPattern::tones);
+
+    // Runtime changes still work on top of a pattern
+    alarm.addTone(AlarmTone(100, true));
+    ASSERT_EQ(alarm.getSequence().size(), 5);
+    ASSERT_EQ(alarm.getSequenceSnapshot()->duration(), 3100);
+    alarm.setSequence(TestPattern::sequence());
+    ASSERT_EQ(alarm.getSequence().size(), 4);
+}
+
+TEST(alarm_pattern, long_period){
+    AlarmSequence::Ptr sequence = LongPattern::sequence();
+    ASSERT_EQ(sequence->duration(), 3ull * AlarmTone::MAX_DURATION);
+    ASSERT_EQ(sequence->indexAt(0xFFFFFFFFull), 2);
+    ASSERT_EQ(sequence->toneAt(0xFFFFFFFFull).beep, true);
+    ASSERT_EQ(sequence->indexAt(2ull * AlarmTone::MAX_DURATION - 1), 1);
+}
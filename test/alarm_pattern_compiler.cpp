@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmPatternCompiler.h>
+#include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include "CountingAllocator.h"
+#include <random>
+
+// Reference expansion of a compressed sequence, checking every lookup against the flat snapshot of its tones
+static void expectExpanded(const AlarmSequence& sequence, const std::vector<AlarmTone>& expected){
+    AlarmSequence::Ptr flat = AlarmSequence::create(expected);
+    ASSERT_EQ(sequence.size(), flat->size());
+    ASSERT_EQ(sequence.duration(), flat->duration());
+    for(std::size_t i=0;i<flat->size();i++){
+        ASSERT_EQ(sequence[i].duration, (*flat)[i].duration) << "tone " << i;
+        ASSERT_EQ(sequence[i].beep, (*flat)[i].beep) << "tone " << i;
+        ASSERT_EQ(sequence.edge(i), flat->edge(i)) << "tone " << i;
+    }
+    for(unsigned long long position=0;position<flat->duration();position+=(flat->duration() / 997) + 1){
+        ASSERT_EQ(sequence.indexAt(position), flat->indexAt(position)) << "position " << position;
+    }
+    if(flat->size()){
+        ASSERT_EQ(sequence.indexAt(flat->edge(0)), flat->indexAt(flat->edge(0)));
+    }
+}
+
+TEST(alarm_pattern_compiler, compile){
+    // Without repetition, a flat sequence
+    AlarmSequence::Ptr flat = AlarmPatternCompiler::compile("250X 500_ (250X)\t2000_");
+    ASSERT_NE(flat, nullptr);
+    ASSERT_FALSE(flat->isCompressed());
+    expectExpanded(*flat, {AlarmTone(250, true), AlarmTone(500, false), AlarmTone(250, true), AlarmTone(2000, false)});
+
+    // Repetitions are not expanded
+    AlarmSequence::Ptr high = AlarmPatternCompiler::compile("(250X 500_)x4 250X 2000_");
+    ASSERT_NE(high, nullptr);
+    ASSERT_TRUE(high->isCompressed());
+    std::vector<AlarmTone> expected;
+    for(int i=0;i<4;i++){
+        expected.push_back(AlarmTone(250, true));
+        expected.push_back(AlarmTone(500, false));
+    }
+    expected.push_back(AlarmTone(250, true));
+    expected.push_back(AlarmTone(2000, false));
+    expectExpanded(*high, expected);
+    ASSERT_EQ(high->toVector().size(), 10);
+
+    // Nested groups, a single repeated group as root, and uniform durations looked up directly
+    AlarmSequence::Ptr nested = AlarmPatternCompiler::compile("((100X 100_)x3 100_)x2");
+    ASSERT_NE(nested, nullptr);
+    expected.clear();
+    for(int i=0;i<2;i++){
+        for(int j=0;j<3;j++){
+            expected.push_back(AlarmTone(100, true));
+            expected.push_back(AlarmTone(100, false));
+        }
+        expected.push_back(AlarmTone(100, false));
+    }
+    expectExpanded(*nested, expected);
+
+    // A billion tones from a few nodes
+    AlarmSequence::Ptr huge = AlarmPatternCompiler::compile("((((1X 1_)x1000)x1000)x500 5000_)");
+    ASSERT_NE(huge, nullptr);
+    ASSERT_EQ(huge->size(), 1000000001);
+    ASSERT_EQ(huge->duration(), 1000000000 + 5000);
+    ASSERT_EQ(huge->indexAt(999999999), 999999999);
+    ASSERT_EQ((*huge)[1000000000].duration, 5000);
+    ASSERT_EQ(huge->edge(1000000000), 1000005000);
+    ASSERT_EQ(huge->indexAt(1000004999), 1000000000);
+
+    // Nothing to play
+    ASSERT_EQ(AlarmPatternCompiler::compile(" ()x3 "), AlarmSequence::empty());
+    ASSERT_EQ(AlarmPatternCompiler::compile(""), AlarmSequence::empty());
+}
+
+TEST(alarm_pattern_compiler, errors){
+    struct Case { const char* text; std::size_t position; };
+    const Case cases[] = {
+        {"250", 3}, {"250Y", 3}, {"X", 0}, {"0X", 0}, {"99999999999X", 0},
+        {"(250X", 0}, {"250X)", 4}, {"(250X)x", 7}, {"(250X)x0", 7}, {"(250X)x99999999999", 7},
+        {"((((1X)x65536)x65536))", 13}, {"250X ;", 5},
+    };
+    for(const Case& test : cases){
+        AlarmPatternError error;
+        ASSERT_EQ(AlarmPatternCompiler::compile(test.text, &error), nullptr) << test.text;
+        ASSERT_NE(error.message, nullptr) << test.text;
+        ASSERT_EQ(error.position, test.position) << test.text << ": " << error.message;
+    }
+    std::string deep = std::string(AlarmPatternCompiler::MAX_DEPTH, '(') + "1X" + std::string(AlarmPatternCompiler::MAX_DEPTH, ')');
+    ASSERT_NE(AlarmPatternCompiler::compile(deep), nullptr);
+    ASSERT_EQ(AlarmPatternCompiler::compile("(" + deep + ")"), nullptr);
+}
+
+TEST(alarm_pattern_compiler, allocations){
+    const char* pattern = "(250X 500_)x4 250X 2000_";
+    AlarmPatternCompiler::compile(pattern); // Warms the buffers of the thread up
+    unsigned long before = heapAllocations();
+    AlarmSequence::Ptr sequence = AlarmPatternCompiler::compile(pattern);
+    ASSERT_EQ(heapAllocations() - before, 2); // The snapshot and its nodes
+    before = heapAllocations();
+    for(int i=0;i<100;i++) sequence->indexAt(i * 37);
+    ASSERT_EQ(heapAllocations() - before, 0);
+}
+
+TEST(alarm_pattern_compiler, play){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm(AlarmPatternCompiler::compile("(100X 100_)x2 300_"), AlarmLevel::HIGH);
+    alarm.setPlayer(player);
+    alarm.start();
+    clock.advance(std::chrono::milliseconds(1000));
+    alarm.stop();
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(output.getText(), "X_X__X_X_"); // A cycle lasts 700ms
+}
+
+// Random texts over the alphabet of the language: the compiler never crashes, and the valid ones
+// are compiled to the same tones as a naive recursive expansion
+static bool expand(const std::string& text, std::size_t& i, std::vector<AlarmTone>& tones, unsigned int depth){
+    while(i < text.size()){
+        char c = text[i];
+        if(c == ' ') i++;
+        else if(c >= '0' && c <= '9'){
+            unsigned long long duration = 0;
+            while(i < text.size() && text[i] >= '0' && text[i] <= '9'){
+                duration = duration * 10 + (text[i++] - '0');
+                if(duration > AlarmTone::MAX_DURATION) return false;
+            }
+            if(i == text.size() || (text[i] != 'X' && text[i] != '_') || !duration) return false;
+            tones.push_back(AlarmTone((unsigned int)duration, text[i++] == 'X'));
+        }
+        else if(c == '('){
+            if(depth == AlarmPatternCompiler::MAX_DEPTH) return false;
+            std::vector<AlarmTone> group;
+            if(!expand(text, ++i, group, depth + 1) || i == text.size()) return false;
+            i++; // ')'
+            unsigned long long repeat = 1;
+            if(i < text.size() && text[i] == 'x'){
+                std::size_t begin = ++i;
+                repeat = 0;
+                while(i < text.size() && text[i] >= '0' && text[i] <= '9'){
+                    repeat = repeat * 10 + (text[i++] - '0');
+                    if(repeat > 0xFFFFFFFFull) return false;
+                }
+                if(i == begin || !repeat) return false;
+            }
+            if(tones.size() + group.size() * repeat > 100000) return false; // Out of the generated range
+            for(unsigned long long r=0;r<repeat;r++) tones.insert(tones.end(), group.begin(), group.end());
+        }
+        else if(c == ')') return depth > 0;
+        else return false;
+    }
+    return depth == 0;
+}
+
+TEST(alarm_pattern_compiler, fuzz){
+    static const char alphabet[] = "0123456789X_()x ";
+    std::mt19937 random(2020);
+    unsigned int valid = 0;
+    for(int iteration=0;iteration<20000;iteration++){
+        std::string text;
+        std::size_t length = random() % 24;
+        for(std::size_t i=0;i<length;i++) text += alphabet[random() % (sizeof(alphabet) - 1)];
+        // Also derive well-formed texts, which random characters rarely are
+        if(iteration % 2){
+            text.clear();
+            int open = 0;
+            for(std::size_t i=0;i<length;i++){
+                unsigned int choice = random() % 4;
+                if(choice == 0 && open < 4){ text += "("; open++; }
+                else if(choice == 1 && open){ text += ")x" + std::to_string(1 + random() % 4); open--; }
+                else text += std::to_string(1 + random() % 50) + (random() % 2 ? "X " : "_ ");
+            }
+            while(open--) text += ")";
+        }
+
+        AlarmPatternError error;
+        AlarmSequence::Ptr sequence = AlarmPatternCompiler::compile(text, &error);
+        std::vector<AlarmTone> expected;
+        std::size_t i = 0;
+        bool expandable = expand(text, i, expected, 0);
+        if(!sequence){
+            ASSERT_NE(error.message, nullptr) << text;
+            ASSERT_LE(error.position, text.size()) << text;
+            ASSERT_FALSE(expandable) << text;
+            continue;
+        }
+        if(!expandable) continue; // Too large for the reference
+        valid++;
+        expectExpanded(*sequence, expected);
+        if(::testing::Test::HasFatalFailure()){
+            FAIL() << text;
+        }
+    }
+    ASSERT_GT(valid, 5000);
+}
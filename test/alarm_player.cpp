@@ -1,6 +1,18 @@
 #include "gtest/gtest.h"
 #include <Alarm.h>
 #include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <sstream>
+#include <cerrno>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+// Milliseconds elapsed between the start of the clock and an edge
+static long long elapsed(const AlarmEdge& edge){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(edge.time.time_since_epoch()).count();
+}
 
 TEST(alarm_player, no_alarm){
     AlarmPlayer& player = AlarmPlayer::Instance();
@@ -9,60 +21,74 @@ TEST(alarm_player, no_alarm){
 }
 
 TEST(alarm_player, play_alarm){
-    std::cout << '\r'; //prepare test output for cleanup
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
     Alarm alarm = Alarm({
         AlarmTone(1*1000, true),
         AlarmTone(1*1000, false)} ,
         AlarmLevel::LOW
     );
-    AlarmPlayer& player = AlarmPlayer::Instance();
+    alarm.setPlayer(player);
     ASSERT_EQ(player.isPlaying(), false);
 
     // Start the alarm
     alarm.start();
     ASSERT_EQ(player.isPlaying(), true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarm started to ring
+    clock.advance(std::chrono::milliseconds(500));
 
     // Monitor noise for 2 cycles
     for(unsigned int i=0;i<2;i++){
         ASSERT_EQ(player.isNoisy(), true);
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        clock.advance(std::chrono::milliseconds(1000));
         ASSERT_EQ(player.isNoisy(), false);
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        clock.advance(std::chrono::milliseconds(1000));
     }
 
     // Stop the alarm
     ASSERT_EQ(player.isPlaying(), true);
     alarm.stop();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarm stopped
+    clock.advance(std::chrono::milliseconds(0));
     ASSERT_EQ(player.isPlaying(), false);
     ASSERT_EQ(player.isNoisy(), false);
-    std::cout << '\r'; // Clean test output
+
+    // Edges are played at the exact time of the virtual clock
+    ASSERT_EQ(output.getText(), "X_X_X_");
+    std::vector<AlarmEdge> edges = output.getEdges();
+    for(unsigned int i=0;i<5;i++) ASSERT_EQ(elapsed(edges[i]), i*1000);
+    ASSERT_EQ(elapsed(edges[5]), 4500);
+    ASSERT_EQ(scheduler.isRunning(), false); // No thread with a manual clock
 }
 
 
 
 TEST(alarm_player, play_empty_alarm){
-    std::cout << '\r'; //prepare test output for cleanup
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
     Alarm alarm = Alarm(AlarmLevel::LOW);
-    AlarmPlayer& player = AlarmPlayer::Instance();
+    alarm.setPlayer(player);
     ASSERT_EQ(player.isPlaying(), false);
 
     // Start the alarm
     alarm.start();
     ASSERT_EQ(player.isPlaying(), true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarm started to ring
+    clock.advance(std::chrono::milliseconds(500));
     ASSERT_EQ(player.isNoisy(), false);
     ASSERT_EQ(player.isPlaying(), true);
     alarm.stop();
     ASSERT_EQ(player.isPlaying(), false);
-    std::cout << '\r'; // Clean test output
 }
 
 
 
 TEST(alarm_player, alarm_level){
-    std::cout << '\r'; //prepare test output for cleanup
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
     Alarm alarm_low = Alarm({
         AlarmTone(5*1000, false)} ,
         AlarmLevel::LOW
@@ -71,20 +97,21 @@ TEST(alarm_player, alarm_level){
         AlarmTone(5*1000, true)} ,
         AlarmLevel::HIGH
     );
-    AlarmPlayer& player = AlarmPlayer::Instance();
+    alarm_low.setPlayer(player);
+    alarm_high.setPlayer(player);
     ASSERT_EQ(player.isPlaying(), false);
 
     // Start the alarm, HIGH first
     alarm_low.start();
     alarm_high.start();
     ASSERT_EQ(player.isPlaying(), true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarms started to ring
+    clock.advance(std::chrono::milliseconds(500));
     //If priority level is working, noise should be emitted
     ASSERT_EQ(player.isNoisy(), true);
     ASSERT_EQ(player.isPlaying(), true);
     alarm_low.stop();
     alarm_high.stop();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarms stopped
+    clock.advance(std::chrono::milliseconds(500));
     ASSERT_EQ(player.isPlaying(), false);
     ASSERT_EQ(player.isNoisy(), false);
 
@@ -92,14 +119,677 @@ TEST(alarm_player, alarm_level){
     alarm_low.start();
     alarm_high.start();
     ASSERT_EQ(player.isPlaying(), true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarms started to ring
+    clock.advance(std::chrono::milliseconds(500));
     //If priority level is working, noise should be emitted
     ASSERT_EQ(player.isNoisy(), true);
     ASSERT_EQ(player.isPlaying(), true);
     alarm_low.stop();
     alarm_high.stop();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); //Make sure alarms stopped
+    clock.advance(std::chrono::milliseconds(500));
+    ASSERT_EQ(player.isPlaying(), false);
+    ASSERT_EQ(player.isNoisy(), false);
+}
+
+
+TEST(alarm_player, edge_drift){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    // Short tones used to be impossible with the fixed 250ms playback rate
+    Alarm alarm = Alarm({
+        AlarmTone(40, true),
+        AlarmTone(60, false)} ,
+        AlarmLevel::LOW
+    );
+    alarm.setPlayer(player);
+
+    // Play 10 cycles, stepping the clock irregularly so late updates would show
+    alarm.start();
+    for(unsigned int i=0;i<340;i++) clock.advance(std::chrono::milliseconds(3));
+    alarm.stop();
+    std::vector<AlarmEdge> edges = output.getEdges();
+    ASSERT_EQ(edges.size(), 21);
+
+    // Every edge is exactly on time, relative to the first edge so drift would accumulate
+    for(unsigned int i=1;i<edges.size();i++){
+        ASSERT_EQ(elapsed(edges.at(i)) - elapsed(edges.at(0)), (i/2)*100 + (i%2)*40);
+    }
     ASSERT_EQ(player.isPlaying(), false);
+}
+
+
+
+TEST(alarm_player, start_position){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm({
+        AlarmTone(1*1000, true),
+        AlarmTone(1*1000, false)} ,
+        AlarmLevel::LOW
+    );
+    alarm.setPlayer(player);
+
+    // Start in the middle of the silence
+    alarm.start(std::chrono::milliseconds(1500));
+    clock.advance(std::chrono::milliseconds(100));
+    ASSERT_EQ(player.isNoisy(), false);
+    ASSERT_EQ(alarm.getPosition().count(), 1600);
+    clock.advance(std::chrono::milliseconds(500)); //Sequence wrapped to the beep
+    ASSERT_EQ(player.isNoisy(), true);
+
+    // Fast-forward to the silence
+    alarm.seek(alarm.getPosition() + std::chrono::milliseconds(1000));
+    clock.advance(std::chrono::milliseconds(50));
+    ASSERT_EQ(player.isNoisy(), false);
+    ASSERT_EQ(alarm.getPosition().count(), 1150);
+
+    // Align another alarm on the first one
+    Alarm other = Alarm({
+        AlarmTone(1*1000, true),
+        AlarmTone(1*1000, false)} ,
+        AlarmLevel::LOW
+    );
+    other.setPlayer(player);
+    other.start();
+    other.syncWith(alarm);
+    ASSERT_EQ(other.getPosition().count(), alarm.getPosition().count());
+    other.stop();
+    alarm.stop();
+    ASSERT_EQ(alarm.getPosition().count(), 0);
+    clock.advance(std::chrono::milliseconds(50));
     ASSERT_EQ(player.isNoisy(), false);
-    std::cout << '\r'; // Clean test output
-}
\ No newline at end of file
+}
+
+
+
+TEST(alarm_player, lazy_thread){
+    std::ostringstream output;
+    AlarmScheduler scheduler;
+    AlarmPlayer player(output, scheduler);
+    ASSERT_EQ(player.isRunning(), false);
+
+    Alarm alarm = Alarm({AlarmTone(1*1000, true)}, AlarmLevel::LOW);
+    alarm.setPlayer(player);
+    ASSERT_EQ(&alarm.getPlayer(), &player);
+    ASSERT_EQ(player.isRunning(), false); // Binding doesn't start the thread
+
+    alarm.start();
+    ASSERT_EQ(player.isRunning(), true);
+    alarm.stop();
+}
+
+
+
+TEST(alarm_player, multiple_players){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    std::ostringstream output_a, output_b;
+    AlarmPlayer player_a(output_a, scheduler);
+    AlarmPlayer player_b(output_b, scheduler);
+    Alarm alarm_low = Alarm({AlarmTone(5*1000, true)}, AlarmLevel::LOW);
+    Alarm alarm_high = Alarm({AlarmTone(5*1000, false)}, AlarmLevel::HIGH);
+    alarm_low.setPlayer(player_a);
+    alarm_high.setPlayer(player_b);
+
+    // Each player resolves priority among its own alarms: the HIGH alarm doesn't mute the LOW one
+    alarm_low.start();
+    alarm_high.start();
+    clock.advance(std::chrono::milliseconds(200));
+    ASSERT_EQ(player_a.isNoisy(), true);
+    ASSERT_EQ(player_b.isNoisy(), false);
+    ASSERT_EQ(AlarmPlayer::Instance().isPlaying(), false);
+    ASSERT_EQ(output_a.str(), "X\a");
+    ASSERT_EQ(output_b.str(), "_");
+
+    // Binding a started alarm moves its playback to the new player
+    alarm_low.setPlayer(player_b);
+    ASSERT_EQ(alarm_low.isStarted(), true);
+    ASSERT_EQ(player_a.isPlaying(), false);
+    clock.advance(std::chrono::milliseconds(200));
+    ASSERT_EQ(player_a.isNoisy(), false);
+    ASSERT_EQ(player_b.isNoisy(), false); // The HIGH alarm keeps priority
+    alarm_high.stop();
+    clock.advance(std::chrono::milliseconds(200));
+    ASSERT_EQ(player_b.isNoisy(), true);
+    alarm_low.stop();
+}
+
+
+
+TEST(alarm_player, simulated_day){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    unsigned long long beeps = 0, silences = 0;
+    AlarmCallbackSink output([&](const AlarmEdge& edge){ (edge.noisy ? beeps : silences)++; });
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm({AlarmTone(250, true), AlarmTone(750, false)}, AlarmLevel::MEDIUM);
+    alarm.setPlayer(player);
+
+    // A day of playback takes no longer than processing its edges
+    alarm.start();
+    clock.advance(std::chrono::hours(24));
+    ASSERT_EQ(beeps, 24*3600 + 1);
+    ASSERT_EQ(silences, 24*3600);
+    ASSERT_EQ(alarm.getPosition().count(), 0);
+    alarm.stop();
+}
+
+
+
+TEST(alarm_player, apply){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    AlarmPlayer other(output, scheduler);
+    Alarm low = Alarm({AlarmTone(1000, true)}, AlarmLevel::LOW);
+    Alarm medium = Alarm({AlarmTone(1000, true)}, AlarmLevel::MEDIUM);
+    Alarm high = Alarm({AlarmTone(1000, false)}, AlarmLevel::HIGH);
+    Alarm foreign = Alarm({AlarmTone(1000, true)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    medium.setPlayer(player);
+    high.setPlayer(player);
+    foreign.setPlayer(other);
+
+    player.apply({AlarmChange::start(low), AlarmChange::start(medium), AlarmChange::start(foreign)});
+    ASSERT_EQ(low.isStarted(), true);
+    ASSERT_EQ(medium.isStarted(), true);
+    ASSERT_EQ(foreign.isStarted(), false); // Bound to another player
+    clock.advance(std::chrono::milliseconds(100));
+    ASSERT_EQ(output.getText(), "X");
+
+    // The batch is seen at once: the MEDIUM alarm stops and the HIGH one takes over in a single decision
+    unsigned long long updates = player.getMetrics().updates;
+    player.apply({AlarmChange::stop(medium), AlarmChange::start(high), AlarmChange::setLevel(low, AlarmLevel::MEDIUM)});
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(player.getMetrics().updates, updates + 1);
+    ASSERT_EQ(output.getText(), "X_");
+    ASSERT_EQ(medium.isStarted(), false);
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+
+    // Lowering the HIGH alarm below the others gives the priority back to the former LOW one
+    player.apply({AlarmChange::setLevel(high, AlarmLevel::LOW)});
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(output.getText(), "X_X");
+    ASSERT_EQ(player.isNoisy(), true);
+
+    // Empty or ineffective batches don't update the player
+    updates = player.getMetrics().updates;
+    player.apply(std::vector<AlarmChange>());
+    player.apply({AlarmChange::start(low), AlarmChange::stop(medium)});
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(player.getMetrics().updates, updates);
+
+    player.apply({AlarmChange::stop(low), AlarmChange::stop(high)});
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(player.isPlaying(), false);
+    ASSERT_EQ(output.getText(), "X_X_");
+}
+
+
+
+TEST(alarm_player, set_level_in_place){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm low = Alarm({AlarmTone(1000, true), AlarmTone(1000, false)}, AlarmLevel::LOW);
+    Alarm medium = Alarm({AlarmTone(1000, false)}, AlarmLevel::MEDIUM);
+    low.setPlayer(player);
+    medium.setPlayer(player);
+    ASSERT_EQ(low.getState(), AlarmState::IDLE);
+
+    low.start();
+    ASSERT_EQ(low.getState(), AlarmState::STARTED);
+    clock.advance(std::chrono::milliseconds(300));
+    ASSERT_EQ(low.getState(), AlarmState::PLAYING);
+    medium.start();
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(low.getState(), AlarmState::PREEMPTED);
+    ASSERT_EQ(medium.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(low.getPosition().count(), 300);
+
+    // Raising the preempted alarm moves it above the other one, it resumes where it paused
+    low.setLevel(AlarmLevel::HIGH);
+    ASSERT_EQ(low.getLevel(), AlarmLevel::HIGH);
+    clock.advance(std::chrono::milliseconds(200));
+    ASSERT_EQ(low.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(medium.getState(), AlarmState::PREEMPTED);
+    ASSERT_EQ(low.getPosition().count(), 500);
+    ASSERT_EQ(low.getStats().preempted, 1);
+
+    // Restarting plays the sequence from its begining, at the same priority
+    low.setLevel(AlarmLevel::HIGH, true);
+    clock.advance(std::chrono::milliseconds(100));
+    ASSERT_EQ(low.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(low.getPosition().count(), 100);
+
+    // Lowering it below the other alarm pauses it, its position is kept
+    low.setLevel(AlarmLevel::LOW);
+    clock.advance(std::chrono::milliseconds(100));
+    ASSERT_EQ(low.getState(), AlarmState::PREEMPTED);
+    ASSERT_EQ(medium.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(low.getPosition().count(), 100);
+    ASSERT_EQ(output.getText(), "X_XX_");
+
+    low.stop();
+    ASSERT_EQ(low.getState(), AlarmState::IDLE);
+    medium.stop();
+}
+
+
+
+TEST(alarm_player, interleaved_arbitration){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    AlarmArbitration arbitration;
+    arbitration.policy = AlarmArbitrationPolicy::INTERLEAVED;
+    arbitration.interleave = 2;
+    player.setArbitration(arbitration);
+    ASSERT_EQ(player.getArbitration().interleave, 2);
+    Alarm high = Alarm({AlarmTone(250, true), AlarmTone(250, false)}, AlarmLevel::HIGH);
+    Alarm low = Alarm({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    high.setPlayer(player);
+    low.setPlayer(player);
+
+    // Every 2 cycles of the HIGH alarm, the LOW alarm plays one cycle from where it paused
+    player.apply({AlarmChange::start(high), AlarmChange::start(low)});
+    clock.advance(std::chrono::milliseconds(2450));
+    std::vector<AlarmEdge> edges = output.getEdges();
+    std::vector<long long> times = {0, 250, 500, 750, 1000, 1100, 1200, 1450, 1700, 1950, 2200, 2300, 2400};
+    ASSERT_EQ(edges.size(), times.size());
+    for(std::size_t i=0;i<times.size();i++){
+        ASSERT_EQ(elapsed(edges[i]), times[i]);
+        ASSERT_EQ(edges[i].noisy, i % 2 == 0);
+    }
+    ASSERT_EQ(high.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(high.getStats().preempted, 2);
+    ASSERT_EQ(low.getStats().audible, std::chrono::milliseconds(200));
+
+    // Back to strict priority, the LOW alarm is muted
+    player.setArbitration(AlarmArbitration());
+    clock.advance(std::chrono::milliseconds(2000));
+    ASSERT_EQ(low.getStats().audible, std::chrono::milliseconds(200));
+    high.stop();
+    low.stop();
+}
+
+
+
+// Beeps a number of times, each beep and silence a bit shorter than the previous ones
+class CountdownSource : public AlarmToneSource {
+public:
+    explicit CountdownSource(unsigned int beeps) : m_tones(2 * beeps) {}
+    bool next(AlarmTone& tone, std::chrono::milliseconds played) override {
+        if(!m_tones) return false;
+        playedTimes.push_back(played.count());
+        tone = AlarmTone(100 * (1 + m_tones / 2), m_tones % 2 == 0);
+        m_tones--;
+        return true;
+    }
+    std::vector<long long> playedTimes; // Played time given to each pull
+private:
+    unsigned int m_tones;
+};
+
+TEST(alarm_player, tone_source){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm low = Alarm({AlarmTone(1000, false)}, AlarmLevel::LOW);
+    Alarm alarm(AlarmLevel::MEDIUM);
+    std::shared_ptr<CountdownSource> source = std::make_shared<CountdownSource>(3);
+    alarm.setSource(source);
+    ASSERT_EQ(alarm.getSource(), source);
+    low.setPlayer(player);
+    alarm.setPlayer(player);
+    low.start();
+    alarm.start();
+
+    // Tones are pulled as they end: 400X 300_ 300X 200_ 200X 100_, edges computed without drift
+    clock.advance(std::chrono::milliseconds(450));
+    ASSERT_EQ(alarm.getPosition(), std::chrono::milliseconds(450));
+    alarm.seek(std::chrono::milliseconds(0)); // No effect on a source
+    ASSERT_EQ(alarm.getPosition(), std::chrono::milliseconds(450));
+    clock.advance(std::chrono::milliseconds(1500));
+    std::vector<long long> times = {0, 400, 700, 1000, 1200, 1400, 1500};
+    std::vector<AlarmEdge> edges = output.getEdges();
+    ASSERT_EQ(edges.size(), times.size());
+    for(std::size_t i=0;i<times.size();i++) ASSERT_EQ(elapsed(edges[i]), times[i]);
+    ASSERT_EQ(output.getText(), "X_X_X__");
+    ASSERT_EQ(source->playedTimes, std::vector<long long>({0, 400, 700, 1000, 1200, 1400}));
+
+    // Exhausted: the alarm stopped itself and the LOW alarm took over at once
+    ASSERT_FALSE(alarm.isStarted());
+    ASSERT_EQ(low.getState(), AlarmState::PLAYING);
+
+    // A sequence replaces the source
+    alarm.setSequence({AlarmTone(100, true)});
+    ASSERT_EQ(alarm.getSource(), nullptr);
+    low.stop();
+}
+
+TEST(alarm_player, escalation){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm low = Alarm({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    Alarm medium = Alarm({AlarmTone(AlarmTone::MAX_DURATION, false)}, AlarmLevel::MEDIUM);
+    low.setEscalation(AlarmEscalation({{std::chrono::minutes(15), AlarmLevel::HIGH}, {std::chrono::minutes(5), AlarmLevel::MEDIUM}}));
+    ASSERT_EQ(low.getEscalation().count, 2);
+    ASSERT_EQ(low.getEscalation().steps[0].level, AlarmLevel::MEDIUM); // Sorted by delay
+    low.setPlayer(player);
+    medium.setPlayer(player);
+    medium.start();
+    low.start();
+
+    clock.advance(std::chrono::milliseconds(5 * 60 * 1000 - 1));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::LOW);
+    clock.advance(std::chrono::milliseconds(1));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+    ASSERT_EQ(low.getState(), AlarmState::STARTED); // Queued behind the older MEDIUM alarm
+    clock.advance(std::chrono::minutes(10));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::HIGH);
+    ASSERT_EQ(low.getState(), AlarmState::PLAYING);
+    ASSERT_EQ(medium.getState(), AlarmState::PREEMPTED);
+    clock.advance(std::chrono::milliseconds(100));
+    ASSERT_EQ(output.getText(), "_X_");
+
+    // Acknowledging restores the level it started at, and its escalation counts from now
+    low.acknowledge();
+    ASSERT_EQ(low.getLevel(), AlarmLevel::LOW);
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(medium.getState(), AlarmState::PLAYING);
+    clock.advance(std::chrono::minutes(5));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+    player.apply({AlarmChange::acknowledge(low)});
+    ASSERT_EQ(low.getLevel(), AlarmLevel::LOW);
+
+    // Stopping cancels the escalation, the alarm starts again at its own level
+    clock.advance(std::chrono::minutes(5));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+    low.stop();
+    ASSERT_EQ(low.getLevel(), AlarmLevel::LOW);
+    clock.advance(std::chrono::minutes(20));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::LOW);
+    low.acknowledge(); // No effect while stopped
+    low.start();
+    clock.advance(std::chrono::minutes(5));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+
+    // A level set explicitly is the one restored, steps not raising the alarm are skipped
+    low.setLevel(AlarmLevel::HIGH);
+    clock.advance(std::chrono::minutes(10));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::HIGH);
+    low.setLevel(AlarmLevel::MEDIUM);
+    low.acknowledge();
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+    low.setEscalation(AlarmEscalation());
+    clock.advance(std::chrono::minutes(20));
+    ASSERT_EQ(low.getLevel(), AlarmLevel::MEDIUM);
+    low.stop();
+    medium.stop();
+}
+
+TEST(alarm_player, escalation_without_polling){
+    // A silent alarm escalating after 20 days, beyond the horizon of the timing wheel: the player is only woken up a few times
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm({AlarmTone(AlarmTone::MAX_DURATION, false)}, AlarmLevel::LOW);
+    alarm.setEscalation(AlarmEscalation({{std::chrono::hours(20 * 24), AlarmLevel::HIGH}}));
+    alarm.setPlayer(player);
+    alarm.start();
+    clock.advance(std::chrono::hours(20 * 24) - std::chrono::milliseconds(1));
+    ASSERT_EQ(alarm.getLevel(), AlarmLevel::LOW);
+    clock.advance(std::chrono::milliseconds(1));
+    ASSERT_EQ(alarm.getLevel(), AlarmLevel::HIGH);
+    ASSERT_LE(player.getMetrics().updates, 16); // Start, cascades of the wheels and the escalation
+
+    // Thousands of pending escalations, only the due ones are looked at
+    std::vector<Alarm> alarms;
+    for(int i=0;i<5000;i++){
+        alarms.emplace_back(std::vector<AlarmTone>({AlarmTone(AlarmTone::MAX_DURATION, false)}));
+        alarms.back().setEscalation(AlarmEscalation({{std::chrono::seconds(1 + i % 100), AlarmLevel::MEDIUM}}));
+        alarms.back().setPlayer(player);
+        alarms.back().start();
+    }
+    player.resetMetrics();
+    clock.advance(std::chrono::seconds(50) + std::chrono::milliseconds(500));
+    ASSERT_EQ(std::count_if(alarms.begin(), alarms.end(), [](Alarm& alarm){ return alarm.getLevel() == AlarmLevel::MEDIUM; }), 2500);
+    ASSERT_LE(player.getMetrics().updates, 3 * 51); // A few wake-ups per distinct deadline, whatever the number of alarms
+    alarm.stop();
+}
+
+TEST(alarm_player, preemption_latency_under_load){
+    // Players beeping every millisecond keep the scheduler busy while a HIGH alarm preempts a LOW one.
+    // Driven by a manual clock, so the count is exact: the wall-clock latency is measured by the alarm_player.preemption_under_load benchmark.
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmCallbackSink output([](const AlarmEdge&){});
+    std::vector<std::unique_ptr<AlarmPlayer>> loadPlayers;
+    std::vector<Alarm> loadAlarms;
+    for(unsigned int i=0;i<20;i++){
+        loadPlayers.emplace_back(new AlarmPlayer(output, scheduler));
+        loadAlarms.push_back(Alarm({AlarmTone(1, true), AlarmTone(1, false)}, AlarmLevel::LOW));
+        loadAlarms.back().setPlayer(*loadPlayers.back());
+        loadAlarms.back().start();
+    }
+    AlarmPlayer player(output, scheduler);
+    Alarm low = Alarm({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    Alarm high = Alarm({AlarmTone(100, false)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    low.start();
+    clock.advance(std::chrono::milliseconds(5));
+    player.resetMetrics();
+
+    for(unsigned int i=0;i<50;i++){
+        high.start();
+        clock.advance(std::chrono::milliseconds(2));
+        high.stop();
+        clock.advance(std::chrono::milliseconds(2));
+    }
+    AlarmPlayerMetrics metrics = player.getMetrics();
+    ASSERT_EQ(metrics.switchLatency.count, 100); // Every start and stop switched the played alarm
+    ASSERT_EQ(metrics.switchLatency.max, 0); // At the time of the change, ahead of the deadlines of the load
+    low.stop();
+    for(Alarm& alarm : loadAlarms) alarm.stop();
+    clock.advance(std::chrono::milliseconds(0));
+}
+
+
+
+TEST(alarm_player, realtime_fallback){
+    AlarmScheduler scheduler;
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    ASSERT_EQ(scheduler.getRealtimeStatus().scheduled, false);
+
+    // Granted or not depending on privileges, the threads are started and the alarms play either way
+    AlarmRealtimeSettings settings;
+    settings.lockMemory = false; // Process-wide, not for a test
+    settings.cpus = {0};
+    AlarmRealtimeStatus status = scheduler.setRealtime(settings);
+    ASSERT_EQ(player.isRunning(), true);
+    ASSERT_EQ(status.locked, true);
+    ASSERT_EQ(status.scheduled && status.pinned, status.error == 0);
+    ASSERT_EQ(scheduler.getRealtimeStatus().scheduled, status.scheduled);
+
+    Alarm alarm = Alarm({AlarmTone(20, true), AlarmTone(20, false)}, AlarmLevel::LOW);
+    alarm.setPlayer(player);
+    alarm.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    alarm.stop();
+    scheduler.drain();
+    ASSERT_GE(output.getEdges().size(), 5);
+    ASSERT_GT(scheduler.getWakeupLateness().count, 0);
+
+    // A refused request is reported, the scheduling is left as it was
+    settings.priority = 1000;
+    status = scheduler.setRealtime(settings);
+    ASSERT_EQ(status.scheduled, false);
+    ASSERT_EQ(status.error, EINVAL);
+    settings.policy = SCHED_OTHER;
+    ASSERT_EQ(scheduler.setRealtime(settings).scheduled, true); // Back to time sharing
+
+    // Without thread, only the memory would be locked
+    AlarmManualClock clock;
+    AlarmScheduler manual(clock);
+    status = manual.setRealtime(settings);
+    ASSERT_EQ(status.scheduled, false);
+    ASSERT_EQ(status.error, 0);
+    ASSERT_EQ(manual.isRunning(), false);
+}
+
+
+
+TEST(alarm_player, observer){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    std::vector<AlarmEvent> events;
+    AlarmCallbackObserver observer([&](const AlarmEvent& event){ events.push_back(event); });
+    player.addObserver(&observer);
+    Alarm low = Alarm({AlarmTone(1000, true), AlarmTone(1000, false)}, AlarmLevel::LOW);
+    Alarm high = Alarm({AlarmTone(250, true), AlarmTone(250, false)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    ASSERT_EQ(player.getSequence(), 0);
+    ASSERT_EQ(player.getLastEvent().sequence, 0);
+
+    low.start();
+    clock.advance(std::chrono::milliseconds(500));
+    high.start();
+    clock.advance(std::chrono::milliseconds(100));
+    high.stop();
+    low.stop();
+    clock.advance(std::chrono::milliseconds(0));
+
+    // Numbered without gap, the last one being the state of the player
+    for(std::size_t i=0;i<events.size();i++) ASSERT_EQ(events[i].sequence, i + 1);
+    ASSERT_EQ(player.getSequence(), events.size());
+    ASSERT_EQ(player.getLastEvent().sequence, events.size());
+    ASSERT_EQ(player.getLastEvent().noisy, false);
+    ASSERT_EQ(player.getLastEvent().playing, false);
+
+    std::vector<AlarmEventType> types;
+    for(const AlarmEvent& event : events) types.push_back(event.type);
+    std::vector<AlarmEventType> expected = {
+        AlarmEventType::PLAYING, AlarmEventType::ACTIVE, AlarmEventType::NOISE, // low starts beeping at 0
+        AlarmEventType::PREEMPT, AlarmEventType::ACTIVE, AlarmEventType::NOISE, // high preempts it at 500
+        AlarmEventType::PLAYING, AlarmEventType::ACTIVE, AlarmEventType::NOISE // both stopped at 600
+    };
+    ASSERT_EQ(types, expected);
+    ASSERT_EQ(events[0].playing, true);
+    ASSERT_EQ(events[1].alarm == low.getHandle(), true);
+    ASSERT_EQ(events[2].noisy, true);
+    ASSERT_EQ(events[3].alarm == low.getHandle(), true);
+    ASSERT_EQ(events[3].other == high.getHandle(), true);
+    ASSERT_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(events[3].time.time_since_epoch()).count(), 500);
+    ASSERT_EQ(events[4].alarm == high.getHandle(), true);
+    ASSERT_EQ(events[6].playing, false);
+    ASSERT_EQ((bool)events[7].alarm, false);
+    ASSERT_EQ(events[8].noisy, false);
+
+    // Noise changes are the edges of the sink
+    std::vector<AlarmEdge> edges = output.getEdges();
+    std::size_t noise = 0;
+    for(const AlarmEvent& event : events){
+        if(event.type != AlarmEventType::NOISE) continue;
+        ASSERT_EQ(event.time == edges[noise].time, true);
+        ASSERT_EQ(event.noisy, edges[noise++].noisy);
+    }
+    ASSERT_EQ(noise, edges.size());
+
+    // A removed observer is not notified anymore
+    player.removeObserver(&observer);
+    low.start();
+    clock.advance(std::chrono::milliseconds(0));
+    ASSERT_EQ(events.size(), 9);
+    ASSERT_GT(player.getSequence(), 9);
+    low.stop();
+}
+
+
+
+TEST(alarm_player, wait_for_change){
+    AlarmScheduler scheduler;
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm({AlarmTone(50, true), AlarmTone(50, false)}, AlarmLevel::LOW);
+    alarm.setPlayer(player);
+
+    // Times out without change
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ASSERT_EQ(player.waitForChange(0, std::chrono::milliseconds(20)), 0);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    // Every change reaches the observer in order, the waiter may coalesce some of them
+    std::vector<AlarmEvent> events;
+    AlarmCallbackObserver observer([&](const AlarmEvent& event){ events.push_back(event); });
+    player.addObserver(&observer);
+
+    // Returns at once if a change was missed
+    alarm.start();
+    ASSERT_GT(player.waitForChange(0, std::chrono::seconds(0)), 0);
+
+    // Follows the changes from another thread, waking up until 4 tone edges were published
+    std::vector<std::uint64_t> wakes;
+    std::thread strobe([&](){
+        std::uint64_t sequence = player.getSequence();
+        while(sequence < 6){ // Playing, active, then 4 edges
+            std::uint64_t next = player.waitForChange(sequence, std::chrono::seconds(5));
+            if(next == sequence) break; // Timed out
+            wakes.push_back(next);
+            sequence = next;
+        }
+    });
+    strobe.join();
+    player.removeObserver(&observer);
+    alarm.stop();
+
+    // Woken on changes only, with increasing sequence numbers
+    ASSERT_GT(wakes.size(), 0);
+    ASSERT_GE(wakes.back(), 6);
+    for(std::size_t i=1;i<wakes.size();i++) ASSERT_GT(wakes[i], wakes[i-1]);
+    // Observed without gap, the tone edges alternate
+    std::vector<bool> noisy;
+    for(std::size_t i=0;i<events.size();i++){
+        ASSERT_EQ(events[i].sequence, i + 1);
+        if(events[i].type == AlarmEventType::NOISE) noisy.push_back(events[i].noisy);
+    }
+    ASSERT_GE(noisy.size(), 4);
+    for(std::size_t i=1;i<noisy.size();i++) ASSERT_NE(noisy[i], noisy[i-1]);
+}
+
+TEST(alarm_player, wait_for_change_manual_clock){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+
+    // The timeout is measured on the clock of the scheduler, and doesn't expire while the clock stands still
+    std::atomic<bool> returned(false);
+    std::thread waiter([&](){
+        player.waitForChange(player.getSequence(), std::chrono::milliseconds(100));
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_EQ(returned.load(), false); // Not asserted, the waiter must be joined
+    clock.advance(std::chrono::milliseconds(99));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(returned.load(), false); // Not asserted, the waiter must be joined
+    clock.advance(std::chrono::milliseconds(1));
+    waiter.join();
+    ASSERT_EQ(returned.load(), true);
+}
@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmSink.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Wall-clock checks on the real scheduler thread, built as the separate latency_tests binary:
+// they depend on the load of the machine, so they run as their own ctest labelled 'latency'
+
+static const double SWITCH_P99_BOUND_US = 5000; /**< Bound of the p99 switch latency, well above the tens of microseconds measured on an idle machine */
+
+TEST(alarm_player_latency, preemption_under_load){
+    // Players beeping every millisecond keep the scheduler thread busy while a HIGH alarm preempts a LOW one
+    AlarmScheduler scheduler;
+    AlarmCallbackSink output([](const AlarmEdge&){});
+    std::vector<std::unique_ptr<AlarmPlayer>> loadPlayers;
+    std::vector<Alarm> loadAlarms;
+    loadAlarms.reserve(20);
+    for(unsigned int i=0;i<20;i++){
+        loadPlayers.emplace_back(new AlarmPlayer(output, scheduler));
+        loadAlarms.emplace_back(std::vector<AlarmTone>({AlarmTone(1, true), AlarmTone(1, false)}), AlarmLevel::LOW);
+        loadAlarms.back().setPlayer(*loadPlayers.back());
+        loadAlarms.back().start();
+    }
+    AlarmPlayer player(output, scheduler);
+    Alarm low({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    Alarm high({AlarmTone(100, false)}, AlarmLevel::HIGH);
+    low.setPlayer(player);
+    high.setPlayer(player);
+    low.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    player.resetMetrics();
+
+    for(unsigned int i=0;i<500;i++){
+        high.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        high.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    AlarmHistogramSnapshot latency = player.getMetrics().switchLatency;
+    low.stop();
+    for(Alarm& alarm : loadAlarms) alarm.stop();
+
+    // A late update may merge a start and its stop, which then switch nothing: most switches are still recorded
+    ASSERT_GE(latency.count, 500);
+    // The percentile is the upper bound of its bucket, never below the exact value
+    EXPECT_LT(latency.percentile(99) / 1000, SWITCH_P99_BOUND_US) << "p50 " << latency.percentile(50) / 1000 << " us, max " << latency.max / 1000 << " us";
+}
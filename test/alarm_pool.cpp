@@ -0,0 +1,152 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmPlayer.h>
+#include <AlarmPool.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include "CountingAllocator.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(alarm_pool, create_destroy){
+    AlarmPool pool;
+    AlarmHandle handle = pool.create();
+    ASSERT_TRUE((bool)handle);
+    ASSERT_EQ(pool.size(), 1);
+    ASSERT_NE(pool.get(handle), nullptr);
+    ASSERT_EQ(pool.get(handle)->level, AlarmLevel::LOW);
+    pool.destroy(handle);
+    ASSERT_EQ(pool.size(), 0);
+    ASSERT_EQ(pool.get(AlarmHandle()), nullptr);
+}
+
+TEST(alarm_pool, stale_handle){
+    AlarmPool pool;
+    AlarmHandle first = pool.create();
+    pool.get(first)->level = AlarmLevel::HIGH;
+    pool.destroy(first);
+    ASSERT_EQ(pool.get(first), nullptr);
+
+    // The slot is reused with a new generation, the previous handle stays stale
+    AlarmHandle second = pool.create();
+    ASSERT_EQ(second.index, first.index);
+    ASSERT_NE(second.generation, first.generation);
+    ASSERT_EQ(pool.get(first), nullptr);
+    ASSERT_EQ(pool.get(second)->level, AlarmLevel::LOW);
+    pool.destroy(first); // No effect on the new alarm
+    ASSERT_NE(pool.get(second), nullptr);
+    ASSERT_EQ(pool.size(), 1);
+}
+
+TEST(alarm_pool, stale_alarm_handle_in_player){
+    AlarmHandle handle;
+    {
+        Alarm alarm = Alarm({AlarmTone(100, true)});
+        handle = alarm.getHandle();
+        alarm.start();
+        ASSERT_TRUE(alarm.isStarted());
+    }
+    // The Alarm stopped itself at destruction, its handle is now stale
+    ASSERT_EQ(AlarmPool::Instance().get(handle), nullptr);
+    ASSERT_FALSE(AlarmPlayer::Instance().isPlaying());
+}
+
+TEST(alarm_pool, pin_delays_destruction){
+    AlarmPool& pool = AlarmPool::Instance();
+    AlarmHandle handle = pool.create();
+    pool.get(handle)->level = AlarmLevel::HIGH;
+    std::size_t size = pool.size();
+
+    std::unique_ptr<AlarmSlotPin> pin(new AlarmSlotPin(handle));
+    ASSERT_NE(pin->get(), nullptr);
+    std::atomic<bool> destroyed(false);
+    std::thread destroyer([&](){
+        pool.destroy(handle);
+        destroyed = true;
+    });
+    while(pool.get(handle)) std::this_thread::yield();
+
+    // The handle is stale for new users, but the pinned state isn't reset under its user
+    AlarmSlotPin late(handle);
+    ASSERT_EQ(late.get(), nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_FALSE(destroyed);
+    ASSERT_EQ(pin->get()->level, AlarmLevel::HIGH);
+    ASSERT_EQ(pool.size(), size);
+
+    pin.reset();
+    destroyer.join();
+    ASSERT_EQ(pool.size(), size - 1);
+}
+
+TEST(alarm_pool, apply_racing_destruction){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    std::size_t size = AlarmPool::Instance().size();
+    for(unsigned int i=0;i<200;i++){
+        std::unique_ptr<Alarm> alarm(new Alarm({AlarmTone(100, true), AlarmTone(100, false)}));
+        alarm->setPlayer(player);
+        std::vector<AlarmChange> changes;
+        for(unsigned int j=0;j<1000;j++){
+            changes.push_back(AlarmChange::start(*alarm));
+            changes.push_back(AlarmChange::stop(*alarm));
+        }
+        changes.push_back(AlarmChange::start(*alarm));
+
+        // Another thread starts and stops the alarm through its handle while it is destroyed
+        std::atomic<bool> applying(false);
+        std::thread starter([&](){
+            applying = true;
+            player.apply(changes);
+        });
+        while(!applying) std::this_thread::yield();
+        alarm.reset();
+        starter.join();
+
+        // Changes applied before the destruction are undone by it, later ones have a stale handle
+        ASSERT_EQ(player.isPlaying(), false);
+        ASSERT_EQ(AlarmPool::Instance().size(), size);
+        clock.advance(std::chrono::milliseconds(100));
+    }
+    ASSERT_EQ(output.getText().find('X'), std::string::npos);
+}
+
+TEST(alarm_pool, move){
+    Alarm alarm = Alarm(AlarmLevel::MEDIUM);
+    AlarmHandle handle = alarm.getHandle();
+    Alarm moved(std::move(alarm));
+    ASSERT_EQ(moved.getHandle(), handle);
+    ASSERT_EQ(moved.getLevel(), AlarmLevel::MEDIUM);
+
+    // The moved-from Alarm has no state, every function has no effect
+    ASSERT_FALSE((bool)alarm.getHandle());
+    alarm.start();
+    ASSERT_FALSE(alarm.isStarted());
+    ASSERT_EQ(alarm.getSequence().size(), 0);
+
+    Alarm assigned = Alarm(AlarmLevel::LOW);
+    AlarmHandle previous = assigned.getHandle();
+    assigned = std::move(moved);
+    ASSERT_EQ(assigned.getHandle(), handle);
+    ASSERT_EQ(AlarmPool::Instance().get(previous), nullptr);
+}
+
+TEST(alarm_pool, no_allocation_after_reserve){
+    const std::size_t count = 10000;
+    AlarmPool pool;
+    pool.reserve(count);
+    std::vector<AlarmHandle> handles(count);
+
+    unsigned long allocations = heapAllocations();
+    for(int round=0; round<3; round++){
+        for(AlarmHandle& handle : handles) handle = pool.create();
+        for(AlarmHandle& handle : handles) pool.destroy(handle);
+    }
+    ASSERT_EQ(heapAllocations() - allocations, 0);
+    ASSERT_EQ(pool.size(), 0);
+    ASSERT_GE(pool.capacity(), count);
+}
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include <AlarmQueue.h>
+
+struct QueueItem {
+    AlarmQueueHook<QueueItem> hook;
+};
+typedef AlarmQueue<QueueItem, &QueueItem::hook> ItemQueue;
+
+TEST(alarm_queue, empty){
+    ItemQueue queue;
+    ASSERT_EQ(queue.empty(), true);
+    ASSERT_EQ(queue.size(), 0);
+    ASSERT_EQ(queue.top(), nullptr);
+}
+
+TEST(alarm_queue, priority){
+    ItemQueue queue;
+    QueueItem low, medium, high;
+    queue.push(&low, 0);
+    ASSERT_EQ(queue.top(), &low);
+    queue.push(&high, 2);
+    ASSERT_EQ(queue.top(), &high);
+    queue.push(&medium, 1);
+    ASSERT_EQ(queue.top(), &high);
+    ASSERT_EQ(queue.size(), 3);
+    ASSERT_EQ(queue.topBelow(2), &medium);
+    ASSERT_EQ(queue.topBelow(1), &low);
+    ASSERT_EQ(queue.topBelow(0), nullptr);
+    ASSERT_EQ(queue.level(&medium), 1);
+
+    queue.remove(&high);
+    ASSERT_EQ(queue.top(), &medium);
+    queue.remove(&medium);
+    ASSERT_EQ(queue.top(), &low);
+    queue.remove(&low);
+    ASSERT_EQ(queue.top(), nullptr);
+    ASSERT_EQ(queue.empty(), true);
+}
+
+TEST(alarm_queue, fifo_within_level){
+    ItemQueue queue;
+    QueueItem items[4];
+    for(QueueItem& item : items) queue.push(&item, 1);
+    ASSERT_EQ(queue.top(), &items[0]);
+
+    // Removing from the middle keeps the order of the others
+    queue.remove(&items[1]);
+    queue.remove(&items[0]);
+    ASSERT_EQ(queue.top(), &items[2]);
+
+    // Re-queued items go to the back of their level
+    queue.push(&items[0], 1);
+    queue.remove(&items[2]);
+    ASSERT_EQ(queue.top(), &items[3]);
+    queue.remove(&items[3]);
+    ASSERT_EQ(queue.top(), &items[0]);
+}
+
+TEST(alarm_queue, push_remove_twice){
+    ItemQueue queue;
+    QueueItem item;
+    ASSERT_EQ(queue.contains(&item), false);
+    queue.remove(&item); // Not queued, no effect
+    queue.push(&item, 2);
+    queue.push(&item, 0); // Already queued, no effect
+    ASSERT_EQ(queue.contains(&item), true);
+    ASSERT_EQ(queue.size(), 1);
+    queue.remove(&item);
+    queue.remove(&item);
+    ASSERT_EQ(queue.contains(&item), false);
+    ASSERT_EQ(queue.size(), 0);
+}
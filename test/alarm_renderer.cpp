@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include <AlarmRenderer.h>
+#include <AlarmPattern.h>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+// Sink keeping every rendered sample in memory
+class PcmRecorder : public AlarmPcmSink {
+public:
+    void write(const std::int16_t* samples, std::size_t count) override {
+        this->samples.insert(this->samples.end(), samples, samples + count);
+    }
+    std::vector<std::int16_t> samples;
+};
+
+static std::string text(const std::vector<AlarmRenderEdge>& edges){
+    std::string result;
+    for(const AlarmRenderEdge& edge : edges) result += std::to_string(edge.time) + (edge.noisy ? "X " : "_ ");
+    return result;
+}
+
+TEST(alarm_renderer, timeline){
+    AlarmRenderTrack track;
+    track.sequence = AlarmPattern<AlarmBeep<250>, AlarmSilence<750>>::sequence();
+    ASSERT_EQ(text(AlarmRenderer::timeline({track}, std::chrono::milliseconds(2500))), "0X 250_ 1000X 1250_ 2000X 2250_ ");
+    track.stop = std::chrono::milliseconds(1100);
+    ASSERT_EQ(text(AlarmRenderer::timeline({track}, std::chrono::milliseconds(2500))), "0X 250_ 1000X 1100_ ");
+    ASSERT_EQ(AlarmRenderer::timeline({track}, std::chrono::milliseconds(0)).size(), 0);
+}
+
+TEST(alarm_renderer, timeline_priority){
+    AlarmRenderTrack low, high;
+    low.sequence = AlarmSequence::create({AlarmTone(100, true), AlarmTone(100, false), AlarmTone(200, true)});
+    high.sequence = AlarmSequence::create({AlarmTone(1000, false)});
+    high.level = AlarmLevel::HIGH;
+    high.start = std::chrono::milliseconds(150);
+    high.stop = std::chrono::milliseconds(400);
+    // The low alarm pauses in its silence at 150, resumes it at 400 for the 50 remaining milliseconds, then beeps on into its next cycle
+    ASSERT_EQ(text(AlarmRenderer::timeline({low, high}, std::chrono::milliseconds(700))), "0X 100_ 450X ");
+}
+
+TEST(alarm_renderer, render){
+    AlarmRenderSettings settings;
+    settings.sampleRate = 8000;
+    settings.frequency = 1000;
+    settings.amplitude = 0.25f;
+    settings.attack = settings.release = 1;
+    AlarmRenderer renderer(settings);
+    PcmRecorder recorder;
+    ASSERT_EQ(renderer.render({AlarmRenderEdge{100, true}, AlarmRenderEdge{200, false}}, std::chrono::milliseconds(300), recorder), 2400);
+    ASSERT_EQ(recorder.samples.size(), 2400);
+
+    int peak = 0;
+    for(std::size_t i=0;i<recorder.samples.size();i++){
+        int sample = std::abs(int(recorder.samples[i]));
+        if(i < 800 || i >= 1608){
+            ASSERT_EQ(sample, 0) << "sample " << i; // Silent, after the release ramp
+        }
+        peak = std::max(peak, sample);
+    }
+    ASSERT_EQ(peak, int(0.25f * 32767)); // Square wave at full envelope
+    ASSERT_NE(recorder.samples[1000], 0);
+}
+
+TEST(alarm_renderer, render_sine){
+    AlarmRenderSettings settings;
+    settings.sampleRate = 48000;
+    settings.frequency = 1000;
+    settings.waveform = AlarmWaveform::SINE;
+    settings.amplitude = 1;
+    AlarmRenderer renderer(settings);
+    PcmRecorder recorder;
+    renderer.render({AlarmRenderEdge{0, true}}, std::chrono::milliseconds(100), recorder);
+    // After the attack ramp, samples follow sin(2*pi*f*t)
+    for(std::size_t i=480;i<recorder.samples.size();i++){
+        ASSERT_NEAR(recorder.samples[i] / 32767.0, std::sin(2 * 3.14159265358979 * 1000 * i / 48000.0), 0.01) << "sample " << i;
+    }
+}
+
+TEST(alarm_renderer, wav){
+    const std::string path = "alarm_renderer_test.wav";
+    AlarmRenderSettings settings;
+    settings.sampleRate = 16000;
+    AlarmRenderer renderer(settings);
+    {
+        AlarmWavSink wav(path, settings.sampleRate);
+        ASSERT_EQ(wav.isOpen(), true);
+        renderer.render({AlarmRenderEdge{0, true}, AlarmRenderEdge{500, false}}, std::chrono::milliseconds(1000), wav);
+        ASSERT_EQ(wav.size(), 16000);
+    }
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+    ASSERT_EQ(data.size(), 44 + 16000 * 2);
+    ASSERT_EQ(std::string(data.begin(), data.begin() + 4), "RIFF");
+    ASSERT_EQ(std::string(data.begin() + 8, data.begin() + 16), "WAVEfmt ");
+    ASSERT_EQ(data[24] | data[25] << 8 | data[26] << 16, 16000); // Sample rate
+    ASSERT_EQ(std::string(data.begin() + 36, data.begin() + 40), "data");
+    ASSERT_EQ(data[40] | data[41] << 8 | data[42] << 16, 32000); // Data size
+}
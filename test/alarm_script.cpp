@@ -0,0 +1,99 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmScript.h>
+#include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <algorithm>
+#include <memory>
+
+// Milliseconds elapsed between the start of the clock and an edge
+static long long elapsed(const AlarmEdge& edge){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(edge.time.time_since_epoch()).count();
+}
+
+// Beeps a number of times, then stops its alarm
+static AlarmScript beeps(int count){
+    for(int i=0;i<count;i++){
+        co_yield AlarmTone(100, true);
+        co_yield AlarmTone(100, false);
+    }
+}
+
+// Beeps faster once it has played for a second
+static AlarmScript accelerating(){
+    for(;;){
+        bool fast = co_await AlarmScript::played() >= std::chrono::milliseconds(1000);
+        co_yield AlarmTone(fast ? 100 : 250, true);
+        co_yield AlarmTone(fast ? 100 : 250, false);
+    }
+}
+
+TEST(alarm_script, stop_after_cycles){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm(AlarmLevel::HIGH);
+    alarm.setSource(std::make_shared<AlarmScript>(beeps(3)));
+    alarm.setPlayer(player);
+    alarm.start();
+    clock.advance(std::chrono::milliseconds(1000));
+    ASSERT_EQ(output.getText(), "X_X_X_");
+    ASSERT_EQ(elapsed(output.getEdges().back()), 500);
+    ASSERT_FALSE(alarm.isStarted());
+    ASSERT_FALSE(player.isPlaying());
+
+    // An exhausted script stops its alarm again at once
+    alarm.start();
+    clock.advance(std::chrono::milliseconds(10));
+    ASSERT_FALSE(alarm.isStarted());
+}
+
+TEST(alarm_script, elapsed_time_and_preemption){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmRecorderSink output;
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm(AlarmLevel::LOW);
+    Alarm high = Alarm({AlarmTone(1000, false)}, AlarmLevel::HIGH);
+    alarm.setSource(std::make_shared<AlarmScript>(accelerating()));
+    alarm.setPlayer(player);
+    high.setPlayer(player);
+    alarm.start();
+
+    // Preempted in the middle of its third tone, the script resumes it where it paused
+    clock.advance(std::chrono::milliseconds(600));
+    high.start();
+    clock.advance(std::chrono::milliseconds(1000));
+    high.stop();
+    ASSERT_EQ(alarm.getPosition(), std::chrono::milliseconds(600));
+    clock.advance(std::chrono::milliseconds(1000));
+    // 250ms tones until 1000ms of playing time, then 100ms ones, the silence of the high alarm repeating at 1600ms
+    std::vector<long long> times = {0, 250, 500, 600, 1600, 1600, 1750, 2000, 2100, 2200, 2300, 2400, 2500};
+    std::vector<AlarmEdge> edges = output.getEdges();
+    ASSERT_GE(edges.size(), times.size());
+    for(std::size_t i=0;i<times.size();i++) ASSERT_EQ(elapsed(edges[i]), times[i]) << i;
+    alarm.stop();
+}
+
+TEST(alarm_script, thousands_of_scripts){
+    // Each zone runs its own script on a shared scheduler, without any thread
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmCallbackSink output([](const AlarmEdge&){});
+    std::vector<std::unique_ptr<AlarmPlayer>> players;
+    std::vector<Alarm> alarms;
+    for(int i=0;i<2000;i++){
+        players.emplace_back(new AlarmPlayer(output, scheduler));
+        alarms.emplace_back(AlarmLevel::MEDIUM);
+        alarms.back().setSource(std::make_shared<AlarmScript>(beeps(1 + i % 5)));
+        alarms.back().setPlayer(*players.back());
+        alarms.back().start();
+    }
+    clock.advance(std::chrono::milliseconds(500));
+    ASSERT_EQ(std::count_if(alarms.begin(), alarms.end(), [](Alarm& alarm){ return alarm.isStarted(); }), 1200); // 2 beeps or more
+    clock.advance(std::chrono::milliseconds(1000));
+    ASSERT_EQ(std::count_if(alarms.begin(), alarms.end(), [](Alarm& alarm){ return alarm.isStarted(); }), 0);
+    ASSERT_EQ(scheduler.isRunning(), false);
+}
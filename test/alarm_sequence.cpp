@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmPlayer.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include "CountingAllocator.h"
+
+TEST(alarm_sequence, create){
+    AlarmSequence::Ptr sequence = AlarmSequence::create({AlarmTone(250, true), AlarmTone(750, false)});
+    ASSERT_EQ(sequence->size(), 2);
+    ASSERT_EQ(sequence->duration(), 1000);
+    ASSERT_EQ((*sequence)[0].beep, true);
+    ASSERT_EQ((*sequence)[1].duration, 750);
+    ASSERT_EQ(AlarmSequence::empty()->size(), 0);
+    ASSERT_EQ(AlarmSequence::empty()->duration(), 0);
+}
+
+TEST(alarm_sequence, snapshot_is_immutable){
+    Alarm alarm = Alarm({AlarmTone(250, true)});
+    AlarmSequence::Ptr before = alarm.getSequenceSnapshot();
+    alarm.addTone(AlarmTone(500, false));
+    AlarmSequence::Ptr after = alarm.getSequenceSnapshot();
+
+    // Readers of the previous snapshot are not affected by the update
+    ASSERT_NE(before, after);
+    ASSERT_EQ(before->size(), 1);
+    ASSERT_EQ(after->size(), 2);
+    ASSERT_EQ(after->duration(), 750);
+}
+
+TEST(alarm_sequence, tick_without_allocation){
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    unsigned int edges = 0;
+    AlarmCallbackSink output([&](const AlarmEdge&){ edges++; });
+    AlarmPlayer player(output, scheduler);
+    Alarm alarm = Alarm({
+        AlarmTone(10, true),
+        AlarmTone(10, false)} ,
+        AlarmLevel::LOW
+    );
+    alarm.setPlayer(player);
+    alarm.start();
+    clock.advance(std::chrono::milliseconds(50)); //Make sure alarm started to ring
+
+    // Count allocations while the scheduler goes through many tone edges
+    edges = 0;
+    unsigned long allocations = heapAllocations();
+    clock.advance(std::chrono::milliseconds(300));
+    allocations = heapAllocations() - allocations;
+    alarm.stop();
+
+    ASSERT_EQ(edges, 30);
+    ASSERT_EQ(allocations, 0);
+}
+
+TEST(alarm_sequence, timeline_lookup){
+    AlarmSequence::Ptr sequence = AlarmSequence::create({AlarmTone(250, true), AlarmTone(500, false), AlarmTone(0, true), AlarmTone(250, true)});
+    ASSERT_EQ(sequence->duration(), 1000);
+    ASSERT_EQ(sequence->indexAt(0), 0);
+    ASSERT_EQ(sequence->indexAt(249), 0);
+    ASSERT_EQ(sequence->indexAt(250), 1);
+    ASSERT_EQ(sequence->indexAt(749), 1);
+    ASSERT_EQ(sequence->indexAt(750), 3); // Null tones are never played
+    ASSERT_EQ(sequence->indexAt(999), 3);
+    ASSERT_EQ(sequence->indexAt(1000), 0); // Wraps at the end of the sequence
+    ASSERT_EQ(sequence->toneAt(3*1000 + 300).beep, false);
+    ASSERT_EQ(AlarmSequence::empty()->indexAt(10), 0);
+}
+
+TEST(alarm_sequence, timeline_uniform){
+    AlarmSequence::Ptr sequence = AlarmSequence::create({AlarmTone(100, true), AlarmTone(100, false), AlarmTone(100, true)});
+    ASSERT_EQ(sequence->indexAt(99), 0);
+    ASSERT_EQ(sequence->indexAt(100), 1);
+    ASSERT_EQ(sequence->indexAt(299), 2);
+    ASSERT_EQ(sequence->indexAt(300), 0);
+}
+
+TEST(alarm_sequence, timeline_long_sequence){
+    // Generated test pattern with millions of tones of varying durations
+    std::vector<AlarmTone> tones;
+    for(unsigned int i=0;i<2*1000*1000;i++) tones.push_back(AlarmTone(1 + i%3, i%2));
+    AlarmSequence::Ptr sequence = AlarmSequence::create(tones);
+    ASSERT_EQ(sequence->size(), tones.size());
+    for(std::size_t index : {std::size_t(0), std::size_t(12345), tones.size()-1}){
+        unsigned long long start = index ? sequence->edge(index-1) : 0;
+        ASSERT_EQ(sequence->indexAt(start), index);
+        ASSERT_EQ(sequence->indexAt(sequence->edge(index)-1), index);
+    }
+}
+
+TEST(alarm_sequence, packed_tone){
+    ASSERT_EQ(sizeof(AlarmTone), 4);
+    AlarmTone tone(AlarmTone::MAX_DURATION, true);
+    ASSERT_EQ(tone.duration, AlarmTone::MAX_DURATION);
+    ASSERT_EQ(tone.beep, true);
+    ASSERT_EQ(AlarmTone(0xFFFFFFFF, false).duration, AlarmTone::MAX_DURATION); // Saturated
+    ASSERT_EQ(AlarmTone(0xFFFFFFFF, false).beep, false);
+}
+
+TEST(alarm_sequence, inline_storage){
+    std::vector<AlarmTone> tones = {AlarmTone(250, true), AlarmTone(500, false), AlarmTone(250, true), AlarmTone(1000, false)};
+
+    // Short runtime snapshots take a single allocation
+    unsigned long allocations = heapAllocations();
+    AlarmSequence::Ptr sequence = AlarmSequence::create(tones);
+    ASSERT_EQ(heapAllocations() - allocations, 1);
+    ASSERT_EQ(sequence->indexAt(800), 2);
+    ASSERT_EQ(sequence->edge(2), 1000);
+
+    // Short sequences given at construction are stored in the Alarm itself
+    AlarmSequence::Ptr snapshot;
+    { Alarm warmup; } // The pool allocates its first chunk of slots
+    {
+        std::vector<AlarmTone> copy = tones;
+        allocations = heapAllocations();
+        Alarm alarm(std::move(copy), AlarmLevel::MEDIUM);
+        ASSERT_EQ(heapAllocations() - allocations, 0);
+        snapshot = alarm.getSequenceSnapshot();
+        ASSERT_NE(snapshot.use_count(), 0); // An owning copy, not the storage of the Alarm
+        ASSERT_EQ(snapshot->duration(), 2000);
+    }
+
+    // The snapshot outlives the Alarm, and the reuse of its storage by another one
+    Alarm other({AlarmTone(100, false)}, AlarmLevel::LOW);
+    ASSERT_EQ(snapshot->size(), 4);
+    ASSERT_EQ(snapshot->duration(), 2000);
+    ASSERT_EQ(snapshot->indexAt(1999), 3);
+    ASSERT_EQ((*snapshot)[0].beep, true);
+}
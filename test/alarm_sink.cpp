@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+#include <Alarm.h>
+#include <AlarmScheduler.h>
+#include <AlarmRing.h>
+#include <AlarmSink.h>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+TEST(alarm_sink, ring){
+    AlarmRing<int> ring(3);
+    ASSERT_EQ(ring.capacity(), 4);
+    ASSERT_EQ(ring.empty(), true);
+    for(int i=0;i<4;i++) ASSERT_EQ(ring.push(i), true);
+    ASSERT_EQ(ring.push(4), false); // Full
+    int item = -1;
+    ASSERT_EQ(ring.pop(item), true);
+    ASSERT_EQ(item, 0);
+    ASSERT_EQ(ring.push(4), true);
+    for(int i=1;i<5;i++){
+        ASSERT_EQ(ring.pop(item), true);
+        ASSERT_EQ(item, i);
+    }
+    ASSERT_EQ(ring.pop(item), false);
+}
+
+TEST(alarm_sink, ring_threads){
+    AlarmRing<unsigned int> ring(64);
+    const unsigned int count = 100000;
+    std::thread producer([&](){
+        for(unsigned int i=0;i<count;i++) while(!ring.push(i)) std::this_thread::yield();
+    });
+    unsigned int expected = 0, item = 0;
+    while(expected < count){
+        if(!ring.pop(item)){
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(item, expected); // Nothing lost nor reordered
+        expected++;
+    }
+    producer.join();
+    ASSERT_EQ(ring.empty(), true);
+}
+
+TEST(alarm_sink, recorder){
+    AlarmRecorderSink recorder;
+    AlarmScheduler scheduler;
+    AlarmPlayer player(recorder, scheduler);
+    Alarm alarm = Alarm({AlarmTone(100, true), AlarmTone(100, false)}, AlarmLevel::LOW);
+    alarm.setPlayer(player);
+    alarm.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(450));
+    alarm.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20)); //Make sure alarm stopped
+    scheduler.drain();
+    ASSERT_EQ(recorder.getText(), "X_X_X_");
+    std::vector<AlarmEdge> edges = recorder.getEdges();
+    ASSERT_NEAR(std::chrono::duration_cast<std::chrono::milliseconds>(edges[4].time - edges[0].time).count(), 400, 10);
+    AlarmSinkStats stats = scheduler.getSinkStats();
+    ASSERT_EQ(stats.queued, 6);
+    ASSERT_EQ(stats.delivered, 6);
+    ASSERT_EQ(stats.dropped + stats.coalesced, 0);
+}
+
+TEST(alarm_sink, file){
+    const char* path = "alarm_sink_test.log";
+    {
+        AlarmFileSink file(path);
+        ASSERT_EQ(file.isOpen(), true);
+        AlarmEdge edge;
+        edge.noisy = true;
+        file.write(edge);
+        edge.noisy = false;
+        file.write(edge);
+    }
+    std::ifstream input(path);
+    long long time;
+    char state;
+    ASSERT_TRUE((bool)(input >> time >> state));
+    ASSERT_EQ(state, 'X');
+    ASSERT_TRUE((bool)(input >> time >> state));
+    ASSERT_EQ(state, '_');
+    std::remove(path);
+}
+
+// Plays a fast alarm on a sink blocked by the test, so the ring fills up
+static AlarmSinkStats playOnBlockedSink(AlarmSinkPolicy policy, std::vector<AlarmEdge>& written, bool& noisyWhileBlocked){
+    std::mutex gate;
+    AlarmCallbackSink sink([&](const AlarmEdge& edge){
+        std::lock_guard<std::mutex> lock(gate);
+        written.push_back(edge);
+    });
+    AlarmScheduler scheduler(4);
+    scheduler.setSinkPolicy(policy);
+    AlarmPlayer player(sink, scheduler);
+    Alarm alarm = Alarm({AlarmTone(5, true), AlarmTone(5, false)}, AlarmLevel::LOW);
+    alarm.setPlayer(player);
+
+    gate.lock();
+    alarm.start();
+    // The playback goes on while the sink is blocked
+    noisyWhileBlocked = false;
+    for(int i=0;i<100 && !noisyWhileBlocked;i++){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        noisyWhileBlocked = player.isNoisy();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    alarm.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    gate.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // Let a coalesced edge be queued
+    scheduler.drain();
+    return scheduler.getSinkStats();
+}
+
+TEST(alarm_sink, full_ring_coalesce){
+    std::vector<AlarmEdge> written;
+    bool noisy = false;
+    AlarmSinkStats stats = playOnBlockedSink(AlarmSinkPolicy::COALESCE, written, noisy);
+    ASSERT_EQ(noisy, true);
+    ASSERT_GT(stats.coalesced, 0);
+    ASSERT_EQ(stats.dropped, 0);
+    ASSERT_EQ(stats.delivered, stats.queued);
+    ASSERT_LE(written.size(), 10);
+    ASSERT_EQ(written.back().noisy, false); // The sink ends up in the played state
+}
+
+TEST(alarm_sink, full_ring_drop){
+    std::vector<AlarmEdge> written;
+    bool noisy = false;
+    AlarmSinkStats stats = playOnBlockedSink(AlarmSinkPolicy::DROP, written, noisy);
+    ASSERT_EQ(noisy, true);
+    ASSERT_GT(stats.dropped, 0);
+    ASSERT_EQ(stats.coalesced, 0);
+    ASSERT_EQ(stats.delivered, stats.queued);
+    ASSERT_LE(written.size(), 10);
+}
@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
 #include <Alarm.h>
+#include <AlarmScheduler.h>
+#include <AlarmClock.h>
+#include <thread>
 
 TEST(alarm, constructor_default) {
     Alarm alarm = Alarm();
@@ -85,7 +88,11 @@ TEST(alarm, setters_sequence) {
 
 TEST(alarm, start_stop) {
     std::cout << '\r'; //prepare test output for cleanup
+    AlarmManualClock clock;
+    AlarmScheduler scheduler(clock);
+    AlarmPlayer player(std::cout, scheduler);
     Alarm alarm = Alarm();
+    alarm.setPlayer(player);
     ASSERT_EQ(alarm.isStarted(), false);
 
     //First cycle
@@ -94,11 +101,57 @@ TEST(alarm, start_stop) {
     alarm.stop();
     ASSERT_EQ(alarm.isStarted(), false);
 
-    //Second cycle, with sleep
+    //Second cycle, with playback
     alarm.start();
     ASSERT_EQ(alarm.isStarted(), true);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    clock.advance(std::chrono::milliseconds(500));
     alarm.stop();
     ASSERT_EQ(alarm.isStarted(), false);
     std::cout << '\r'; // Clean test output
-}
\ No newline at end of file
+}
+
+
+TEST(alarm, concurrent_calls) {
+    // Threads share alarms and call every function of the Alarm API at once, including rebinding them between players
+    AlarmScheduler scheduler;
+    AlarmCallbackSink output([](const AlarmEdge&){});
+    AlarmPlayer player_a(output, scheduler);
+    AlarmPlayer player_b(output, scheduler);
+    std::vector<Alarm> alarms;
+    for(unsigned int i=0;i<4;i++){
+        alarms.push_back(Alarm({AlarmTone(2, true), AlarmTone(3, false)}, AlarmLevel(i % 3)));
+        alarms.back().setPlayer(player_a);
+    }
+
+    std::vector<std::thread> threads;
+    for(unsigned int t=0;t<4;t++){
+        threads.push_back(std::thread([&, t](){
+            unsigned int seed = t;
+            for(unsigned int i=0;i<2000;i++){
+                seed = seed * 1103515245 + 12345;
+                Alarm& alarm = alarms[(seed >> 8) % alarms.size()];
+                switch((seed >> 16) % 10){
+                    case 0: alarm.start(std::chrono::milliseconds(i % 5)); break;
+                    case 1: alarm.stop(); break;
+                    case 2: alarm.setLevel(AlarmLevel((seed >> 20) % 3), (seed >> 24) & 1); break;
+                    case 3: alarm.setPlayer((seed >> 20) & 1 ? player_a : player_b); break;
+                    case 4: alarm.seek(std::chrono::milliseconds(i % 5)); break;
+                    case 5: alarm.getPosition(); break;
+                    case 6: alarm.getStats(); break;
+                    case 7: if(i % 64 == 0) alarm.addTone(AlarmTone(1, false)); else alarm.getSequenceSnapshot(); break;
+                    case 8: alarm.getState(); alarm.getLevel(); break;
+                    case 9: alarm.syncWith(alarms[(seed >> 20) % alarms.size()]); break;
+                }
+            }
+        }));
+    }
+    for(std::thread& thread : threads) thread.join();
+
+    // Whatever the interleaving, no alarm is left attached to a player once stopped
+    for(Alarm& alarm : alarms){
+        alarm.stop();
+        ASSERT_EQ(alarm.getState(), AlarmState::IDLE);
+    }
+    ASSERT_EQ(player_a.isPlaying(), false);
+    ASSERT_EQ(player_b.isPlaying(), false);
+}
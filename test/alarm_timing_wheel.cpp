@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include <AlarmTimingWheel.h>
+#include <map>
+#include <random>
+#include <vector>
+
+struct TimerItem {
+    AlarmTimerHook<TimerItem> hook;
+};
+typedef AlarmTimingWheel<TimerItem, &TimerItem::hook> ItemWheel;
+
+TEST(alarm_timing_wheel, empty){
+    ItemWheel wheel;
+    ASSERT_EQ(wheel.empty(), true);
+    ASSERT_EQ(wheel.nextTick(), ItemWheel::NONE);
+    ASSERT_EQ(wheel.pop(1000), nullptr);
+    ASSERT_EQ(wheel.now(), 1000);
+}
+
+TEST(alarm_timing_wheel, expiry_order){
+    ItemWheel wheel;
+    TimerItem near, middle, far;
+    wheel.insert(&far, 300000); // Level 3
+    wheel.insert(&near, 10); // Level 0
+    wheel.insert(&middle, 5000); // Level 2
+    ASSERT_EQ(wheel.size(), 3);
+    ASSERT_EQ(wheel.nextTick(), 10);
+
+    ASSERT_EQ(wheel.pop(9), nullptr);
+    ASSERT_EQ(wheel.pop(10), &near);
+    ASSERT_EQ(wheel.pop(4999), nullptr);
+    ASSERT_EQ(wheel.pop(100000), &middle);
+    ASSERT_EQ(wheel.now(), 5000); // Stops at the expiry, later items may still be pending
+    ASSERT_EQ(wheel.pop(299999), nullptr);
+    ASSERT_EQ(wheel.pop(300000), &far);
+    ASSERT_EQ(wheel.empty(), true);
+}
+
+TEST(alarm_timing_wheel, cancel_and_move){
+    ItemWheel wheel;
+    TimerItem a, b;
+    wheel.insert(&a, 100);
+    wheel.insert(&b, 200);
+    wheel.remove(&a);
+    ASSERT_EQ(wheel.contains(&a), false);
+    wheel.remove(&a); // No effect
+    wheel.insert(&b, 50); // Moved earlier
+    ASSERT_EQ(wheel.size(), 1);
+    ASSERT_EQ(wheel.pop(60), &b);
+    ASSERT_EQ(wheel.pop(1000), nullptr);
+
+    // Items in the past expire at the current tick
+    wheel.insert(&a, 10);
+    ASSERT_EQ(wheel.tick(&a), 1000);
+    ASSERT_EQ(wheel.pop(1000), &a);
+
+    // Items beyond the horizon expire early, a horizon after the start of the current top level slot
+    wheel.insert(&b, ItemWheel::HORIZON * 4);
+    ASSERT_EQ(wheel.tick(&b), ItemWheel::HORIZON - 1);
+}
+
+TEST(alarm_timing_wheel, matches_sorted_reference){
+    ItemWheel wheel;
+    std::vector<TimerItem> items(2000);
+    std::multimap<std::uint64_t, TimerItem*> reference;
+    std::mt19937 random(7);
+    std::uint64_t now = 0;
+    for(int round=0; round<20; round++){
+        // Schedule, move and cancel items at random distances, from 0 to about 4 levels away
+        for(TimerItem& item : items){
+            unsigned int action = random() % 4;
+            if(action == 3){
+                wheel.remove(&item);
+                continue;
+            }
+            std::uint64_t tick = now + (random() % (1u << (6 * (1 + random() % 4))));
+            wheel.insert(&item, tick);
+        }
+        reference.clear();
+        for(TimerItem& item : items) if(wheel.contains(&item)) reference.insert(std::make_pair(wheel.tick(&item), &item));
+
+        // Expire up to a random tick, every item must be popped at its own tick
+        now += random() % 100000;
+        std::size_t expired = 0;
+        while(TimerItem* item = wheel.pop(now)){
+            ASSERT_LE(item->hook.tick, now);
+            ASSERT_EQ(item->hook.tick, reference.begin()->first); // Popped in expiry order
+            reference.erase(reference.begin()->first == item->hook.tick ? reference.find(item->hook.tick) : reference.end());
+            expired++;
+        }
+        ASSERT_EQ(wheel.size(), reference.size());
+        if(!reference.empty()){
+            ASSERT_GT(reference.begin()->first, now);
+        }
+        ASSERT_GT(expired + reference.size(), 0);
+    }
+}
+
+TEST(alarm_timing_wheel, next_block){
+    // On the last tick of a block, items of the next block are still scheduled ahead instead of at the current tick
+    ItemWheel wheel;
+    TimerItem a, b, c;
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON - 1), nullptr);
+    wheel.insert(&a, ItemWheel::HORIZON + 1000);
+    wheel.insert(&b, ItemWheel::HORIZON * 10);
+    wheel.insert(&c, ItemWheel::HORIZON + 2);
+    ASSERT_EQ(wheel.tick(&a), ItemWheel::HORIZON + 1000);
+    ASSERT_GT(wheel.tick(&b), ItemWheel::HORIZON + 1000);
+    ASSERT_EQ(wheel.nextTick(), ItemWheel::HORIZON);
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON + 1), nullptr);
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON + 999), &c);
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON + 999), nullptr);
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON + 1000), &a);
+    ASSERT_EQ(wheel.pop(ItemWheel::HORIZON * 10), &b);
+
+    // Random distances up to the horizon, across block boundaries
+    std::vector<TimerItem> items(500);
+    std::multimap<std::uint64_t, TimerItem*> reference;
+    std::mt19937 random(11);
+    std::uint64_t now = wheel.now();
+    for(int round=0; round<40; round++){
+        for(TimerItem& item : items){
+            if(random() % 2) wheel.insert(&item, now + std::uint64_t(random()) % (ItemWheel::HORIZON / 2));
+        }
+        reference.clear();
+        for(TimerItem& item : items) if(wheel.contains(&item)) reference.insert(std::make_pair(wheel.tick(&item), &item));
+        now += std::uint64_t(random()) % (ItemWheel::HORIZON / 4);
+        while(TimerItem* item = wheel.pop(now)){
+            ASSERT_EQ(item->hook.tick, reference.begin()->first);
+            reference.erase(reference.find(item->hook.tick));
+        }
+        ASSERT_EQ(wheel.size(), reference.size());
+        if(!reference.empty()){
+            ASSERT_GT(reference.begin()->first, now);
+        }
+    }
+}
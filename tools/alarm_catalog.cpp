@@ -0,0 +1,84 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <AlarmCatalog.h>
+#include <AlarmPatternCompiler.h>
+
+// Compiles a text source of named patterns into a binary AlarmCatalog, or lists a catalog.
+// Source format, one pattern per line, '#' starting a comment:
+//   <name> <LOW|MEDIUM|HIGH> <pattern>
+// where the pattern is written in the language of AlarmPatternCompiler, e.g.
+//   fire HIGH (250X 500_)x4 250X 2000_
+// The catalog stores flat tones: repetitions are expanded when compiled into it
+
+void printHelp(){
+    std::cout << "Usage:" << std::endl;
+    std::cout << "\t alarm_catalog <source> <catalog> : compiles a text source into a catalog" << std::endl;
+    std::cout << "\t alarm_catalog -l <catalog> : verifies and lists a catalog" << std::endl;
+}
+
+bool parseLevel(const std::string& text, AlarmLevel& level){
+    if(text == "LOW") level = AlarmLevel::LOW;
+    else if(text == "MEDIUM") level = AlarmLevel::MEDIUM;
+    else if(text == "HIGH") level = AlarmLevel::HIGH;
+    else return false;
+    return true;
+}
+
+int compile(const std::string& sourcePath, const std::string& catalogPath){
+    std::ifstream source(sourcePath);
+    if(!source.is_open()){
+        std::cerr << sourcePath << ": cannot be read" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<AlarmCatalogPattern> patterns;
+    std::string line;
+    for(unsigned int number=1; std::getline(source, line); number++){
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        AlarmCatalogPattern pattern;
+        std::string level;
+        if(!(tokens >> pattern.name)) continue; // Blank line
+        if(!(tokens >> level) || !parseLevel(level, pattern.level)){
+            std::cerr << sourcePath << ":" << number << ": expected a level LOW, MEDIUM or HIGH" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::size_t start = tokens.eof() ? line.size() : std::size_t(tokens.tellg());
+        AlarmPatternError error;
+        AlarmSequence::Ptr sequence = AlarmPatternCompiler::compile(line.data() + start, line.size() - start, &error);
+        if(!sequence){
+            std::cerr << sourcePath << ":" << number << ":" << start + error.position + 1 << ": " << error.message << std::endl;
+            return EXIT_FAILURE;
+        }
+        pattern.tones = sequence->toVector();
+        patterns.push_back(pattern);
+    }
+    if(!AlarmCatalog::write(catalogPath, patterns)){
+        std::cerr << catalogPath << ": cannot be written, or a pattern name is duplicated" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << patterns.size() << " patterns written to " << catalogPath << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int list(const std::string& catalogPath){
+    static const char* levels[] = {"LOW", "MEDIUM", "HIGH"};
+    AlarmCatalog catalog(catalogPath);
+    if(!catalog.isOpen() || !catalog.verify()){
+        std::cerr << catalogPath << ": not a valid catalog of version " << AlarmCatalog::VERSION << std::endl;
+        return EXIT_FAILURE;
+    }
+    for(std::size_t i=0;i<catalog.size();i++){
+        std::cout << catalog.name(i) << " " << levels[(int)catalog.level(i)];
+        for(const AlarmTone& tone : catalog.sequence(i)) std::cout << " " << tone.duration << (tone.beep ? 'X' : '_');
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    if(argc == 3 && std::string(argv[1]) == "-l") return list(argv[2]);
+    if(argc == 3 && argv[1][0] != '-') return compile(argv[1], argv[2]);
+    printHelp();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <AlarmJournal.h>
+#include <AlarmRenderer.h>
+#include <AlarmPcmSink.h>
+
+// Inspects a binary AlarmJournal written by players, see AlarmPlayer::setJournal().
+// The records only hold handles and levels, not the tones of the alarms: the playback is reconstructed
+// from the tone edges, which is what the sinks of the players received. Replaying the starts, stops and
+// level changes into a player needs the alarms themselves, see AlarmJournal::replay().
+
+void printHelp(){
+    std::cout << "Usage:" << std::endl;
+    std::cout << "\t alarm_journal <journal> : lists the records of a journal" << std::endl;
+    std::cout << "\t alarm_journal -t <journal> [zone] : prints which alarm was audible when on a zone, 0 by default" << std::endl;
+    std::cout << "\t alarm_journal -w <journal> <wav> [zone] : renders the audible output of a zone to a WAV file" << std::endl;
+}
+
+static const char* levels[] = {"LOW", "MEDIUM", "HIGH"};
+
+std::ostream& printAlarm(std::ostream& stream, AlarmHandle alarm){
+    if(!alarm) return stream << "-";
+    return stream << alarm.index << "." << alarm.generation;
+}
+
+double milliseconds(std::int64_t nanoseconds, std::int64_t origin){
+    return (nanoseconds - origin) / 1e6;
+}
+
+bool load(const std::string& path, std::vector<AlarmJournalRecord>& records){
+    if(AlarmJournal::read(path, records)) return true;
+    std::cerr << path << ": not a journal of version " << AlarmJournal::VERSION << std::endl;
+    return false;
+}
+
+int list(const std::string& path){
+    std::vector<AlarmJournalRecord> records;
+    if(!load(path, records)) return EXIT_FAILURE;
+    std::int64_t origin = records.empty() ? 0 : records.front().time;
+    std::cout << std::fixed << std::setprecision(3);
+    for(const AlarmJournalRecord& record : records){
+        std::cout << "#" << record.sequence - 1 << " " << milliseconds(record.time, origin) << "ms zone " << record.zone << " ";
+        switch(record.event){
+            case AlarmJournalEvent::START:
+                printAlarm(std::cout << "start ", record.handle()) << " " << levels[record.value % 3] << " at " << record.other << "ms";
+                break;
+            case AlarmJournalEvent::STOP:
+                printAlarm(std::cout << "stop ", record.handle());
+                break;
+            case AlarmJournalEvent::LEVEL:
+                printAlarm(std::cout << "level ", record.handle()) << " " << levels[record.value % 3];
+                break;
+            case AlarmJournalEvent::EDGE:
+                printAlarm(std::cout << (record.value ? "beep " : "silence "), record.handle());
+                break;
+            case AlarmJournalEvent::PREEMPT:
+                printAlarm(std::cout << "preempt ", record.handle()) << " by " << record.other << " " << levels[record.value % 3];
+                break;
+            default:
+                std::cout << "unknown event " << (int)record.event;
+                break;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << records.size() << " records" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int timeline(const std::string& path, std::uint16_t zone){
+    std::vector<AlarmJournalRecord> records;
+    if(!load(path, records)) return EXIT_FAILURE;
+    std::int64_t origin = records.empty() ? 0 : records.front().time;
+    std::cout << std::fixed << std::setprecision(3);
+    for(const AlarmJournalRecord& record : records){
+        if(record.zone != zone || record.event != AlarmJournalEvent::PREEMPT) continue;
+        printAlarm(std::cout << milliseconds(record.time, origin) << "ms ", record.handle()) << " preempted by " << record.other << std::endl;
+    }
+    std::vector<AlarmJournalSpan> spans = AlarmJournal::audible(records, zone);
+    for(const AlarmJournalSpan& span : spans){
+        std::cout << milliseconds(span.start.count(), origin) << "ms to " << milliseconds(span.end.count(), origin) << "ms ";
+        printAlarm(std::cout, span.alarm) << " " << levels[(int)span.level % 3] << std::endl;
+    }
+    std::cout << spans.size() << " beeps" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int render(const std::string& path, const std::string& wavPath, std::uint16_t zone){
+    std::vector<AlarmJournalRecord> records;
+    if(!load(path, records)) return EXIT_FAILURE;
+    std::vector<AlarmRenderEdge> edges = AlarmRenderer::timeline(AlarmJournal::edges(records, zone));
+    AlarmRenderer renderer;
+    AlarmWavSink sink(wavPath, renderer.getSettings().sampleRate);
+    if(!sink.isOpen()){
+        std::cerr << wavPath << ": cannot be written" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::chrono::milliseconds duration(edges.empty() ? 0 : edges.back().time + 1000); // Lets the last tone ring out
+    renderer.render(edges, duration, sink);
+    sink.close();
+    std::cout << edges.size() << " edges rendered to " << wavPath << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    if((argc == 3 || argc == 4) && std::string(argv[1]) == "-t") return timeline(argv[2], argc == 4 ? std::stoi(argv[3]) : 0);
+    if((argc == 4 || argc == 5) && std::string(argv[1]) == "-w") return render(argv[2], argv[3], argc == 5 ? std::stoi(argv[4]) : 0);
+    if(argc == 2 && argv[1][0] != '-') return list(argv[1]);
+    printHelp();
+    return EXIT_FAILURE;
+}
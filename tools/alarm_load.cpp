@@ -0,0 +1,141 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <AlarmMetrics.h>
+
+// Load generator of the AlarmControlServer: clients pipeline windows of commands and wait for their replies.
+// Reports the command throughput and the round trip of a window.
+
+static const std::size_t ALARMS = 16; // Alarms defined by the load, load0 to load15
+
+void printHelp(){
+    std::cout << "Usage:" << std::endl;
+    std::cout << "\t alarm_load <socket> [clients] [commands per client] [pipeline depth]" << std::endl;
+    std::cout << "\t defaults: 4 clients, 100000 commands, depth 64" << std::endl;
+}
+
+int connectTo(const std::string& path){
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)) return -1;
+    std::copy(path.begin(), path.end(), address.sun_path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0){
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const std::string& text){
+    for(std::size_t sent=0;sent<text.size();){
+        ssize_t size = ::write(fd, text.data() + sent, text.size() - sent);
+        if(size <= 0) return false;
+        sent += size;
+    }
+    return true;
+}
+
+// Reads replies until count lines are received, counting the errors
+bool receiveLines(int fd, std::size_t count, unsigned long long& errors){
+    char buffer[64 * 1024];
+    bool lineStart = true;
+    while(count){
+        ssize_t size = ::read(fd, buffer, sizeof(buffer));
+        if(size <= 0) return false;
+        for(ssize_t i=0;i<size;i++){
+            if(lineStart && buffer[i] == 'e') errors++; // "error ..."
+            lineStart = buffer[i] == '\n';
+            if(lineStart) count--;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(argc < 2 || argv[1][0] == '-'){
+        printHelp();
+        return EXIT_FAILURE;
+    }
+    std::string path = argv[1];
+    std::size_t clients = argc > 2 ? std::stoul(argv[2]) : 4;
+    std::size_t commands = argc > 3 ? std::stoul(argv[3]) : 100000;
+    std::size_t depth = argc > 4 ? std::stoul(argv[4]) : 64;
+    if(!clients || !depth){
+        printHelp();
+        return EXIT_FAILURE;
+    }
+
+    int setup = connectTo(path);
+    if(setup < 0){
+        std::cerr << path << ": cannot connect" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string defines;
+    for(std::size_t i=0;i<ALARMS;i++) defines += "define load" + std::to_string(i) + " LOW (50X 50_)x4 800_\n";
+    unsigned long long errors = 0;
+    if(!sendAll(setup, defines) || !receiveLines(setup, ALARMS, errors) || errors){
+        std::cerr << path << ": the load alarms cannot be defined" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    AlarmHistogram windows; // Round trip of a window, in nanoseconds
+    std::vector<unsigned long long> clientErrors(clients, 0);
+    std::vector<char> failed(clients, false); // Not vector<bool>, written concurrently
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(std::size_t c=0;c<clients;c++){
+        threads.emplace_back([&, c](){
+            static const char* levels[] = {"LOW", "MEDIUM", "HIGH"};
+            int fd = connectTo(path);
+            if(fd < 0){
+                failed[c] = true;
+                return;
+            }
+            std::string window;
+            for(std::size_t done=0, n=c;done<commands;){
+                std::size_t size = std::min(depth, commands - done);
+                window.clear();
+                for(std::size_t i=0;i<size;i++, n++){
+                    std::string alarm = "load" + std::to_string(n % ALARMS);
+                    switch(n % 3){
+                        case 0: window += "start " + alarm + "\n"; break;
+                        case 1: window += "level " + alarm + " " + levels[n % 9 / 3] + "\n"; break;
+                        case 2: window += "stop " + alarm + "\n"; break;
+                    }
+                }
+                std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+                if(!sendAll(fd, window) || !receiveLines(fd, size, clientErrors[c])){
+                    failed[c] = true;
+                    break;
+                }
+                windows.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count());
+                done += size;
+            }
+            ::close(fd);
+        });
+    }
+    for(std::thread& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(setup);
+
+    for(std::size_t c=0;c<clients;c++){
+        if(failed[c]){
+            std::cerr << "client " << c << " lost its connection" << std::endl;
+            return EXIT_FAILURE;
+        }
+        errors += clientErrors[c];
+    }
+    AlarmHistogramSnapshot latency = windows.snapshot();
+    std::cout << clients << " clients, " << clients * commands << " commands, depth " << depth << " in " << seconds << " s" << std::endl;
+    std::cout << "throughput " << (unsigned long long)(clients * commands / seconds) << " commands/s, " << errors << " errors" << std::endl;
+    std::cout << "window round trip: mean " << latency.mean() / 1000 << " us, p50 " << latency.percentile(50) / 1000
+              << " us, p99 " << latency.percentile(99) / 1000 << " us, max " << latency.max / 1000 << " us" << std::endl;
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}